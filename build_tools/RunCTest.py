@@ -19,7 +19,8 @@ class RunCTest(Command):
         compiler = new_compiler()
 
         # Compile and link
-        obj_files = compiler.compile(['src/rtpsynth.c', 'tests/test_synth.c'],
+        obj_files = compiler.compile(['src/rtpsynth.c', 'src/rsynth_pool.c',
+          'src/rsynth_pacer.c', 'tests/test_synth.c'],
           extra_preargs=self.extra_compile_args + ['-Isrc',])
         compiler.link_executable(obj_files, 'build/test_synth', extra_postargs=self.extra_link_args)
 
@@ -14,6 +14,10 @@
 #include "rtp.h"
 #include "rtp_info.h"
 #include "rtpjbuf.h"
+#if !defined(_WIN32) && !defined(_WIN64)
+#include "rtpjbuf_mgr.h"
+#define HAVE_RTPJBUF_MGR 1
+#endif
 
 #define MODULE_NAME "rtpsynth.RtpJBuf"
 #define NO_INPUT_PTR ((const unsigned char *)1)
@@ -34,6 +38,11 @@ typedef struct {
     struct ers_frame ers;
 } PyERSFrame;
 
+typedef struct {
+    PyObject_HEAD
+    struct rst_frame rst;
+} PyRSTFrame;
+
 typedef struct {
     PyObject_HEAD
     PyObject *rtp;
@@ -66,8 +75,18 @@ typedef struct {
     PyRtpJBufRef *refs;
     unsigned int capacity;
     uint64_t dropped;
+    uint64_t bypassed;
+    struct rtp_ptmap *pm;
+    unsigned int mtu;
 } PyRtpJBuf;
 
+#if defined(HAVE_RTPJBUF_MGR)
+typedef struct {
+    PyObject_HEAD
+    void *mgr;
+} PyRtpJBufMgr;
+#endif
+
 typedef struct {
     unsigned long long rtpinfo_created;
     unsigned long long rtpinfo_freed;
@@ -97,10 +116,14 @@ static PyObject *RTPParseError;
 static PyTypeObject PyRTPInfoType;
 static PyTypeObject PyRTPPacketType;
 static PyTypeObject PyERSFrameType;
+static PyTypeObject PyRSTFrameType;
 static PyTypeObject PyRTPFrameUnionType;
 static PyTypeObject PyRTPFrameType;
 static PyTypeObject PyFrameWrapperType;
 static PyTypeObject PyRtpJBufType;
+#if defined(HAVE_RTPJBUF_MGR)
+static PyTypeObject PyRtpJBufMgrType;
+#endif
 
 static void
 count_inc(unsigned long long *counter)
@@ -380,6 +403,61 @@ static PyTypeObject PyERSFrameType = {
     .tp_getset = PyERSFrame_getset,
 };
 
+static PyObject *
+PyRSTFrame_FromRst(const struct rst_frame *rst)
+{
+    PyRSTFrame *obj = PyObject_New(PyRSTFrame, &PyRSTFrameType);
+    if (obj == NULL)
+        return NULL;
+    obj->rst = *rst;
+    return (PyObject *)obj;
+}
+
+static int
+PyRSTFrame_init(PyRSTFrame *self, PyObject *args, PyObject *kwds)
+{
+    if (PyTuple_GET_SIZE(args) != 0) {
+        PyErr_SetString(PyExc_TypeError, "RSTFrame() takes no arguments");
+        return -1;
+    }
+    (void)kwds;
+    memset(&self->rst, 0, sizeof(self->rst));
+    return 0;
+}
+
+static PyObject *PyRSTFrame_get_lseq(PyRSTFrame *self, void *closure) {
+    (void)closure;
+    return PyLong_FromUnsignedLongLong(self->rst.lseq);
+}
+
+static PyObject *PyRSTFrame_get_ssrc(PyRSTFrame *self, void *closure) {
+    (void)closure;
+    return PyLong_FromUnsignedLong(self->rst.ssrc);
+}
+
+static PyObject *PyRSTFrame_get_type(PyRSTFrame *self, void *closure) {
+    (void)self;
+    (void)closure;
+    return PyLong_FromLong(RFT_RST);
+}
+
+static PyGetSetDef PyRSTFrame_getset[] = {
+    {"lseq", (getter)PyRSTFrame_get_lseq, NULL, NULL, NULL},
+    {"ssrc", (getter)PyRSTFrame_get_ssrc, NULL, NULL, NULL},
+    {"type", (getter)PyRSTFrame_get_type, NULL, NULL, NULL},
+    {NULL}
+};
+
+static PyTypeObject PyRSTFrameType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = MODULE_NAME ".RSTFrame",
+    .tp_basicsize = sizeof(PyRSTFrame),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)PyRSTFrame_init,
+    .tp_getset = PyRSTFrame_getset,
+};
+
 static PyObject *
 PyRTPFrameUnion_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
@@ -614,6 +692,12 @@ PyFrameWrapper_str(PyFrameWrapper *self)
             (unsigned long long)ers->ers.lseq_start,
             (unsigned long long)ers->ers.lseq_end);
     }
+    if (self->content != NULL && PyObject_TypeCheck(self->content, &PyRSTFrameType)) {
+        PyRSTFrame *rst = (PyRSTFrame *)self->content;
+        return PyUnicode_FromFormat("RTP_Restart(seq=%llu, ssrc=%lu)",
+            (unsigned long long)rst->rst.lseq,
+            (unsigned long)rst->rst.ssrc);
+    }
     return PyUnicode_FromString("FrameWrapper");
 }
 
@@ -701,6 +785,19 @@ build_wrapper_ers(struct rtp_frame *fp)
     return PyFrameWrapper_NewSteal(ers_obj, NULL, NULL, NULL);
 }
 
+static PyObject *
+build_wrapper_nonrtp(struct rtp_frame *fp)
+{
+    PyObject *rst_obj;
+
+    if (fp->type != RFT_RST)
+        return build_wrapper_ers(fp);
+    rst_obj = PyRSTFrame_FromRst(&fp->rst);
+    if (rst_obj == NULL)
+        return NULL;
+    return PyFrameWrapper_NewSteal(rst_obj, NULL, NULL, NULL);
+}
+
 static PyRtpJBufRef *
 fetch_cached_ref(PyRtpJBuf *self, const unsigned char *ptr, PyRtpJBufRef *out)
 {
@@ -799,7 +896,7 @@ process_ready_list(PyRtpJBuf *self, struct rtp_frame *fp, PyObject *input_bytes,
             wrapper = build_wrapper_rtp(fp, refp->data, refp->opaque);
             rtpjbuf_frame_dtor(fp);
         } else {
-            wrapper = build_wrapper_ers(fp);
+            wrapper = build_wrapper_nonrtp(fp);
         }
 
         if (wrapper == NULL) {
@@ -858,6 +955,94 @@ ensure_bytes(PyObject *obj, PyObject **out_bytes, const unsigned char **data, Py
     return 0;
 }
 
+/*
+ * Owned-copy mode: frames point into the jitter buffer's own arena, so no
+ * references to the caller's objects are kept and released frames get a
+ * fresh bytes object.
+ */
+static void
+owned_drop_list(PyRtpJBuf *self, struct rtp_frame *fp)
+{
+    while (fp != NULL) {
+        struct rtp_frame *next = fp->next;
+        if (fp->type == RFT_RTP) {
+            self->dropped += 1;
+            rtpjbuf_frame_dtor(fp);
+        }
+        fp = next;
+    }
+}
+
+static PyObject *
+owned_ready_list(PyRtpJBuf *self, struct rtp_frame *fp)
+{
+    PyObject *ready_list = PyList_New(0);
+    if (ready_list == NULL) {
+        owned_drop_list(self, fp);
+        return NULL;
+    }
+
+    while (fp != NULL) {
+        struct rtp_frame *next = fp->next;
+        PyObject *wrapper = NULL;
+
+        if (fp->type == RFT_RTP) {
+            PyObject *data_obj = PyBytes_FromStringAndSize((const char *)fp->rtp.data,
+                rtpjbuf_frame_size(fp));
+            if (data_obj != NULL) {
+                Py_INCREF(Py_None);
+                wrapper = build_wrapper_rtp(fp, data_obj, Py_None);
+            }
+            rtpjbuf_frame_dtor(fp);
+        } else {
+            wrapper = build_wrapper_nonrtp(fp);
+        }
+
+        if (wrapper == NULL || PyList_Append(ready_list, wrapper) != 0) {
+            Py_XDECREF(wrapper);
+            owned_drop_list(self, next);
+            Py_DECREF(ready_list);
+            return NULL;
+        }
+        Py_DECREF(wrapper);
+        fp = next;
+    }
+    return ready_list;
+}
+
+static PyObject *
+PyRtpJBuf_udp_in_owned(PyRtpJBuf *self, PyObject *data_obj, PyObject *input_opaque,
+    unsigned long long arrival_ns)
+{
+    Py_buffer view;
+    struct rjb_udp_in_r ruir;
+
+    if (input_opaque != Py_None) {
+        PyErr_SetString(PyExc_ValueError, "udp_in(): opaque is not supported in the owned-copy mode");
+        return NULL;
+    }
+    if (PyObject_GetBuffer(data_obj, &view, PyBUF_SIMPLE) != 0)
+        return NULL;
+    ruir = rtpjbuf_udp_in_at(self->jb, view.buf, (size_t)view.len, arrival_ns);
+    /* Copied already, caller is free to reuse the buffer */
+    PyBuffer_Release(&view);
+    if (ruir.mux != RTP_MUX_RTP && ruir.mux != RTP_MUX_UNKN) {
+        self->bypassed += 1;
+        return PyList_New(0);
+    }
+    if (ruir.error != 0) {
+        owned_drop_list(self, ruir.drop);
+        if (ruir.error < RTP_PARSER_OK || ruir.error == RJB_E2BIG) {
+            PyErr_Format(RTPParseError, "rtpjbuf_udp_in(): error %d", ruir.error);
+            return NULL;
+        }
+        PyErr_Format(PyExc_RuntimeError, "rtpjbuf_udp_in(): error %d", ruir.error);
+        return NULL;
+    }
+    owned_drop_list(self, ruir.drop);
+    return owned_ready_list(self, ruir.ready);
+}
+
 static PyObject *
 PyRtpJBuf_udp_in(PyRtpJBuf *self, PyObject *args)
 {
@@ -869,17 +1054,26 @@ PyRtpJBuf_udp_in(PyRtpJBuf *self, PyObject *args)
     struct rjb_udp_in_r ruir;
     PyObject *ready_list = NULL;
     int retained = 1;
+    unsigned long long arrival_ns = 0;
 
-    if (!PyArg_ParseTuple(args, "O|O:udp_in", &data_obj, &input_opaque))
+    if (!PyArg_ParseTuple(args, "O|OK:udp_in", &data_obj, &input_opaque, &arrival_ns))
         return NULL;
     if (self->jb == NULL) {
         PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
         return NULL;
     }
+    if (self->mtu != 0)
+        return PyRtpJBuf_udp_in_owned(self, data_obj, input_opaque, arrival_ns);
     if (ensure_bytes(data_obj, &input_bytes, &data, &size) != 0)
         return NULL;
 
-    ruir = rtpjbuf_udp_in(self->jb, data, (size_t)size);
+    ruir = rtpjbuf_udp_in_at(self->jb, data, (size_t)size, arrival_ns);
+    if (ruir.mux != RTP_MUX_RTP && ruir.mux != RTP_MUX_UNKN) {
+        /* Not an RTP, bypassed the jitter buffer */
+        self->bypassed += 1;
+        Py_DECREF(input_bytes);
+        return PyList_New(0);
+    }
     if (ruir.error != 0) {
         if (ruir.drop != NULL) {
             process_drop_list(self, ruir.drop, data);
@@ -910,6 +1104,267 @@ PyRtpJBuf_udp_in(PyRtpJBuf *self, PyObject *args)
     return ready_list;
 }
 
+typedef struct {
+    PyObject **bytes;
+    PyObject *opaques;
+    const unsigned char **data;
+    size_t *sizes;
+    int *errors;
+    char *used;
+    uint64_t *arrival_ns;
+    Py_buffer *views;
+    Py_ssize_t n;
+} PyRtpJBufBatch;
+
+/*
+ * Frames coming from the batch itself borrow its references, the rest were
+ * stashed in the cache by an earlier call. The same object can be passed
+ * more than once, dropped duplicate is always the later copy so drops are
+ * matched from the end.
+ */
+static PyRtpJBufRef *
+fetch_batch_ref(PyRtpJBuf *self, const PyRtpJBufBatch *bp, const unsigned char *ptr,
+    int from_end, PyRtpJBufRef *out, int *from_batch)
+{
+    for (Py_ssize_t j = 0; j < bp->n; j++) {
+        Py_ssize_t i = from_end ? bp->n - 1 - j : j;
+        if (bp->data[i] != ptr || bp->used[i] || bp->errors[i] != 0)
+            continue;
+        bp->used[i] = 1;
+        out->data = bp->bytes[i];
+        out->opaque = (bp->opaques != NULL) ?
+            PySequence_Fast_GET_ITEM(bp->opaques, i) : Py_None;
+        out->ptr = ptr;
+        *from_batch = 1;
+        return out;
+    }
+    *from_batch = 0;
+    return fetch_cached_ref(self, ptr, out);
+}
+
+static void
+process_drop_list_many(PyRtpJBuf *self, const PyRtpJBufBatch *bp, struct rtp_frame *fp)
+{
+    while (fp != NULL) {
+        struct rtp_frame *next = fp->next;
+        if (fp->type == RFT_RTP) {
+            PyRtpJBufRef ref;
+            int from_batch;
+            self->dropped += 1;
+            fetch_batch_ref(self, bp, fp->rtp.data, 1, &ref, &from_batch);
+            if (!from_batch) {
+                Py_XDECREF(ref.data);
+                Py_XDECREF(ref.opaque);
+            }
+            rtpjbuf_frame_dtor(fp);
+        }
+        fp = next;
+    }
+}
+
+static PyObject *
+process_ready_list_many(PyRtpJBuf *self, const PyRtpJBufBatch *bp, struct rtp_frame *fp)
+{
+    PyObject *ready_list = PyList_New(0);
+    if (ready_list == NULL) {
+        process_drop_list_many(self, bp, fp);
+        return NULL;
+    }
+
+    while (fp != NULL) {
+        struct rtp_frame *next = fp->next;
+        PyObject *wrapper = NULL;
+
+        if (fp->type == RFT_RTP) {
+            PyRtpJBufRef ref;
+            int from_batch;
+            fetch_batch_ref(self, bp, fp->rtp.data, 0, &ref, &from_batch);
+            if (from_batch) {
+                Py_INCREF(ref.data);
+                Py_INCREF(ref.opaque);
+            }
+            wrapper = build_wrapper_rtp(fp, ref.data, ref.opaque);
+            rtpjbuf_frame_dtor(fp);
+        } else {
+            wrapper = build_wrapper_nonrtp(fp);
+        }
+
+        if (wrapper == NULL || PyList_Append(ready_list, wrapper) != 0) {
+            Py_XDECREF(wrapper);
+            process_drop_list_many(self, bp, next);
+            Py_DECREF(ready_list);
+            return NULL;
+        }
+        Py_DECREF(wrapper);
+        fp = next;
+    }
+    return ready_list;
+}
+
+static PyObject *
+PyRtpJBuf_udp_in_many(PyRtpJBuf *self, PyObject *args)
+{
+    PyObject *pkts_obj = NULL;
+    PyObject *opaques_obj = Py_None;
+    PyObject *arrival_obj = Py_None;
+    PyObject *seq = NULL;
+    PyObject *ready_list = NULL;
+    PyObject *err_list = NULL;
+    PyObject *rval = NULL;
+    PyRtpJBufBatch batch = { 0 };
+    Py_ssize_t i, nconv = 0, size;
+    struct rjb_udp_in_r ruir;
+
+    if (!PyArg_ParseTuple(args, "O|OO:udp_in_many", &pkts_obj, &opaques_obj, &arrival_obj))
+        return NULL;
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return NULL;
+    }
+    seq = PySequence_Fast(pkts_obj, "udp_in_many() expects a sequence of packets");
+    if (seq == NULL)
+        return NULL;
+    batch.n = PySequence_Fast_GET_SIZE(seq);
+    if (opaques_obj != Py_None) {
+        batch.opaques = PySequence_Fast(opaques_obj, "udp_in_many() expects a sequence of opaques");
+        if (batch.opaques == NULL)
+            goto out;
+        if (PySequence_Fast_GET_SIZE(batch.opaques) != batch.n) {
+            PyErr_SetString(PyExc_ValueError, "udp_in_many(): opaques length mismatch");
+            goto out;
+        }
+        if (self->mtu != 0) {
+            PyErr_SetString(PyExc_ValueError, "udp_in_many(): opaques are not supported in the owned-copy mode");
+            goto out;
+        }
+    }
+    if (batch.n > UINT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "udp_in_many(): too many packets");
+        goto out;
+    }
+    batch.bytes = PyMem_Calloc(batch.n + 1, sizeof(*batch.bytes));
+    batch.data = PyMem_Calloc(batch.n + 1, sizeof(*batch.data));
+    batch.sizes = PyMem_Calloc(batch.n + 1, sizeof(*batch.sizes));
+    batch.errors = PyMem_Calloc(batch.n + 1, sizeof(*batch.errors));
+    batch.used = PyMem_Calloc(batch.n + 1, sizeof(*batch.used));
+    if (batch.bytes == NULL || batch.data == NULL || batch.sizes == NULL ||
+      batch.errors == NULL || batch.used == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    if (self->mtu != 0) {
+        batch.views = PyMem_Calloc(batch.n + 1, sizeof(*batch.views));
+        if (batch.views == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+    }
+    if (arrival_obj != Py_None) {
+        /* Either a single timestamp for the whole batch or one per packet */
+        batch.arrival_ns = PyMem_Calloc(batch.n + 1, sizeof(*batch.arrival_ns));
+        if (batch.arrival_ns == NULL) {
+            PyErr_NoMemory();
+            goto out;
+        }
+        if (PyLong_Check(arrival_obj)) {
+            unsigned long long ts = PyLong_AsUnsignedLongLong(arrival_obj);
+            if (PyErr_Occurred())
+                goto out;
+            for (i = 0; i < batch.n; i++)
+                batch.arrival_ns[i] = ts;
+        } else {
+            PyObject *aseq = PySequence_Fast(arrival_obj, "udp_in_many() expects an int or a sequence of arrival times");
+            if (aseq == NULL)
+                goto out;
+            if (PySequence_Fast_GET_SIZE(aseq) != batch.n) {
+                Py_DECREF(aseq);
+                PyErr_SetString(PyExc_ValueError, "udp_in_many(): arrival_ns length mismatch");
+                goto out;
+            }
+            for (i = 0; i < batch.n; i++) {
+                batch.arrival_ns[i] = PyLong_AsUnsignedLongLong(PySequence_Fast_GET_ITEM(aseq, i));
+                if (PyErr_Occurred()) {
+                    Py_DECREF(aseq);
+                    goto out;
+                }
+            }
+            Py_DECREF(aseq);
+        }
+    }
+    for (nconv = 0; nconv < batch.n; nconv++) {
+        if (batch.views != NULL) {
+            if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, nconv),
+              &batch.views[nconv], PyBUF_SIMPLE) != 0)
+                goto out;
+            batch.data[nconv] = batch.views[nconv].buf;
+            batch.sizes[nconv] = (size_t)batch.views[nconv].len;
+            continue;
+        }
+        if (ensure_bytes(PySequence_Fast_GET_ITEM(seq, nconv), &batch.bytes[nconv],
+          &batch.data[nconv], &size) != 0)
+            goto out;
+        batch.sizes[nconv] = (size_t)size;
+    }
+
+    ruir = rtpjbuf_udp_in_many(self->jb, batch.data, batch.sizes,
+      (unsigned int)batch.n, batch.arrival_ns, batch.errors);
+    if (batch.views != NULL) {
+        owned_drop_list(self, ruir.drop);
+        ready_list = owned_ready_list(self, ruir.ready);
+    } else {
+        process_drop_list_many(self, &batch, ruir.drop);
+        ready_list = process_ready_list_many(self, &batch, ruir.ready);
+    }
+
+    /* Whatever is left from this batch is now queued in the buffer */
+    for (i = 0; i < batch.n; i++) {
+        if (batch.errors[i] == RJB_EBYPASS)
+            self->bypassed += 1;
+        if (batch.errors[i] != 0 || batch.used[i] || batch.views != NULL)
+            continue;
+        PyObject *opaque = (batch.opaques != NULL) ?
+            PySequence_Fast_GET_ITEM(batch.opaques, i) : Py_None;
+        if (store_data_ref(self, batch.bytes[i], opaque, batch.data[i]) != 0)
+            Py_CLEAR(ready_list);
+    }
+    if (ready_list == NULL)
+        goto out;
+
+    err_list = PyList_New(0);
+    if (err_list == NULL)
+        goto out;
+    for (i = 0; i < batch.n; i++) {
+        if (batch.errors[i] == 0)
+            continue;
+        PyObject *t = Py_BuildValue("(ni)", i, batch.errors[i]);
+        if (t == NULL || PyList_Append(err_list, t) != 0) {
+            Py_XDECREF(t);
+            goto out;
+        }
+        Py_DECREF(t);
+    }
+    rval = PyTuple_Pack(2, ready_list, err_list);
+out:
+    Py_XDECREF(ready_list);
+    Py_XDECREF(err_list);
+    for (i = 0; i < nconv; i++) {
+        if (batch.views != NULL)
+            PyBuffer_Release(&batch.views[i]);
+        else
+            Py_DECREF(batch.bytes[i]);
+    }
+    PyMem_Free(batch.views);
+    PyMem_Free(batch.bytes);
+    PyMem_Free(batch.data);
+    PyMem_Free(batch.sizes);
+    PyMem_Free(batch.errors);
+    PyMem_Free(batch.used);
+    PyMem_Free(batch.arrival_ns);
+    Py_XDECREF(batch.opaques);
+    Py_DECREF(seq);
+    return rval;
+}
+
 static PyObject *
 PyRtpJBuf_flush(PyRtpJBuf *self, PyObject *args)
 {
@@ -924,11 +1379,64 @@ PyRtpJBuf_flush(PyRtpJBuf *self, PyObject *args)
     }
 
     ruir = rtpjbuf_flush(self->jb);
+    if (self->mtu != 0) {
+        owned_drop_list(self, ruir.drop);
+        return owned_ready_list(self, ruir.ready);
+    }
     ready_list = process_ready_list(self, ruir.ready, Py_None, Py_None, NO_INPUT_PTR);
     process_drop_list(self, ruir.drop, NO_INPUT_PTR);
     return ready_list;
 }
 
+static PyObject *
+PyRtpJBuf_set_pull(PyRtpJBuf *self, PyObject *args)
+{
+    unsigned int delay_ms, max_hold_ms;
+
+    if (!PyArg_ParseTuple(args, "II:set_pull", &delay_ms, &max_hold_ms))
+        return NULL;
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return NULL;
+    }
+    rtpjbuf_set_pull(self->jb, delay_ms, max_hold_ms);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpJBuf_set_restart(PyRtpJBuf *self, PyObject *args)
+{
+    unsigned int flags, probation = 0;
+
+    if (!PyArg_ParseTuple(args, "I|I:set_restart", &flags, &probation))
+        return NULL;
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return NULL;
+    }
+    rtpjbuf_set_restart(self->jb, flags, probation);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpJBuf_pull(PyRtpJBuf *self, PyObject *args)
+{
+    unsigned long long now_ns;
+    struct rjb_udp_in_r ruir;
+
+    if (!PyArg_ParseTuple(args, "K:pull", &now_ns))
+        return NULL;
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return NULL;
+    }
+
+    ruir = rtpjbuf_pull(self->jb, now_ns);
+    if (self->mtu != 0)
+        return owned_ready_list(self, ruir.ready);
+    return process_ready_list(self, ruir.ready, Py_None, Py_None, NO_INPUT_PTR);
+}
+
 static void
 PyRtpJBuf_dealloc(PyRtpJBuf *self)
 {
@@ -938,12 +1446,21 @@ PyRtpJBuf_dealloc(PyRtpJBuf *self)
             struct rjb_udp_in_r ruir = rtpjbuf_flush(self->jb);
             if (ruir.ready == NULL && ruir.drop == NULL)
                 break;
+            if (self->mtu != 0) {
+                owned_drop_list(self, ruir.ready);
+                owned_drop_list(self, ruir.drop);
+                continue;
+            }
             process_drop_list(self, ruir.ready, NO_INPUT_PTR);
             process_drop_list(self, ruir.drop, NO_INPUT_PTR);
         }
         rtpjbuf_dtor(self->jb);
         self->jb = NULL;
     }
+    if (self->pm != NULL) {
+        PyMem_Free(self->pm);
+        self->pm = NULL;
+    }
     if (self->refs != NULL) {
         for (unsigned int i = 0; i < self->capacity; i++) {
             Py_XDECREF(self->refs[i].data);
@@ -968,16 +1485,19 @@ static int
 PyRtpJBuf_init(PyRtpJBuf *self, PyObject *args, PyObject *kwds)
 {
     unsigned int capacity = 0;
-    if (!PyArg_ParseTuple(args, "I:RtpJBuf", &capacity))
+    unsigned int mtu = 0;
+    if (!PyArg_ParseTuple(args, "I|I:RtpJBuf", &capacity, &mtu))
         return -1;
     (void)kwds;
-    self->jb = rtpjbuf_ctor(capacity);
+    self->jb = rtpjbuf_ctor_owned(capacity, mtu);
     if (self->jb == NULL) {
         PyErr_SetString(PyExc_RuntimeError, "rtpjbuf_ctor() failed");
         return -1;
     }
     self->capacity = capacity;
+    self->mtu = mtu;
     self->dropped = 0;
+    self->bypassed = 0;
     self->refs = PyMem_Calloc(capacity, sizeof(*self->refs));
     if (self->refs == NULL) {
         PyErr_SetString(PyExc_RuntimeError, "RtpJBuf reference buffer allocation failed");
@@ -992,14 +1512,183 @@ PyRtpJBuf_init(PyRtpJBuf *self, PyObject *args, PyObject *kwds)
     return 0;
 }
 
+static PyObject *
+PyRtpJBuf_set_rtpmap(PyRtpJBuf *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"pt", "rtpmap", "fmtp", NULL};
+    int pt;
+    const char *rtpmap;
+    const char *fmtp = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "is|z:set_rtpmap", kwlist,
+        &pt, &rtpmap, &fmtp))
+        return NULL;
+
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return NULL;
+    }
+    if (self->pm == NULL) {
+        self->pm = PyMem_Malloc(sizeof(*self->pm));
+        if (self->pm == NULL)
+            return PyErr_NoMemory();
+        rtp_ptmap_init(self->pm);
+        rtpjbuf_set_ptmap(self->jb, self->pm);
+    }
+    if (rtp_ptmap_set(self->pm, pt, rtpmap, fmtp) != 0) {
+        PyErr_SetString(PyExc_ValueError, "invalid payload type or rtpmap");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpJBuf_set_adaptive(PyRtpJBuf *self, PyObject *args)
+{
+    unsigned int min_ms, max_ms;
+
+    if (!PyArg_ParseTuple(args, "II:set_adaptive", &min_ms, &max_ms))
+        return NULL;
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return NULL;
+    }
+    if (rtpjbuf_set_adaptive(self->jb, min_ms, max_ms) != 0) {
+        PyErr_SetString(PyExc_ValueError, "set_adaptive(): min_ms > max_ms");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static int
+PyRtpJBuf_get_delay(PyRtpJBuf *self, struct rjb_delay *dp)
+{
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return -1;
+    }
+    rtpjbuf_get_delay(self->jb, dp);
+    return 0;
+}
+
+static PyObject *PyRtpJBuf_get_jitter(PyRtpJBuf *self, void *closure) {
+    struct rjb_delay d;
+    (void)closure;
+    if (PyRtpJBuf_get_delay(self, &d) != 0)
+        return NULL;
+    return PyLong_FromUnsignedLong(d.jitter);
+}
+
+static PyObject *PyRtpJBuf_get_jitter_us(PyRtpJBuf *self, void *closure) {
+    struct rjb_delay d;
+    (void)closure;
+    if (PyRtpJBuf_get_delay(self, &d) != 0)
+        return NULL;
+    return PyLong_FromUnsignedLongLong(d.jitter_us);
+}
+
+static PyObject *PyRtpJBuf_get_target_delay(PyRtpJBuf *self, void *closure) {
+    struct rjb_delay d;
+    (void)closure;
+    if (PyRtpJBuf_get_delay(self, &d) != 0)
+        return NULL;
+    return PyLong_FromUnsignedLong(d.target_ms);
+}
+
+static PyObject *PyRtpJBuf_get_depth(PyRtpJBuf *self, void *closure) {
+    struct rjb_delay d;
+    (void)closure;
+    if (PyRtpJBuf_get_delay(self, &d) != 0)
+        return NULL;
+    return PyLong_FromUnsignedLong(d.depth);
+}
+
+static PyGetSetDef PyRtpJBuf_getset[] = {
+    {"jitter", (getter)PyRtpJBuf_get_jitter, NULL, NULL, NULL},
+    {"jitter_us", (getter)PyRtpJBuf_get_jitter_us, NULL, NULL, NULL},
+    {"target_delay", (getter)PyRtpJBuf_get_target_delay, NULL, NULL, NULL},
+    {"depth", (getter)PyRtpJBuf_get_depth, NULL, NULL, NULL},
+    {NULL}
+};
+
+static int add_count(PyObject *dict, const char *name, unsigned long long value);
+
+static int
+add_hist(PyObject *dict, const char *name, const uint64_t *hist)
+{
+    PyObject *obj = PyList_New(RJB_HIST_NBINS);
+    if (obj == NULL)
+        return -1;
+    for (int i = 0; i < RJB_HIST_NBINS; i++) {
+        PyObject *v = PyLong_FromUnsignedLongLong(hist[i]);
+        if (v == NULL) {
+            Py_DECREF(obj);
+            return -1;
+        }
+        PyList_SET_ITEM(obj, i, v);
+    }
+    if (PyDict_SetItemString(dict, name, obj) != 0) {
+        Py_DECREF(obj);
+        return -1;
+    }
+    Py_DECREF(obj);
+    return 0;
+}
+
+static PyObject *
+PyRtpJBuf_get_stats(PyRtpJBuf *self, PyObject *args)
+{
+    struct rtpjbuf_stats st;
+    PyObject *dict;
+
+    if (!PyArg_ParseTuple(args, ":get_stats"))
+        return NULL;
+    if (self->jb == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBuf handle is not initialized");
+        return NULL;
+    }
+    rtpjbuf_get_stats(self->jb, &st);
+    dict = PyDict_New();
+    if (dict == NULL)
+        return NULL;
+    if (add_count(dict, "drop_dup", st.drop.dup) != 0 ||
+      add_count(dict, "drop_late", st.drop.late) != 0 ||
+      add_count(dict, "drop_perror", st.drop.perror) != 0 ||
+      add_count(dict, "drop_stale", st.drop.stale) != 0 ||
+      add_count(dict, "drop_probation", st.drop.probation) != 0 ||
+      add_count(dict, "seq_wup", st.seq_wup) != 0 ||
+      add_count(dict, "nonrtp", st.nonrtp) != 0 ||
+      add_count(dict, "ers_count", st.ers.count) != 0 ||
+      add_count(dict, "ers_frames", st.ers.frames) != 0 ||
+      add_hist(dict, "ers_len_hist", st.ers.len_hist) != 0 ||
+      add_hist(dict, "reorder_hist", st.reorder_hist) != 0 ||
+      add_hist(dict, "late_hist", st.late_hist) != 0 ||
+      add_count(dict, "underrun", st.underrun) != 0 ||
+      add_count(dict, "restart", st.restart) != 0 ||
+      add_count(dict, "occupancy", st.occupancy) != 0 ||
+      add_count(dict, "peak", st.peak) != 0) {
+        Py_DECREF(dict);
+        return NULL;
+    }
+    return dict;
+}
+
 static PyMethodDef PyRtpJBuf_methods[] = {
     {"udp_in", (PyCFunction)PyRtpJBuf_udp_in, METH_VARARGS, NULL},
+    {"udp_in_many", (PyCFunction)PyRtpJBuf_udp_in_many, METH_VARARGS, NULL},
+    {"set_adaptive", (PyCFunction)PyRtpJBuf_set_adaptive, METH_VARARGS, NULL},
+    {"get_stats", (PyCFunction)PyRtpJBuf_get_stats, METH_VARARGS, NULL},
+    {"set_pull", (PyCFunction)PyRtpJBuf_set_pull, METH_VARARGS, NULL},
+    {"set_restart", (PyCFunction)PyRtpJBuf_set_restart, METH_VARARGS, NULL},
+    {"pull", (PyCFunction)PyRtpJBuf_pull, METH_VARARGS, NULL},
     {"flush", (PyCFunction)PyRtpJBuf_flush, METH_VARARGS, NULL},
+    {"set_rtpmap", (PyCFunction)PyRtpJBuf_set_rtpmap, METH_VARARGS | METH_KEYWORDS, NULL},
     {NULL}
 };
 
 static PyMemberDef PyRtpJBuf_members[] = {
     {"dropped", T_ULONGLONG, offsetof(PyRtpJBuf, dropped), READONLY, NULL},
+    {"bypassed", T_ULONGLONG, offsetof(PyRtpJBuf, bypassed), READONLY, NULL},
     {NULL}
 };
 
@@ -1013,7 +1702,194 @@ static PyTypeObject PyRtpJBufType = {
     .tp_dealloc = (destructor)PyRtpJBuf_dealloc,
     .tp_methods = PyRtpJBuf_methods,
     .tp_members = PyRtpJBuf_members,
+    .tp_getset = PyRtpJBuf_getset,
+};
+
+#if defined(HAVE_RTPJBUF_MGR)
+static PyObject *
+PyRtpJBufMgr_udp_in(PyRtpJBufMgr *self, PyObject *args)
+{
+    unsigned long long stream_id;
+    unsigned long long arrival_ns = 0;
+    PyObject *data_obj;
+    Py_buffer view;
+    int rval;
+
+    if (!PyArg_ParseTuple(args, "KO|K:udp_in", &stream_id, &data_obj, &arrival_ns))
+        return NULL;
+    if (self->mgr == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBufMgr handle is not initialized");
+        return NULL;
+    }
+    if (PyObject_GetBuffer(data_obj, &view, PyBUF_SIMPLE) != 0)
+        return NULL;
+    rval = rtpjbuf_mgr_udp_in(self->mgr, stream_id, view.buf, (size_t)view.len,
+        arrival_ns);
+    PyBuffer_Release(&view);
+    if (rval == RJB_ENOMEM)
+        return PyErr_NoMemory();
+    return PyBool_FromLong(rval == 0);
+}
+
+static PyObject *
+PyRtpJBufMgr_remove(PyRtpJBufMgr *self, PyObject *args)
+{
+    unsigned long long stream_id;
+    int rval;
+
+    if (!PyArg_ParseTuple(args, "K:remove", &stream_id))
+        return NULL;
+    if (self->mgr == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBufMgr handle is not initialized");
+        return NULL;
+    }
+    rval = rtpjbuf_mgr_remove(self->mgr, stream_id);
+    if (rval == RJB_ENOMEM)
+        return PyErr_NoMemory();
+    return PyBool_FromLong(rval == 0);
+}
+
+static PyObject *
+build_wrapper_mgr(struct rtpjbuf_mgr_frame *mfp)
+{
+    struct rtp_frame *fp = &mfp->frame;
+    PyObject *data_obj;
+
+    if (fp->type != RFT_RTP)
+        return build_wrapper_nonrtp(fp);
+    data_obj = PyBytes_FromStringAndSize((const char *)fp->rtp.data, mfp->size);
+    if (data_obj == NULL)
+        return NULL;
+    Py_INCREF(Py_None);
+    return build_wrapper_rtp(fp, data_obj, Py_None);
+}
+
+static PyObject *
+PyRtpJBufMgr_poll(PyRtpJBufMgr *self, PyObject *args)
+{
+    unsigned int howmany = 256;
+    struct rtpjbuf_mgr_frame **frames;
+    PyObject *out;
+    unsigned int i, n;
+
+    if (!PyArg_ParseTuple(args, "|I:poll", &howmany))
+        return NULL;
+    if (self->mgr == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBufMgr handle is not initialized");
+        return NULL;
+    }
+    if (howmany == 0)
+        return PyList_New(0);
+    frames = PyMem_Calloc(howmany, sizeof(*frames));
+    if (frames == NULL)
+        return PyErr_NoMemory();
+    n = rtpjbuf_mgr_poll(self->mgr, frames, howmany);
+    out = PyList_New(n);
+    for (i = 0; i < n; i++) {
+        PyObject *wrapper, *item;
+
+        if (out == NULL) {
+            rtpjbuf_mgr_frame_dtor(frames[i]);
+            continue;
+        }
+        wrapper = build_wrapper_mgr(frames[i]);
+        item = (wrapper == NULL) ? NULL :
+            Py_BuildValue("(KN)", (unsigned long long)frames[i]->stream_id, wrapper);
+        rtpjbuf_mgr_frame_dtor(frames[i]);
+        if (item == NULL) {
+            Py_CLEAR(out);
+            continue;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+    PyMem_Free(frames);
+    return out;
+}
+
+static PyObject *
+PyRtpJBufMgr_get_stats(PyRtpJBufMgr *self, PyObject *args)
+{
+    struct rtpjbuf_mgr_stats st;
+    PyObject *dict;
+
+    if (!PyArg_ParseTuple(args, ":get_stats"))
+        return NULL;
+    if (self->mgr == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBufMgr handle is not initialized");
+        return NULL;
+    }
+    rtpjbuf_mgr_get_stats(self->mgr, &st);
+    dict = PyDict_New();
+    if (dict == NULL)
+        return NULL;
+    if (add_count(dict, "in_full", st.in_full) != 0 ||
+      add_count(dict, "out_full", st.out_full) != 0 ||
+      add_count(dict, "perror", st.perror) != 0 ||
+      add_count(dict, "nonrtp", st.nonrtp) != 0 ||
+      add_count(dict, "drop", st.drop) != 0 ||
+      add_count(dict, "streams", st.streams) != 0) {
+        Py_DECREF(dict);
+        return NULL;
+    }
+    return dict;
+}
+
+static void
+PyRtpJBufMgr_dealloc(PyRtpJBufMgr *self)
+{
+    void *mgr = self->mgr;
+
+    if (mgr != NULL) {
+        self->mgr = NULL;
+        /* Joins the workers */
+        Py_BEGIN_ALLOW_THREADS
+        rtpjbuf_mgr_dtor(mgr);
+        Py_END_ALLOW_THREADS
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+PyRtpJBufMgr_init(PyRtpJBufMgr *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"nworkers", "capacity", "queue_size", NULL};
+    unsigned int nworkers, capacity;
+    unsigned int queue_size = 1024;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "II|I:RtpJBufMgr", kwlist,
+        &nworkers, &capacity, &queue_size))
+        return -1;
+    if (self->mgr != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpJBufMgr is already initialized");
+        return -1;
+    }
+    self->mgr = rtpjbuf_mgr_ctor(nworkers, capacity, queue_size);
+    if (self->mgr == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "rtpjbuf_mgr_ctor() failed");
+        return -1;
+    }
+    return 0;
+}
+
+static PyMethodDef PyRtpJBufMgr_methods[] = {
+    {"udp_in", (PyCFunction)PyRtpJBufMgr_udp_in, METH_VARARGS, NULL},
+    {"remove", (PyCFunction)PyRtpJBufMgr_remove, METH_VARARGS, NULL},
+    {"poll", (PyCFunction)PyRtpJBufMgr_poll, METH_VARARGS, NULL},
+    {"get_stats", (PyCFunction)PyRtpJBufMgr_get_stats, METH_VARARGS, NULL},
+    {NULL}
+};
+
+static PyTypeObject PyRtpJBufMgrType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = MODULE_NAME ".RtpJBufMgr",
+    .tp_basicsize = sizeof(PyRtpJBufMgr),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)PyRtpJBufMgr_init,
+    .tp_dealloc = (destructor)PyRtpJBufMgr_dealloc,
+    .tp_methods = PyRtpJBufMgr_methods,
 };
+#endif
 
 static int
 add_count(PyObject *dict, const char *name, unsigned long long value)
@@ -1138,6 +2014,16 @@ make_frame_type(void)
         }
         Py_DECREF(ers_val);
     }
+    {
+        PyObject *rst_val = PyLong_FromLong(RFT_RST);
+        if (rst_val == NULL)
+            goto error;
+        if (PyDict_SetItemString(dict, "RST", rst_val) != 0) {
+            Py_DECREF(rst_val);
+            goto error;
+        }
+        Py_DECREF(rst_val);
+    }
     type_obj = PyObject_CallFunctionObjArgs((PyObject *)&PyType_Type,
         name, bases, dict, NULL);
     if (type_obj == NULL)
@@ -1156,7 +2042,140 @@ error:
     return NULL;
 }
 
+static PyObject *
+PyRtpJBuf_parse_hdrext(PyObject *self, PyObject *args)
+{
+    Py_buffer data;
+    struct rtp_hdrext_iter it;
+    struct rtp_hdrext_elt elt;
+    PyObject *out = NULL;
+    int rval;
+
+    (void)self;
+    if (!PyArg_ParseTuple(args, "y*:parse_hdrext", &data))
+        return NULL;
+
+    out = PyList_New(0);
+    if (out == NULL)
+        goto out;
+    if (rtp_hdrext_iter_init(&it, data.buf, (size_t)data.len) != 0)
+        goto out;
+    while ((rval = rtp_hdrext_iter_next(&it, &elt)) > 0) {
+        PyObject *val, *item;
+
+        val = PyBytes_FromStringAndSize((const char *)elt.data, elt.len);
+        if (val == NULL) {
+            Py_CLEAR(out);
+            goto out;
+        }
+        item = Py_BuildValue("(iN)", elt.id, val);
+        if (item == NULL || PyList_Append(out, item) != 0) {
+            Py_XDECREF(item);
+            Py_CLEAR(out);
+            goto out;
+        }
+        Py_DECREF(item);
+    }
+    if (rval < 0) {
+        Py_CLEAR(out);
+        PyErr_SetString(RTPParseError, "malformed RTP header extension");
+    }
+
+out:
+    PyBuffer_Release(&data);
+    return out;
+}
+
+static PyObject *
+PyRtpJBuf_parse_batch(PyObject *self, PyObject *args)
+{
+    PyObject *pkts, *seq;
+    const unsigned char **bufs = NULL;
+    size_t *lens = NULL;
+    struct rtp_info *rinfos = NULL;
+    rtp_parser_err_t *rvals = NULL;
+    PyObject *out = NULL;
+    Py_ssize_t n;
+
+    (void)self;
+    if (!PyArg_ParseTuple(args, "O:parse_batch", &pkts))
+        return NULL;
+
+    seq = PySequence_Fast(pkts, "parse_batch() expects a sequence of bytes");
+    if (seq == NULL)
+        return NULL;
+    n = PySequence_Fast_GET_SIZE(seq);
+    if (n > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "batch is too large");
+        goto out;
+    }
+    bufs = PyMem_Calloc(n + 1, sizeof(*bufs));
+    lens = PyMem_Calloc(n + 1, sizeof(*lens));
+    rinfos = PyMem_Calloc(n + 1, sizeof(*rinfos));
+    rvals = PyMem_Calloc(n + 1, sizeof(*rvals));
+    if (bufs == NULL || lens == NULL || rinfos == NULL || rvals == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+
+        if (!PyBytes_Check(item)) {
+            PyErr_SetString(PyExc_TypeError, "parse_batch() expects a sequence of bytes");
+            goto out;
+        }
+        bufs[i] = (const unsigned char *)PyBytes_AS_STRING(item);
+        lens[i] = (size_t)PyBytes_GET_SIZE(item);
+    }
+
+    (void)rtp_packet_parse_batch(bufs, lens, (int)n, NULL, rinfos, rvals);
+
+    out = PyList_New(n);
+    if (out == NULL)
+        goto out;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *info, *item;
+
+        info = PyRTPInfo_FromInfo(&rinfos[i]);
+        if (info == NULL) {
+            Py_CLEAR(out);
+            goto out;
+        }
+        item = Py_BuildValue("(iN)", (int)rvals[i], info);
+        if (item == NULL) {
+            Py_CLEAR(out);
+            goto out;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+
+out:
+    PyMem_Free(rvals);
+    PyMem_Free(rinfos);
+    PyMem_Free(lens);
+    PyMem_Free(bufs);
+    Py_DECREF(seq);
+    return out;
+}
+
+static PyObject *
+PyRtpJBuf_classify(PyObject *self, PyObject *args)
+{
+    Py_buffer data;
+    enum rtp_mux_class mc;
+
+    (void)self;
+    if (!PyArg_ParseTuple(args, "y*:classify", &data))
+        return NULL;
+    mc = rtp_mux_classify(data.buf, (size_t)data.len);
+    PyBuffer_Release(&data);
+    return PyLong_FromLong(mc);
+}
+
 static PyMethodDef RtpJBuf_module_methods[] = {
+    {"classify", (PyCFunction)PyRtpJBuf_classify, METH_VARARGS, NULL},
+    {"parse_batch", (PyCFunction)PyRtpJBuf_parse_batch, METH_VARARGS, NULL},
+    {"parse_hdrext", (PyCFunction)PyRtpJBuf_parse_hdrext, METH_VARARGS, NULL},
     {"_get_dealloc_counts", (PyCFunction)PyRtpJBuf_get_dealloc_counts, METH_VARARGS, NULL},
     {"_reset_dealloc_counts", (PyCFunction)PyRtpJBuf_reset_dealloc_counts, METH_VARARGS, NULL},
     {"_set_dealloc_counting", (PyCFunction)PyRtpJBuf_set_dealloc_counting, METH_VARARGS, NULL},
@@ -1184,6 +2203,8 @@ PyInit_RtpJBuf(void)
         return NULL;
     if (PyType_Ready(&PyERSFrameType) < 0)
         return NULL;
+    if (PyType_Ready(&PyRSTFrameType) < 0)
+        return NULL;
     if (PyType_Ready(&PyRTPFrameUnionType) < 0)
         return NULL;
     if (PyType_Ready(&PyRTPFrameType) < 0)
@@ -1192,6 +2213,10 @@ PyInit_RtpJBuf(void)
         return NULL;
     if (PyType_Ready(&PyRtpJBufType) < 0)
         return NULL;
+#if defined(HAVE_RTPJBUF_MGR)
+    if (PyType_Ready(&PyRtpJBufMgrType) < 0)
+        return NULL;
+#endif
 
     module = PyModule_Create(&RtpJBuf_module);
     if (module == NULL)
@@ -1210,6 +2235,7 @@ PyInit_RtpJBuf(void)
     Py_INCREF(&PyRTPInfoType);
     Py_INCREF(&PyRTPPacketType);
     Py_INCREF(&PyERSFrameType);
+    Py_INCREF(&PyRSTFrameType);
     Py_INCREF(&PyRTPFrameUnionType);
     Py_INCREF(&PyRTPFrameType);
     Py_INCREF(&PyFrameWrapperType);
@@ -1217,13 +2243,33 @@ PyInit_RtpJBuf(void)
     PyModule_AddObject(module, "RTPInfo", (PyObject *)&PyRTPInfoType);
     PyModule_AddObject(module, "RTPPacket", (PyObject *)&PyRTPPacketType);
     PyModule_AddObject(module, "ERSFrame", (PyObject *)&PyERSFrameType);
+    PyModule_AddObject(module, "RSTFrame", (PyObject *)&PyRSTFrameType);
     PyModule_AddObject(module, "RTPFrameUnion", (PyObject *)&PyRTPFrameUnionType);
     PyModule_AddObject(module, "RTPFrame", (PyObject *)&PyRTPFrameType);
     PyModule_AddObject(module, "FrameWrapper", (PyObject *)&PyFrameWrapperType);
     PyModule_AddObject(module, "RtpJBuf", (PyObject *)&PyRtpJBufType);
+#if defined(HAVE_RTPJBUF_MGR)
+    Py_INCREF(&PyRtpJBufMgrType);
+    PyModule_AddObject(module, "RtpJBufMgr", (PyObject *)&PyRtpJBufMgrType);
+#endif
 
     PyModule_AddIntConstant(module, "RTP_PARSER_OK", RTP_PARSER_OK);
     PyModule_AddIntConstant(module, "RJB_ENOMEM", RJB_ENOMEM);
+    PyModule_AddIntConstant(module, "RJB_HIST_NBINS", RJB_HIST_NBINS);
+    PyModule_AddIntConstant(module, "RJB_EBYPASS", RJB_EBYPASS);
+    PyModule_AddIntConstant(module, "RJB_E2BIG", RJB_E2BIG);
+    PyModule_AddIntConstant(module, "RJB_RST_SSRC", RJB_RST_SSRC);
+    PyModule_AddIntConstant(module, "RJB_RST_SEQ", RJB_RST_SEQ);
+#if defined(HAVE_RTPJBUF_MGR)
+    PyModule_AddIntConstant(module, "RJB_EFULL", RJB_EFULL);
+#endif
+    PyModule_AddIntConstant(module, "RTP_MUX_UNKN", RTP_MUX_UNKN);
+    PyModule_AddIntConstant(module, "RTP_MUX_RTP", RTP_MUX_RTP);
+    PyModule_AddIntConstant(module, "RTP_MUX_RTCP", RTP_MUX_RTCP);
+    PyModule_AddIntConstant(module, "RTP_MUX_STUN", RTP_MUX_STUN);
+    PyModule_AddIntConstant(module, "RTP_MUX_ZRTP", RTP_MUX_ZRTP);
+    PyModule_AddIntConstant(module, "RTP_MUX_DTLS", RTP_MUX_DTLS);
+    PyModule_AddIntConstant(module, "RTP_MUX_TURN", RTP_MUX_TURN);
 
     return module;
 }
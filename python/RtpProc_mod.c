@@ -28,8 +28,6 @@ typedef enum {
     CMD_SHUTDOWN,
 } ProcCommandType;
 
-typedef rtp_sync_waiter ProcCmdWaiter;
-
 typedef struct {
     PyObject *type;
     PyObject *value;
@@ -39,7 +37,8 @@ typedef struct {
 typedef struct proc_cmd {
     ProcCommandType type;
     struct proc_cmd *next;
-    ProcCmdWaiter *waiter;
+    rtp_sync_completion *done;
+    PyObject *done_ref;
     union {
         struct {
             uint64_t id;
@@ -67,18 +66,13 @@ typedef struct {
     int worker_running;
     int mutex_inited;
     int cond_inited;
-    int cmd_waiter_inited;
-    int cmd_waiter_busy;
     int shutdown_queued;
     int accepting_commands;
     uint64_t next_channel_id;
     clockid_t cmd_cv_clock;
     pthread_mutex_t cmd_lock;
     pthread_cond_t cmd_cv;
-    ProcCmdWaiter cmd_waiter;
-    ProcCmd *cmd_head;
-    ProcCmd *cmd_tail;
-    py_exc_info close_exc;
+    rtp_sync_cmdq cmdq;
     ProcChannelState *channels;
     size_t channels_cap;
     size_t channels_active;
@@ -90,6 +84,8 @@ typedef struct {
     PyObject *proc_obj;
     uint64_t id;
     int closed;
+    rtp_sync_completion done;
+    py_exc_info close_exc;
 } PyRtpProcChannel;
 
 static PyTypeObject PyRtpProcType;
@@ -139,17 +135,6 @@ monotonic_deadline_to_cmd_clock(PyRtpProc *self, uint64_t monotonic_deadline,
     return cmd_now + wait_ns;
 }
 
-static rtp_sync_cmdq
-proc_cmdq_ctx(PyRtpProc *self)
-{
-    rtp_sync_cmdq ctx = {
-        .head = (void **)&self->cmd_head,
-        .tail = (void **)&self->cmd_tail,
-        .next_off = offsetof(ProcCmd, next),
-    };
-    return ctx;
-}
-
 static rtp_sync_cond_ctx
 proc_cmdcv_ctx(PyRtpProc *self)
 {
@@ -251,14 +236,15 @@ channel_set_callback_exception(ProcChannelState *ch, py_exc_info *exc)
 }
 
 static void
-proc_clear_close_exception(PyRtpProc *self)
+proc_channel_clear_close_exception(PyRtpProcChannel *self)
 {
     assert(self != NULL);
     py_exc_info_clear(&self->close_exc);
 }
 
 static void
-proc_set_close_exception_steal(PyRtpProc *self, py_exc_info *exc)
+proc_channel_set_close_exception_steal(PyRtpProcChannel *self,
+    py_exc_info *exc)
 {
     PyGILState_STATE gstate;
 
@@ -266,14 +252,14 @@ proc_set_close_exception_steal(PyRtpProc *self, py_exc_info *exc)
     assert(exc != NULL);
 
     gstate = PyGILState_Ensure();
-    proc_clear_close_exception(self);
+    proc_channel_clear_close_exception(self);
     self->close_exc = *exc;
     py_exc_info_init(exc);
     PyGILState_Release(gstate);
 }
 
 static int
-proc_pop_close_exception(PyRtpProc *self, py_exc_info *exc_out)
+proc_channel_pop_close_exception(PyRtpProcChannel *self, py_exc_info *exc_out)
 {
     assert(self != NULL);
     assert(exc_out != NULL);
@@ -312,49 +298,6 @@ raise_channel_proc_error_from(py_exc_info *cause_exc)
     return -1;
 }
 
-static void
-proc_waiter_release(PyRtpProc *self)
-{
-    if (self == NULL || !self->mutex_inited)
-        return;
-    if (pthread_mutex_lock(&self->cmd_lock) == 0) {
-        self->cmd_waiter_busy = 0;
-        pthread_mutex_unlock(&self->cmd_lock);
-    }
-}
-
-static int
-proc_waiter_acquire(PyRtpProc *self, ProcCmdWaiter **out_waiter)
-{
-    assert(self != NULL);
-    assert(out_waiter != NULL);
-
-    if (!self->cmd_waiter_inited) {
-        PyErr_SetString(PyExc_RuntimeError, "RtpProc waiter is not initialized");
-        return -1;
-    }
-    if (pthread_mutex_lock(&self->cmd_lock) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "failed to lock command queue");
-        return -1;
-    }
-    if (self->cmd_waiter_busy) {
-        pthread_mutex_unlock(&self->cmd_lock);
-        PyErr_SetString(PyExc_RuntimeError,
-            "another synchronous command is already in progress");
-        return -1;
-    }
-    self->cmd_waiter_busy = 1;
-    pthread_mutex_unlock(&self->cmd_lock);
-
-    if (rtp_sync_waiter_reset(&self->cmd_waiter) != 0) {
-        proc_waiter_release(self);
-        PyErr_SetString(PyExc_RuntimeError, "failed to reset command waiter");
-        return -1;
-    }
-    *out_waiter = &self->cmd_waiter;
-    return 0;
-}
-
 static void
 unschedule_channel(PyRtpProc *self, ProcChannelState *ch)
 {
@@ -613,6 +556,16 @@ out:
     return ok ? 0 : -1;
 }
 
+static int
+command_holds_refs(const ProcCmd *cmd)
+{
+    if (cmd->done_ref != NULL)
+        return 1;
+    if (cmd->type == CMD_ADD_CHANNEL)
+        return (cmd->u.add_channel.proc_in_cb != NULL);
+    return 0;
+}
+
 static void
 free_command(ProcCmd *cmd)
 {
@@ -624,6 +577,10 @@ free_command(ProcCmd *cmd)
             cmd->u.add_channel.proc_in_cb = NULL;
         }
     }
+    if (cmd->done_ref != NULL) {
+        py_xdecref_on_worker(cmd->done_ref);
+        cmd->done_ref = NULL;
+    }
     free(cmd);
 }
 
@@ -637,11 +594,28 @@ free_command_list(ProcCmd *head)
     }
 }
 
+static void
+push_command(PyRtpProc *self, ProcCmd *cmd)
+{
+    if (!rtp_sync_cmdq_push(&self->cmdq, cmd))
+        return;
+    /*
+     * Taking the lock orders the signal after the worker has either seen
+     * the command or gone to sleep on the cv.
+     */
+    if (pthread_mutex_lock(&self->cmd_lock) == 0) {
+        pthread_cond_signal(&self->cmd_cv);
+        pthread_mutex_unlock(&self->cmd_lock);
+    }
+}
+
+/*
+ * Producers are Python threads holding the GIL, which is what serializes
+ * them against accepting_commands going down.
+ */
 static int
 enqueue_command(PyRtpProc *self, ProcCmd *cmd, int with_error)
 {
-    int rejected = 0;
-
     assert(self != NULL);
     assert(cmd != NULL);
     if (!self->mutex_inited || !self->cond_inited) {
@@ -651,50 +625,35 @@ enqueue_command(PyRtpProc *self, ProcCmd *cmd, int with_error)
         return -1;
     }
 
-    if (pthread_mutex_lock(&self->cmd_lock) != 0) {
-        if (with_error)
-            PyErr_SetString(PyExc_RuntimeError, "failed to lock command queue");
-        free_command(cmd);
-        return -1;
-    }
-
     if (!self->accepting_commands) {
-        rejected = 1;
-    } else {
-        rtp_sync_cmdq cmdq = proc_cmdq_ctx(self);
-        rtp_sync_cmdq_push(&cmdq, cmd);
-        pthread_cond_signal(&self->cmd_cv);
-    }
-
-    pthread_mutex_unlock(&self->cmd_lock);
-
-    if (rejected) {
         free_command(cmd);
         if (with_error)
             PyErr_SetString(PyExc_RuntimeError, "RtpProc is shutting down");
         return -1;
     }
+    push_command(self, cmd);
     return 0;
 }
 
-static ProcCmd *
-detach_commands(PyRtpProc *self)
+/*
+ * Queues a command on behalf of the channel, the command keeps the channel
+ * alive and counts against its completion until the worker is done with it.
+ * The command is consumed either way.
+ */
+static int
+proc_channel_enqueue_command(PyRtpProcChannel *self, PyRtpProc *proc,
+    ProcCmd *cmd, int with_error)
 {
-    ProcCmd *head = NULL;
-
-    assert(self != NULL);
-    if (!self->mutex_inited)
-        return NULL;
-    if (pthread_mutex_lock(&self->cmd_lock) != 0)
-        return NULL;
-
-    {
-        rtp_sync_cmdq cmdq = proc_cmdq_ctx(self);
-        head = (ProcCmd *)rtp_sync_cmdq_detach_all(&cmdq);
+    assert(cmd->done == NULL && cmd->done_ref == NULL);
+    rtp_sync_completion_get(&self->done);
+    cmd->done = &self->done;
+    cmd->done_ref = (PyObject *)self;
+    Py_INCREF(self);
+    if (enqueue_command(proc, cmd, with_error) != 0) {
+        rtp_sync_completion_put(&self->done, 0);
+        return -1;
     }
-
-    pthread_mutex_unlock(&self->cmd_lock);
-    return head;
+    return 0;
 }
 
 static int
@@ -706,10 +665,10 @@ wait_for_commands(PyRtpProc *self, uint64_t wait_until_ns, int wait_forever)
         return -1;
 
     if (wait_forever) {
-        while (self->cmd_head == NULL && rc == 0)
+        while (rtp_sync_cmdq_empty(&self->cmdq) && rc == 0)
             rc = pthread_cond_wait(&self->cmd_cv, &self->cmd_lock);
     } else {
-        while (self->cmd_head == NULL) {
+        while (rtp_sync_cmdq_empty(&self->cmdq)) {
             rtp_sync_cond_ctx cond_ctx = proc_cmdcv_ctx(self);
             rc = rtp_sync_cond_timedwait_abs_ns(&cond_ctx, wait_until_ns);
             if (rc != 0)
@@ -727,8 +686,10 @@ static void
 process_commands(PyRtpProc *self, int *shutdown_seen)
 {
     ProcCmd *cmd;
+    ProcCmd *retired = NULL, **retired_tail = &retired;
+    int retired_refs = 0;
 
-    cmd = detach_commands(self);
+    cmd = rtp_sync_cmdq_detach_all(&self->cmdq);
     while (cmd != NULL) {
         ProcCmd *next = cmd->next;
         int cmd_status = 0;
@@ -772,8 +733,9 @@ process_commands(PyRtpProc *self, int *shutdown_seen)
                 py_exc_info exc;
 
                 (void)remove_channel(self, cmd->u.remove_channel.id, &exc);
-                if (cmd->waiter != NULL && py_exc_info_has(&exc)) {
-                    proc_set_close_exception_steal(self, &exc);
+                if (cmd->done_ref != NULL && py_exc_info_has(&exc)) {
+                    proc_channel_set_close_exception_steal(
+                        (PyRtpProcChannel *)cmd->done_ref, &exc);
                 }
                 py_exc_info_clear_on_worker(&exc);
             }
@@ -782,11 +744,23 @@ process_commands(PyRtpProc *self, int *shutdown_seen)
                 *shutdown_seen = 1;
         }
 
-        if (cmd->waiter != NULL)
-            rtp_sync_waiter_complete(cmd->waiter, cmd_status);
-        free_command(cmd);
+        if (cmd->done != NULL)
+            rtp_sync_completion_put(cmd->done, cmd_status);
+        retired_refs |= command_holds_refs(cmd);
+        cmd->next = NULL;
+        *retired_tail = cmd;
+        retired_tail = &cmd->next;
         cmd = next;
     }
+
+    /* Drop the references the whole batch holds under one GIL grab */
+    if (retired_refs) {
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        free_command_list(retired);
+        PyGILState_Release(gstate);
+    } else {
+        free_command_list(retired);
+    }
 }
 
 static void *
@@ -846,7 +820,7 @@ rtp_proc_worker(void *arg)
     }
 
     clear_channels(self);
-    free_command_list(detach_commands(self));
+    free_command_list(rtp_sync_cmdq_detach_all(&self->cmdq));
     return NULL;
 }
 
@@ -859,28 +833,18 @@ rtp_proc_shutdown_internal(PyRtpProc *self)
     if (!self->worker_running)
         return 0;
 
-    if (pthread_mutex_lock(&self->cmd_lock) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "failed to lock command queue");
-        return -1;
-    }
-
     if (!self->shutdown_queued) {
         cmd = calloc(1, sizeof(*cmd));
         if (cmd == NULL) {
-            pthread_mutex_unlock(&self->cmd_lock);
             PyErr_NoMemory();
             return -1;
         }
         cmd->type = CMD_SHUTDOWN;
-        rtp_sync_cmdq cmdq = proc_cmdq_ctx(self);
-        rtp_sync_cmdq_push(&cmdq, cmd);
         self->shutdown_queued = 1;
         self->accepting_commands = 0;
-        pthread_cond_signal(&self->cmd_cv);
+        push_command(self, cmd);
     }
 
-    pthread_mutex_unlock(&self->cmd_lock);
-
     Py_BEGIN_ALLOW_THREADS
     pthread_join(self->worker, NULL);
     Py_END_ALLOW_THREADS
@@ -909,15 +873,11 @@ PyRtpProc_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     self->worker_running = 0;
     self->mutex_inited = 0;
     self->cond_inited = 0;
-    self->cmd_waiter_inited = 0;
-    self->cmd_waiter_busy = 0;
     self->shutdown_queued = 0;
     self->accepting_commands = 1;
     self->next_channel_id = 1;
     self->cmd_cv_clock = CLOCK_REALTIME;
-    self->cmd_head = NULL;
-    self->cmd_tail = NULL;
-    py_exc_info_init(&self->close_exc);
+    rtp_sync_cmdq_init(&self->cmdq, offsetof(ProcCmd, next));
     self->channels = NULL;
     self->channels_cap = 0;
     self->channels_active = 0;
@@ -931,8 +891,7 @@ PyRtpProc_init(PyRtpProc *self, PyObject *args, PyObject *kwds)
 {
     static char *kwlist[] = {NULL};
 
-    if (self->worker_running || self->mutex_inited || self->cond_inited ||
-            self->cmd_waiter_inited) {
+    if (self->worker_running || self->mutex_inited || self->cond_inited) {
         if (PyTuple_Size(args) == 0 && (kwds == NULL || PyDict_Size(kwds) == 0))
             return 0;
     }
@@ -940,8 +899,7 @@ PyRtpProc_init(PyRtpProc *self, PyObject *args, PyObject *kwds)
     if (!PyArg_ParseTupleAndKeywords(args, kwds, ":RtpProc", kwlist))
         return -1;
 
-    if (self->worker_running || self->mutex_inited || self->cond_inited ||
-            self->cmd_waiter_inited)
+    if (self->worker_running || self->mutex_inited || self->cond_inited)
         return 0;
 
     if (pthread_mutex_init(&self->cmd_lock, NULL) != 0) {
@@ -957,16 +915,10 @@ PyRtpProc_init(PyRtpProc *self, PyObject *args, PyObject *kwds)
         }
     }
     self->cond_inited = 1;
-    if (rtp_sync_waiter_init(&self->cmd_waiter) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "failed to initialize command waiter");
-        goto fail_cmd_cv;
-    }
-    self->cmd_waiter_inited = 1;
-    self->cmd_waiter_busy = 0;
 
     if (pthread_create(&self->worker, NULL, rtp_proc_worker, self) != 0) {
         PyErr_SetString(PyExc_RuntimeError, "failed to create worker thread");
-        goto fail_cmd_waiter;
+        goto fail_cmd_cv;
     }
 
     self->worker_running = 1;
@@ -974,9 +926,6 @@ PyRtpProc_init(PyRtpProc *self, PyObject *args, PyObject *kwds)
     self->shutdown_queued = 0;
     return 0;
 
-fail_cmd_waiter:
-    rtp_sync_waiter_destroy(&self->cmd_waiter);
-    self->cmd_waiter_inited = 0;
 fail_cmd_cv:
     pthread_cond_destroy(&self->cmd_cv);
     self->cond_inited = 0;
@@ -994,14 +943,8 @@ PyRtpProc_dealloc(PyRtpProc *self)
         g_rtp_proc_singleton = NULL;
     if (self->worker_running)
         (void)rtp_proc_shutdown_internal(self);
-    if (self->mutex_inited)
-        free_command_list(detach_commands(self));
+    free_command_list(rtp_sync_cmdq_detach_all(&self->cmdq));
     clear_channels(self);
-    proc_clear_close_exception(self);
-    if (self->cmd_waiter_inited) {
-        rtp_sync_waiter_destroy(&self->cmd_waiter);
-        self->cmd_waiter_inited = 0;
-    }
     if (self->cond_inited) {
         pthread_cond_destroy(&self->cmd_cv);
         self->cond_inited = 0;
@@ -1013,26 +956,68 @@ PyRtpProc_dealloc(PyRtpProc *self)
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
+static int
+on_worker_thread(PyRtpProc *proc)
+{
+    return (proc->worker_running && pthread_equal(pthread_self(), proc->worker));
+}
+
+static int
+proc_channel_wait_commands(PyRtpProcChannel *self)
+{
+    int cmd_status;
+
+    Py_BEGIN_ALLOW_THREADS
+    cmd_status = rtp_sync_completion_wait(&self->done);
+    Py_END_ALLOW_THREADS
+    return cmd_status;
+}
+
+static int
+raise_cmd_status(int cmd_status, const char *what)
+{
+    if (cmd_status == ENOMEM) {
+        PyErr_NoMemory();
+    } else {
+        PyErr_Format(PyExc_RuntimeError, "failed to %s (status=%d: %s)",
+            what, cmd_status, strerror(cmd_status));
+    }
+    return -1;
+}
+
 static PyObject *
 PyRtpProc_create_channel(PyRtpProc *self, PyObject *args, PyObject *kwds)
 {
-    static char *kwlist[] = {"proc_in", NULL};
+    static char *kwlist[] = {"proc_in", "wait", NULL};
     PyObject *proc_in = NULL;
+    int wait = 1;
     PyRtpProcChannel *channel = NULL;
     ProcCmd *cmd = NULL;
-    ProcCmdWaiter *waiter = NULL;
     int cmd_status = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O:create_channel", kwlist, &proc_in))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|p:create_channel", kwlist,
+        &proc_in, &wait))
         return NULL;
     if (!PyCallable_Check(proc_in)) {
         PyErr_SetString(PyExc_TypeError, "proc_in must be callable");
         return NULL;
     }
+    if (wait && on_worker_thread(self)) {
+        PyErr_SetString(PyExc_RuntimeError,
+            "cannot wait for the worker from its own thread");
+        return NULL;
+    }
 
     channel = PyObject_New(PyRtpProcChannel, &PyRtpProcChannelType);
     if (channel == NULL)
         return NULL;
+    if (rtp_sync_completion_init(&channel->done) != 0) {
+        PyObject_Del(channel);
+        PyErr_SetString(PyExc_RuntimeError,
+            "failed to initialize command completion");
+        return NULL;
+    }
+    py_exc_info_init(&channel->close_exc);
     channel->proc_obj = (PyObject *)self;
     Py_INCREF(self);
     channel->id = self->next_channel_id++;
@@ -1040,6 +1025,7 @@ PyRtpProc_create_channel(PyRtpProc *self, PyObject *args, PyObject *kwds)
 
     cmd = calloc(1, sizeof(*cmd));
     if (cmd == NULL) {
+        channel->closed = 1;
         Py_DECREF(channel);
         return PyErr_NoMemory();
     }
@@ -1047,23 +1033,8 @@ PyRtpProc_create_channel(PyRtpProc *self, PyObject *args, PyObject *kwds)
     cmd->u.add_channel.id = channel->id;
     cmd->u.add_channel.proc_in_cb = proc_in;
     Py_INCREF(proc_in);
-    cmd->waiter = NULL;
-
-    if (proc_waiter_acquire(self, &waiter) != 0) {
-        free_command(cmd);
-        if (!PyErr_Occurred()) {
-            PyErr_SetString(PyExc_RuntimeError,
-                "failed to acquire command waiter");
-        }
-        channel->closed = 1;
-        Py_CLEAR(channel->proc_obj);
-        Py_DECREF(channel);
-        return NULL;
-    }
-    cmd->waiter = waiter;
 
-    if (enqueue_command(self, cmd, 1) != 0) {
-        proc_waiter_release(self);
+    if (proc_channel_enqueue_command(channel, self, cmd, 1) != 0) {
         if (!PyErr_Occurred()) {
             PyErr_SetString(PyExc_RuntimeError,
                 "failed to enqueue add-channel command");
@@ -1074,23 +1045,16 @@ PyRtpProc_create_channel(PyRtpProc *self, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    Py_BEGIN_ALLOW_THREADS
-    cmd_status = rtp_sync_waiter_wait(waiter);
-    Py_END_ALLOW_THREADS
-    proc_waiter_release(self);
-
-    if (cmd_status != 0) {
-        if (cmd_status == ENOMEM) {
-            PyErr_NoMemory();
-        } else {
-            PyErr_Format(PyExc_RuntimeError,
-                "failed to add channel to worker (status=%d: %s)",
-                cmd_status, strerror(cmd_status));
+    /* Without waiting, a failure to add is reported by channel.wait() */
+    if (wait) {
+        cmd_status = proc_channel_wait_commands(channel);
+        if (cmd_status != 0) {
+            raise_cmd_status(cmd_status, "add channel to worker");
+            channel->closed = 1;
+            Py_CLEAR(channel->proc_obj);
+            Py_DECREF(channel);
+            return NULL;
         }
-        channel->closed = 1;
-        Py_CLEAR(channel->proc_obj);
-        Py_DECREF(channel);
-        return NULL;
     }
 
     return (PyObject *)channel;
@@ -1126,12 +1090,11 @@ static PyTypeObject PyRtpProcType = {
 };
 
 static int
-rtp_proc_channel_close_internal(PyRtpProcChannel *self, int with_error)
+rtp_proc_channel_close_internal(PyRtpProcChannel *self, int with_error,
+    int wait)
 {
     ProcCmd *cmd = NULL;
-    ProcCmdWaiter *waiter = NULL;
     PyRtpProc *proc;
-    int waiter_acquired = 0;
     int cmd_status = 0;
     py_exc_info exc;
 
@@ -1150,6 +1113,8 @@ rtp_proc_channel_close_internal(PyRtpProcChannel *self, int with_error)
     }
 
     proc = (PyRtpProc *)self->proc_obj;
+    if (on_worker_thread(proc))
+        wait = 0;
     cmd = calloc(1, sizeof(*cmd));
     if (cmd == NULL) {
         if (with_error)
@@ -1158,44 +1123,30 @@ rtp_proc_channel_close_internal(PyRtpProcChannel *self, int with_error)
     }
     cmd->type = CMD_REMOVE_CHANNEL;
     cmd->u.remove_channel.id = self->id;
-    cmd->waiter = NULL;
 
+    /* Only a close that can report the callback exception tracks it */
     if (with_error) {
-        proc_clear_close_exception(proc);
-        if (proc_waiter_acquire(proc, &waiter) != 0)
-            goto fail;
-        waiter_acquired = 1;
-        cmd->waiter = waiter;
-    }
-
-    if (enqueue_command(proc, cmd, with_error) != 0) {
-        if (waiter_acquired)
-            proc_waiter_release(proc);
-        if (with_error && !PyErr_ExceptionMatches(PyExc_RuntimeError))
-            return -1;
-        PyErr_Clear();
-    } else if (waiter_acquired) {
-        Py_BEGIN_ALLOW_THREADS
-        cmd_status = rtp_sync_waiter_wait(waiter);
-        Py_END_ALLOW_THREADS
-        proc_waiter_release(proc);
-
-        if (cmd_status != 0) {
-            PyErr_Format(PyExc_RuntimeError,
-                "failed to remove channel from worker (status=%d: %s)",
-                cmd_status, strerror(cmd_status));
-            return -1;
+        proc_channel_clear_close_exception(self);
+        if (proc_channel_enqueue_command(self, proc, cmd, 1) != 0) {
+            if (!PyErr_ExceptionMatches(PyExc_RuntimeError))
+                return -1;
+            PyErr_Clear();
+            wait = 0;
         }
+    } else {
+        (void)enqueue_command(proc, cmd, 0);
+        wait = 0;
     }
-
     self->closed = 1;
-    if (with_error && proc_pop_close_exception(proc, &exc))
-        return raise_channel_proc_error_from(&exc);
-    return 0;
 
-fail:
-    free_command(cmd);
-    return -1;
+    if (wait) {
+        cmd_status = proc_channel_wait_commands(self);
+        if (cmd_status != 0)
+            return raise_cmd_status(cmd_status, "remove channel from worker");
+        if (proc_channel_pop_close_exception(self, &exc))
+            return raise_channel_proc_error_from(&exc);
+    }
+    return 0;
 }
 
 static PyObject *
@@ -1212,22 +1163,52 @@ PyRtpProcChannel_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 static void
 PyRtpProcChannel_dealloc(PyRtpProcChannel *self)
 {
-    (void)rtp_proc_channel_close_internal(self, 0);
+    (void)rtp_proc_channel_close_internal(self, 0, 0);
+    proc_channel_clear_close_exception(self);
+    rtp_sync_completion_destroy(&self->done);
     Py_XDECREF(self->proc_obj);
     self->proc_obj = NULL;
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
 static PyObject *
-PyRtpProcChannel_close(PyRtpProcChannel *self, PyObject *args)
+PyRtpProcChannel_close(PyRtpProcChannel *self, PyObject *args, PyObject *kwds)
 {
-    if (!PyArg_ParseTuple(args, ":close"))
+    static char *kwlist[] = {"wait", NULL};
+    int wait = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|p:close", kwlist, &wait))
         return NULL;
-    if (rtp_proc_channel_close_internal(self, 1) != 0)
+    if (rtp_proc_channel_close_internal(self, 1, wait) != 0)
         return NULL;
     Py_RETURN_NONE;
 }
 
+static PyObject *
+PyRtpProcChannel_wait(PyRtpProcChannel *self, PyObject *args)
+{
+    int cmd_status;
+    py_exc_info exc;
+
+    if (!PyArg_ParseTuple(args, ":wait"))
+        return NULL;
+    if (self->proc_obj != NULL && on_worker_thread((PyRtpProc *)self->proc_obj)) {
+        PyErr_SetString(PyExc_RuntimeError,
+            "cannot wait for the worker from its own thread");
+        return NULL;
+    }
+    cmd_status = proc_channel_wait_commands(self);
+    if (cmd_status != 0) {
+        raise_cmd_status(cmd_status, "complete command on worker");
+        return NULL;
+    }
+    if (proc_channel_pop_close_exception(self, &exc)) {
+        raise_channel_proc_error_from(&exc);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
 static PyObject *
 PyRtpProcChannel_get_closed(PyRtpProcChannel *self, void *closure)
 {
@@ -1245,7 +1226,9 @@ PyRtpProcChannel_get_id(PyRtpProcChannel *self, void *closure)
 }
 
 static PyMethodDef PyRtpProcChannel_methods[] = {
-    {"close", (PyCFunction)PyRtpProcChannel_close, METH_VARARGS, NULL},
+    {"close", (PyCFunction)PyRtpProcChannel_close,
+        METH_VARARGS | METH_KEYWORDS, NULL},
+    {"wait", (PyCFunction)PyRtpProcChannel_wait, METH_VARARGS, NULL},
     {NULL}
 };
 
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 #include <arpa/inet.h>
@@ -26,7 +27,7 @@
 #include <Python.h>
 #include <structmember.h>
 
-#include "SPMCQueue.h"
+#include "ByteRing.h"
 #include "rtp_sync.h"
 
 #define MODULE_NAME "rtpsynth.RtpServer"
@@ -35,6 +36,24 @@
 #define CHANNEL_OUTQ_CAPACITY 32U
 _Static_assert((CHANNEL_OUTQ_CAPACITY & (CHANNEL_OUTQ_CAPACITY - 1)) == 0,
     "CHANNEL_OUTQ_CAPACITY must be a power of two");
+/* Output ring bytes per queue_size unit */
+#define CHANNEL_OUTQ_SLOT 512U
+/* Datagrams moved per socket call by the worker */
+#define RTP_IO_BATCH 16
+
+#if defined(__linux__)
+#define RTP_HAVE_MMSG 1
+#endif
+
+/*
+ * Packets are copied into the output ring, so that the worker sends and
+ * retires them without touching any Python objects. The ones too large
+ * for the ring go by reference (RtpSendItem pointer) instead.
+ */
+enum rtp_outq_tag {
+    OUTQ_INLINE = 0,
+    OUTQ_REF = 1,
+};
 
 typedef struct rtp_send_item {
     const unsigned char *data;
@@ -42,13 +61,27 @@ typedef struct rtp_send_item {
     PyObject *data_ref;
 } RtpSendItem;
 
+/*
+ * Worker-side scratch for the batched socket I/O, shared by all channels
+ * since only the worker thread does the I/O.
+ */
+typedef struct {
+    struct byte_ring_rec recs[RTP_IO_BATCH];
+    struct iovec iov[RTP_IO_BATCH];
+#if defined(RTP_HAVE_MMSG)
+    struct mmsghdr msgs[RTP_IO_BATCH];
+    struct sockaddr_storage peers[RTP_IO_BATCH];
+    unsigned char bufs[RTP_IO_BATCH][MAX_UDP_PACKET];
+#endif
+} RtpIoBatch;
+
 typedef struct rtp_channel_state {
     int fd;
     int has_target;
     struct sockaddr_storage target_addr;
     socklen_t target_len;
     PyObject *pkt_in_cb;
-    SPMCQueue *out_q;
+    ByteRing *out_q;
 } RtpChannelState;
 
 typedef enum {
@@ -59,18 +92,18 @@ typedef enum {
     CMD_STOP_WORKER,
 } RtpCommandType;
 
-typedef rtp_sync_waiter RtpCmdWaiter;
-
 typedef struct rtp_server_cmd {
     RtpCommandType type;
     struct rtp_server_cmd *next;
-    RtpCmdWaiter *waiter;
+    rtp_sync_completion *done;
+    PyObject *done_ref;
     union {
         struct {
             RtpChannelState *channel;
         } add_channel;
         struct {
             RtpChannelState *channel;
+            RtpChannelState *removed;
         } remove_channel;
         struct {
             RtpChannelState *channel;
@@ -85,16 +118,14 @@ typedef struct {
     pthread_t worker;
     int worker_running;
     int server_inited;
-    int cmd_waiter_busy;
     int shutdown_queued;
     int accepting_commands;
+    int free_on_exit;
     uint64_t tick_ns;
     clockid_t cmd_cv_clock;
     pthread_mutex_t cmd_lock;
     pthread_cond_t cmd_cv;
-    RtpCmdWaiter cmd_waiter;
-    RtpServerCmd *cmd_head;
-    RtpServerCmd *cmd_tail;
+    rtp_sync_cmdq cmdq;
     RtpChannelState **channels;
     size_t channels_cap;
     size_t channels_active;
@@ -103,6 +134,7 @@ typedef struct {
     size_t pollfds_len;
     size_t pollfds_cap;
     int pollfds_dirty;
+    RtpIoBatch *io;
 } PyRtpServer;
 
 typedef struct {
@@ -111,6 +143,7 @@ typedef struct {
     int closed;
     int has_target;
     RtpChannelState state;
+    rtp_sync_completion done;
     struct sockaddr_storage local_addr;
     socklen_t local_len;
 } PyRtpChannel;
@@ -144,17 +177,6 @@ now_ns_for_clock(clockid_t clock_id)
     return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
 }
 
-static rtp_sync_cmdq
-server_cmdq_ctx(PyRtpServer *self)
-{
-    rtp_sync_cmdq ctx = {
-        .head = (void **)&self->cmd_head,
-        .tail = (void **)&self->cmd_tail,
-        .next_off = offsetof(RtpServerCmd, next),
-    };
-    return ctx;
-}
-
 static rtp_sync_cond_ctx
 server_cmdcv_ctx(PyRtpServer *self)
 {
@@ -271,31 +293,42 @@ free_send_item(RtpSendItem *item)
     free(item);
 }
 
+static RtpSendItem *
+outq_rec_item(const struct byte_ring_rec *rec)
+{
+    RtpSendItem *item;
+
+    assert(rec->tag == OUTQ_REF && rec->len == sizeof(item));
+    memcpy(&item, rec->data, sizeof(item));
+    return item;
+}
+
 static void
-free_send_queue(SPMCQueue *queue)
+free_send_queue(ByteRing *queue)
 {
+    struct byte_ring_rec rec;
+
     assert(queue != NULL);
-    for (;;) {
-        void *obj = NULL;
-        if (!try_pop(queue, &obj))
-            break;
-        free_send_item((RtpSendItem *)obj);
+    while (byte_ring_peek(queue, &rec)) {
+        if (rec.tag == OUTQ_REF)
+            free_send_item(outq_rec_item(&rec));
+        byte_ring_consume(queue);
     }
 }
 
 static void
-destroy_send_queue(SPMCQueue **queuep)
+destroy_send_queue(ByteRing **queuep)
 {
     assert(queuep != NULL);
     assert(*queuep != NULL);
     free_send_queue(*queuep);
-    destroy_queue(*queuep);
+    destroy_byte_ring(*queuep);
     *queuep = NULL;
 }
 
 static void
 rtp_channel_state_init(RtpChannelState *channel, int fd, PyObject *pkt_in_cb,
-    SPMCQueue *out_q)
+    ByteRing *out_q)
 {
     assert(channel != NULL);
     assert(pkt_in_cb != NULL);
@@ -460,59 +493,6 @@ clear_poll_cache(PyRtpServer *self)
     self->pollfds_dirty = 0;
 }
 
-static void
-server_waiter_release(PyRtpServer *self)
-{
-    int rc;
-
-    assert(self != NULL);
-    assert(self->server_inited);
-    rc = pthread_mutex_lock(&self->cmd_lock);
-    assert(rc == 0);
-    self->cmd_waiter_busy = 0;
-    rc = pthread_mutex_unlock(&self->cmd_lock);
-    assert(rc == 0);
-}
-
-static int
-server_waiter_acquire(PyRtpServer *self, RtpCmdWaiter **out_waiter)
-{
-    int rc;
-
-    assert(self != NULL);
-    assert(out_waiter != NULL);
-
-    if (!self->server_inited) {
-        PyErr_SetString(PyExc_RuntimeError, "RtpServer is not initialized");
-        return -1;
-    }
-    rc = pthread_mutex_lock(&self->cmd_lock);
-    assert(rc == 0);
-    if (rc != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "failed to lock command queue");
-        return -1;
-    }
-    if (self->cmd_waiter_busy) {
-        rc = pthread_mutex_unlock(&self->cmd_lock);
-        assert(rc == 0);
-        PyErr_SetString(PyExc_RuntimeError,
-            "another synchronous command is already in progress");
-        return -1;
-    }
-    self->cmd_waiter_busy = 1;
-    rc = pthread_mutex_unlock(&self->cmd_lock);
-    assert(rc == 0);
-
-    if (rtp_sync_waiter_reset(&self->cmd_waiter) != 0) {
-        server_waiter_release(self);
-        PyErr_SetString(PyExc_RuntimeError, "failed to reset command waiter");
-        return -1;
-    }
-
-    *out_waiter = &self->cmd_waiter;
-    return 0;
-}
-
 static int
 refresh_poll_cache(PyRtpServer *self)
 {
@@ -562,6 +542,18 @@ refresh_poll_cache(PyRtpServer *self)
     return 0;
 }
 
+static int
+command_holds_refs(const RtpServerCmd *cmd)
+{
+    if (cmd->done_ref != NULL)
+        return 1;
+    if (cmd->type == CMD_ADD_CHANNEL)
+        return (cmd->u.add_channel.channel != NULL);
+    if (cmd->type == CMD_REMOVE_CHANNEL)
+        return (cmd->u.remove_channel.removed != NULL);
+    return 0;
+}
+
 static void
 free_command(RtpServerCmd *cmd)
 {
@@ -572,6 +564,15 @@ free_command(RtpServerCmd *cmd)
             rtp_channel_state_unref(cmd->u.add_channel.channel);
             cmd->u.add_channel.channel = NULL;
         }
+    } else if (cmd->type == CMD_REMOVE_CHANNEL) {
+        if (cmd->u.remove_channel.removed != NULL) {
+            rtp_channel_state_unref(cmd->u.remove_channel.removed);
+            cmd->u.remove_channel.removed = NULL;
+        }
+    }
+    if (cmd->done_ref != NULL) {
+        py_decref_on_worker(cmd->done_ref);
+        cmd->done_ref = NULL;
     }
     free(cmd);
 }
@@ -586,12 +587,36 @@ free_command_list(RtpServerCmd *head)
     }
 }
 
-static int
-enqueue_command(PyRtpServer *self, RtpServerCmd *cmd, int with_error)
+static void
+wake_worker(PyRtpServer *self)
 {
-    int rejected = 0;
     int rc;
 
+    /*
+     * Taking the lock orders the signal after the worker has either seen
+     * the command or gone to sleep on the cv.
+     */
+    rc = pthread_mutex_lock(&self->cmd_lock);
+    assert(rc == 0);
+    pthread_cond_signal(&self->cmd_cv);
+    rc = pthread_mutex_unlock(&self->cmd_lock);
+    assert(rc == 0);
+}
+
+static void
+push_command(PyRtpServer *self, RtpServerCmd *cmd)
+{
+    if (rtp_sync_cmdq_push(&self->cmdq, cmd))
+        wake_worker(self);
+}
+
+/*
+ * Producers are Python threads holding the GIL, which is what serializes
+ * them against accepting_commands going down.
+ */
+static int
+enqueue_command(PyRtpServer *self, RtpServerCmd *cmd, int with_error)
+{
     assert(self != NULL);
     assert(cmd != NULL);
     if (!self->server_inited) {
@@ -599,54 +624,15 @@ enqueue_command(PyRtpServer *self, RtpServerCmd *cmd, int with_error)
             PyErr_SetString(PyExc_RuntimeError, "RtpServer is not initialized");
         return -1;
     }
-
-    rc = pthread_mutex_lock(&self->cmd_lock);
-    assert(rc == 0);
-    if (rc != 0) {
-        if (with_error)
-            PyErr_SetString(PyExc_RuntimeError, "failed to lock command queue");
-        return -1;
-    }
-
     if (!self->accepting_commands) {
-        rejected = 1;
-    } else {
-        rtp_sync_cmdq cmdq = server_cmdq_ctx(self);
-        rtp_sync_cmdq_push(&cmdq, cmd);
-        pthread_cond_signal(&self->cmd_cv);
-    }
-
-    rc = pthread_mutex_unlock(&self->cmd_lock);
-    assert(rc == 0);
-
-    if (rejected) {
         if (with_error)
             PyErr_SetString(PyExc_RuntimeError, "RtpServer is shutting down");
         return -1;
     }
-
+    push_command(self, cmd);
     return 0;
 }
 
-static RtpServerCmd *
-detach_commands(PyRtpServer *self)
-{
-    RtpServerCmd *head = NULL;
-    int rc;
-
-    assert(self != NULL);
-
-    rc = pthread_mutex_lock(&self->cmd_lock);
-    assert(rc == 0);
-
-    rtp_sync_cmdq cmdq = server_cmdq_ctx(self);
-    head = (RtpServerCmd *)rtp_sync_cmdq_detach_all(&cmdq);
-
-    rc = pthread_mutex_unlock(&self->cmd_lock);
-    assert(rc == 0);
-    return head;
-}
-
 static int
 wait_for_commands(PyRtpServer *self, uint64_t wait_until_ns, int wait_forever)
 {
@@ -659,10 +645,10 @@ wait_for_commands(PyRtpServer *self, uint64_t wait_until_ns, int wait_forever)
 
     rc = 0;
     if (wait_forever) {
-        while (self->cmd_head == NULL && rc == 0)
+        while (rtp_sync_cmdq_empty(&self->cmdq) && rc == 0)
             rc = pthread_cond_wait(&self->cmd_cv, &self->cmd_lock);
     } else {
-        while (self->cmd_head == NULL) {
+        while (rtp_sync_cmdq_empty(&self->cmdq)) {
             rtp_sync_cond_ctx cond_ctx = server_cmdcv_ctx(self);
             rc = rtp_sync_cond_timedwait_abs_ns(&cond_ctx, wait_until_ns);
             if (rc != 0)
@@ -812,11 +798,51 @@ out:
     PyGILState_Release(gstate);
 }
 
+#if defined(RTP_HAVE_MMSG)
 static void
-receive_for_channel(RtpChannelState *ch, uint64_t rtime)
+receive_for_channel(PyRtpServer *self, RtpChannelState *ch, uint64_t rtime)
+{
+    RtpIoBatch *io = self->io;
+    int i, n;
+
+    assert(ch != NULL);
+    assert(ch->fd >= 0);
+
+    do {
+        PyGILState_STATE gstate;
+
+        for (i = 0; i < RTP_IO_BATCH; i++) {
+            io->iov[i].iov_base = io->bufs[i];
+            io->iov[i].iov_len = sizeof(io->bufs[i]);
+            memset(&io->msgs[i].msg_hdr, 0, sizeof(io->msgs[i].msg_hdr));
+            io->msgs[i].msg_hdr.msg_name = &io->peers[i];
+            io->msgs[i].msg_hdr.msg_namelen = sizeof(io->peers[i]);
+            io->msgs[i].msg_hdr.msg_iov = &io->iov[i];
+            io->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        n = recvmmsg(ch->fd, io->msgs, RTP_IO_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0)
+            break;
+
+        /* One GIL grab for the batch, the callbacks nest into it */
+        gstate = PyGILState_Ensure();
+        for (i = 0; i < n; i++) {
+            invoke_pkt_callback(ch->pkt_in_cb, io->bufs[i],
+                io->msgs[i].msg_len,
+                (const struct sockaddr *)&io->peers[i],
+                io->msgs[i].msg_hdr.msg_namelen, rtime);
+        }
+        PyGILState_Release(gstate);
+        /* A short batch means the socket has been drained */
+    } while (n == RTP_IO_BATCH);
+}
+#else
+static void
+receive_for_channel(PyRtpServer *self, RtpChannelState *ch, uint64_t rtime)
 {
     unsigned char buf[MAX_UDP_PACKET];
 
+    (void)self;
     assert(ch != NULL);
     assert(ch->fd >= 0);
 
@@ -837,31 +863,68 @@ receive_for_channel(RtpChannelState *ch, uint64_t rtime)
             (const struct sockaddr *)&peer, peerlen, rtime);
     }
 }
+#endif
 
+/*
+ * Output queues are lossy, a datagram that fails to go out is dropped and
+ * the rest of the batch is still attempted.
+ */
 static void
-drain_outputs(PyRtpServer *self)
+send_batch(PyRtpServer *self, RtpChannelState *ch, size_t n)
 {
+    RtpIoBatch *io = self->io;
     size_t i;
 
+#if defined(RTP_HAVE_MMSG)
+    for (i = 0; i < n; i++) {
+        memset(&io->msgs[i].msg_hdr, 0, sizeof(io->msgs[i].msg_hdr));
+        io->msgs[i].msg_hdr.msg_name = &ch->target_addr;
+        io->msgs[i].msg_hdr.msg_namelen = ch->target_len;
+        io->msgs[i].msg_hdr.msg_iov = &io->iov[i];
+        io->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (i = 0; i < n;) {
+        int sent = sendmmsg(ch->fd, io->msgs + i, (unsigned int)(n - i), 0);
+        i += (sent > 0) ? (size_t)sent : 1;
+    }
+#else
+    for (i = 0; i < n; i++) {
+        (void)sendto(ch->fd, io->iov[i].iov_base, io->iov[i].iov_len, 0,
+            (const struct sockaddr *)&ch->target_addr, ch->target_len);
+    }
+#endif
+}
+
+static void
+drain_outputs(PyRtpServer *self)
+{
+    RtpIoBatch *io = self->io;
+    size_t i, j, n;
+
     assert(self != NULL);
     for (i = 0; i < self->channels_cap; i++) {
         RtpChannelState *ch = self->channels[i];
-        int has_target;
         if (ch == NULL)
             continue;
-        has_target = ch->has_target;
-        for (;;) {
-            void *obj = NULL;
-            RtpSendItem *item;
-            if (!try_pop(ch->out_q, &obj))
-                break;
-            item = (RtpSendItem *)obj;
-            if (has_target) {
-                (void)sendto(ch->fd, item->data, item->size, 0,
-                    (const struct sockaddr *)&ch->target_addr,
-                    ch->target_len);
+        while ((n = byte_ring_peek_many(ch->out_q, io->recs,
+            RTP_IO_BATCH)) > 0) {
+            for (j = 0; j < n; j++) {
+                if (io->recs[j].tag == OUTQ_REF) {
+                    RtpSendItem *item = outq_rec_item(&io->recs[j]);
+                    io->iov[j].iov_base = (void *)item->data;
+                    io->iov[j].iov_len = item->size;
+                } else {
+                    io->iov[j].iov_base = (void *)io->recs[j].data;
+                    io->iov[j].iov_len = io->recs[j].len;
+                }
             }
-            free_send_item(item);
+            if (ch->has_target)
+                send_batch(self, ch, n);
+            for (j = 0; j < n; j++) {
+                if (io->recs[j].tag == OUTQ_REF)
+                    free_send_item(outq_rec_item(&io->recs[j]));
+            }
+            byte_ring_consume(ch->out_q);
         }
     }
 }
@@ -883,7 +946,7 @@ poll_inputs(PyRtpServer *self)
         uint64_t rtime = now_ns_monotonic();
         for (i = 0; i < nchan; i++) {
             if ((self->pollfds[i].revents & (POLLIN | POLLERR | POLLHUP)) != 0)
-                receive_for_channel(self->pollfds_index[i], rtime);
+                receive_for_channel(self, self->pollfds_index[i], rtime);
         }
     }
 
@@ -894,8 +957,10 @@ static void
 process_commands(PyRtpServer *self, int *shutdown_seen)
 {
     RtpServerCmd *cmd;
+    RtpServerCmd *retired = NULL, **retired_tail = &retired;
+    int retired_refs = 0;
 
-    cmd = detach_commands(self);
+    cmd = rtp_sync_cmdq_detach_all(&self->cmdq);
     while (cmd != NULL) {
         RtpServerCmd *next = cmd->next;
         int cmd_status = 0;
@@ -926,6 +991,7 @@ process_commands(PyRtpServer *self, int *shutdown_seen)
                 self->pollfds_dirty = 1;
             rc = pthread_mutex_unlock(&self->cmd_lock);
             assert(rc == 0);
+            cmd->u.remove_channel.removed = removed;
         } else if (cmd->type == CMD_SET_TARGET) {
             rc = pthread_mutex_lock(&self->cmd_lock);
             assert(rc == 0);
@@ -957,12 +1023,43 @@ process_commands(PyRtpServer *self, int *shutdown_seen)
                 *shutdown_seen = 1;
         }
 
-        if (cmd->waiter != NULL) {
-            rtp_sync_waiter_complete(cmd->waiter, cmd_status);
-        }
-        free_command(cmd);
+        if (cmd->done != NULL)
+            rtp_sync_completion_put(cmd->done, cmd_status);
+        retired_refs |= command_holds_refs(cmd);
+        cmd->next = NULL;
+        *retired_tail = cmd;
+        retired_tail = &cmd->next;
         cmd = next;
     }
+
+    /* Drop the references the whole batch holds under one GIL grab */
+    if (retired_refs) {
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        free_command_list(retired);
+        PyGILState_Release(gstate);
+    } else {
+        free_command_list(retired);
+    }
+}
+
+/*
+ * Counterpart of the PyRtpServer_dealloc() for the server that the worker
+ * has dropped the last reference to itself, see there.
+ */
+static void
+rtp_server_free_detached(PyRtpServer *self)
+{
+    PyGILState_STATE gstate;
+
+    free_command_list(rtp_sync_cmdq_detach_all(&self->cmdq));
+    clear_channels(self);
+    clear_poll_cache(self);
+    pthread_cond_destroy(&self->cmd_cv);
+    pthread_mutex_destroy(&self->cmd_lock);
+    free(self->io);
+    gstate = PyGILState_Ensure();
+    Py_TYPE(self)->tp_free((PyObject *)self);
+    PyGILState_Release(gstate);
 }
 
 static void *
@@ -977,7 +1074,7 @@ rtp_server_worker(void *arg)
         uint64_t now_ns;
 
         process_commands(self, &shutdown_seen);
-        if (shutdown_seen)
+        if (shutdown_seen || self->free_on_exit)
             break;
 
         if (refresh_poll_cache(self) != 0) {
@@ -1019,6 +1116,8 @@ rtp_server_worker(void *arg)
         }
     }
 
+    if (self->free_on_exit)
+        rtp_server_free_detached(self);
     return NULL;
 }
 
@@ -1026,9 +1125,8 @@ static int
 rtp_server_drop_channels_internal(PyRtpServer *self)
 {
     RtpServerCmd *cmd;
-    RtpCmdWaiter *waiter = NULL;
+    rtp_sync_completion done;
     int cmd_status = 0;
-    int rc;
 
     assert(self != NULL);
     assert(self->worker_running);
@@ -1043,32 +1141,23 @@ rtp_server_drop_channels_internal(PyRtpServer *self)
         goto e0;
     }
 
-    if (server_waiter_acquire(self, &waiter) != 0) {
+    if (rtp_sync_completion_init(&done) != 0) {
+        PyErr_SetString(PyExc_RuntimeError,
+            "failed to initialize command completion");
         goto e1;
     }
 
     cmd->type = CMD_DROP_CHANNELS;
-    cmd->waiter = waiter;
-
-    rc = pthread_mutex_lock(&self->cmd_lock);
-    assert(rc == 0);
-    if (rc != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "failed to lock command queue");
-        goto e2;
-    }
-
-    rtp_sync_cmdq cmdq = server_cmdq_ctx(self);
-    rtp_sync_cmdq_push(&cmdq, cmd);
+    cmd->done = &done;
+    rtp_sync_completion_get(&done);
 
     self->accepting_commands = 0;
-    pthread_cond_signal(&self->cmd_cv);
-    rc = pthread_mutex_unlock(&self->cmd_lock);
-    assert(rc == 0);
+    push_command(self, cmd);
 
     Py_BEGIN_ALLOW_THREADS
-    cmd_status = rtp_sync_waiter_wait(waiter);
+    cmd_status = rtp_sync_completion_wait(&done);
     Py_END_ALLOW_THREADS
-    server_waiter_release(self);
+    rtp_sync_completion_destroy(&done);
 
     if (cmd_status != 0) {
         PyErr_Format(PyExc_RuntimeError,
@@ -1078,8 +1167,6 @@ rtp_server_drop_channels_internal(PyRtpServer *self)
     }
 
     return 0;
-e2:
-    server_waiter_release(self);
 e1:
     free_command(cmd);
 e0:
@@ -1090,7 +1177,6 @@ static int
 rtp_server_stop_worker_internal(PyRtpServer *self, int with_error)
 {
     RtpServerCmd *cmd;
-    int rc;
 
     assert(self != NULL);
     assert(self->worker_running);
@@ -1102,25 +1188,10 @@ rtp_server_stop_worker_internal(PyRtpServer *self, int with_error)
         return -1;
     }
 
-    rc = pthread_mutex_lock(&self->cmd_lock);
-    assert(rc == 0);
-    if (rc != 0) {
-        free_command(cmd);
-        if (with_error)
-            PyErr_SetString(PyExc_RuntimeError, "failed to lock command queue");
-        return -1;
-    }
-
     cmd->type = CMD_STOP_WORKER;
-    {
-        rtp_sync_cmdq cmdq = server_cmdq_ctx(self);
-        rtp_sync_cmdq_push(&cmdq, cmd);
-    }
     self->shutdown_queued = 1;
     self->accepting_commands = 0;
-    pthread_cond_signal(&self->cmd_cv);
-    rc = pthread_mutex_unlock(&self->cmd_lock);
-    assert(rc == 0);
+    push_command(self, cmd);
 
     Py_BEGIN_ALLOW_THREADS
     pthread_join(self->worker, NULL);
@@ -1128,7 +1199,7 @@ rtp_server_stop_worker_internal(PyRtpServer *self, int with_error)
 
     self->worker_running = 0;
     self->accepting_commands = 0;
-    free_command_list(detach_commands(self));
+    free_command_list(rtp_sync_cmdq_detach_all(&self->cmdq));
     return 0;
 }
 
@@ -1146,13 +1217,12 @@ PyRtpServer_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 
     self->worker_running = 0;
     self->server_inited = 0;
-    self->cmd_waiter_busy = 0;
     self->shutdown_queued = 0;
     self->accepting_commands = 1;
+    self->free_on_exit = 0;
     self->tick_ns = 1000000000ULL / DEFAULT_TICK_HZ;
     self->cmd_cv_clock = CLOCK_REALTIME;
-    self->cmd_head = NULL;
-    self->cmd_tail = NULL;
+    rtp_sync_cmdq_init(&self->cmdq, offsetof(RtpServerCmd, next));
     self->channels = NULL;
     self->channels_cap = 0;
     self->channels_active = 0;
@@ -1161,6 +1231,7 @@ PyRtpServer_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     self->pollfds_len = 0;
     self->pollfds_cap = 0;
     self->pollfds_dirty = 1;
+    self->io = NULL;
     return (PyObject *)self;
 }
 
@@ -1185,9 +1256,15 @@ PyRtpServer_init(PyRtpServer *self, PyObject *args, PyObject *kwds)
     if (self->tick_ns == 0)
         self->tick_ns = 1;
 
+    self->io = malloc(sizeof(*self->io));
+    if (self->io == NULL) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+
     if (pthread_mutex_init(&self->cmd_lock, NULL) != 0) {
         PyErr_SetString(PyExc_RuntimeError, "pthread_mutex_init failed");
-        goto fail;
+        goto fail_io;
     }
 
     {
@@ -1198,15 +1275,9 @@ PyRtpServer_init(PyRtpServer *self, PyObject *args, PyObject *kwds)
         }
     }
 
-    if (rtp_sync_waiter_init(&self->cmd_waiter) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "failed to initialize command waiter");
-        goto fail_cmd_cv;
-    }
-    self->cmd_waiter_busy = 0;
-
     if (pthread_create(&self->worker, NULL, rtp_server_worker, self) != 0) {
         PyErr_SetString(PyExc_RuntimeError, "failed to create worker thread");
-        goto fail_cmd_waiter;
+        goto fail_cmd_cv;
     }
 
     self->worker_running = 1;
@@ -1215,26 +1286,45 @@ PyRtpServer_init(PyRtpServer *self, PyObject *args, PyObject *kwds)
     self->server_inited = 1;
     return 0;
 
-fail_cmd_waiter:
-    rtp_sync_waiter_destroy(&self->cmd_waiter);
 fail_cmd_cv:
     pthread_cond_destroy(&self->cmd_cv);
 fail_cmd_lock:
     pthread_mutex_destroy(&self->cmd_lock);
+fail_io:
+    free(self->io);
+    self->io = NULL;
 fail:
     return -1;
 }
 
+static int
+on_worker_thread(PyRtpServer *server)
+{
+    return pthread_equal(pthread_self(), server->worker);
+}
+
 static void
 PyRtpServer_dealloc(PyRtpServer *self)
 {
+    if (self->worker_running && on_worker_thread(self)) {
+        /*
+         * The worker has released the last channel or command holding
+         * the server, so it can't be joined from here. Let it run off
+         * the loop and free the server on its way out instead.
+         */
+        self->shutdown_queued = 1;
+        self->accepting_commands = 0;
+        self->free_on_exit = 1;
+        pthread_detach(self->worker);
+        return;
+    }
     if (self->server_inited) {
         (void)rtp_server_stop_worker_internal(self, 0);
-        free_command_list(detach_commands(self));
+        free_command_list(rtp_sync_cmdq_detach_all(&self->cmdq));
         clear_poll_cache(self);
-        rtp_sync_waiter_destroy(&self->cmd_waiter);
         pthread_cond_destroy(&self->cmd_cv);
         pthread_mutex_destroy(&self->cmd_lock);
+        free(self->io);
     }
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -1271,11 +1361,57 @@ build_udp_socket(const struct sockaddr_storage *bind_addr, socklen_t bind_len,
     return 0;
 }
 
+/*
+ * Queues a command on behalf of the channel. The command keeps the channel
+ * alive and counts against its completion until the worker is done with it.
+ */
+static int
+channel_enqueue_command(PyRtpChannel *self, PyRtpServer *server,
+    RtpServerCmd *cmd, int with_error)
+{
+    assert(cmd->done == NULL && cmd->done_ref == NULL);
+    rtp_sync_completion_get(&self->done);
+    cmd->done = &self->done;
+    cmd->done_ref = (PyObject *)self;
+    Py_INCREF(self);
+    if (enqueue_command(server, cmd, with_error) != 0) {
+        cmd->done = NULL;
+        Py_CLEAR(cmd->done_ref);
+        rtp_sync_completion_put(&self->done, 0);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+channel_wait_commands(PyRtpChannel *self)
+{
+    int cmd_status;
+
+    Py_BEGIN_ALLOW_THREADS
+    cmd_status = rtp_sync_completion_wait(&self->done);
+    Py_END_ALLOW_THREADS
+    return cmd_status;
+}
+
+static void
+raise_cmd_status(int cmd_status, const char *what)
+{
+    if (cmd_status == ENOMEM) {
+        PyErr_NoMemory();
+    } else if (cmd_status == ENOENT) {
+        PyErr_SetString(PyExc_RuntimeError, "channel is no longer present");
+    } else {
+        PyErr_Format(PyExc_RuntimeError, "failed to %s (status=%d: %s)",
+            what, cmd_status, strerror(cmd_status));
+    }
+}
+
 static PyObject *
 PyRtpServer_create_channel(PyRtpServer *self, PyObject *args, PyObject *kwds)
 {
     static char *kwlist[] = {"pkt_in", "bind_host", "bind_port", "queue_size",
-        "bind_family", NULL};
+        "bind_family", "multi_producer", "wait", NULL};
     PyObject *pkt_in = NULL;
     const char *bind_host = NULL;
     const char *effective_bind_host = NULL;
@@ -1283,6 +1419,8 @@ PyRtpServer_create_channel(PyRtpServer *self, PyObject *args, PyObject *kwds)
     unsigned long long queue_size_ull = CHANNEL_OUTQ_CAPACITY;
     size_t queue_size = CHANNEL_OUTQ_CAPACITY;
     PyObject *bind_family_obj = Py_None;
+    int multi_producer = 0;
+    int wait = 1;
     int family_hint = AF_UNSPEC;
     struct sockaddr_storage bind_addr;
     socklen_t bind_len = 0;
@@ -1290,21 +1428,26 @@ PyRtpServer_create_channel(PyRtpServer *self, PyObject *args, PyObject *kwds)
     socklen_t local_len = 0;
     int family = AF_UNSPEC;
     int fd = -1;
-    SPMCQueue *out_q = NULL;
+    ByteRing *out_q = NULL;
     RtpChannelState *state = NULL;
     RtpServerCmd *cmd = NULL;
-    RtpCmdWaiter *waiter = NULL;
     int cmd_status = 0;
     PyRtpChannel *channel = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|ziKO:create_channel", kwlist,
-        &pkt_in, &bind_host, &bind_port, &queue_size_ull, &bind_family_obj))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|ziKOpp:create_channel",
+        kwlist, &pkt_in, &bind_host, &bind_port, &queue_size_ull,
+        &bind_family_obj, &multi_producer, &wait))
         return NULL;
 
     if (!PyCallable_Check(pkt_in)) {
         PyErr_SetString(PyExc_TypeError, "pkt_in must be callable");
         return NULL;
     }
+    if (wait && self->server_inited && on_worker_thread(self)) {
+        PyErr_SetString(PyExc_RuntimeError,
+            "cannot wait for the worker from its own thread");
+        return NULL;
+    }
     if (queue_size_ull == 0) {
         PyErr_SetString(PyExc_ValueError, "queue_size must be > 0");
         return NULL;
@@ -1313,7 +1456,7 @@ PyRtpServer_create_channel(PyRtpServer *self, PyObject *args, PyObject *kwds)
         PyErr_SetString(PyExc_ValueError, "queue_size must be a power of two");
         return NULL;
     }
-    if (queue_size_ull > SIZE_MAX) {
+    if (queue_size_ull > SIZE_MAX / CHANNEL_OUTQ_SLOT) {
         PyErr_SetString(PyExc_OverflowError, "queue_size is too large");
         return NULL;
     }
@@ -1337,14 +1480,21 @@ PyRtpServer_create_channel(PyRtpServer *self, PyObject *args, PyObject *kwds)
         goto fail_fd;
     }
 
-    out_q = create_queue(queue_size);
+    out_q = create_byte_ring(queue_size * CHANNEL_OUTQ_SLOT, multi_producer);
     if (out_q == NULL) {
         PyErr_NoMemory();
         goto fail_out_q;
     }
     channel = PyObject_New(PyRtpChannel, &PyRtpChannelType);
     if (channel == NULL)
-        goto fail_fd;
+        goto fail_out_q;
+    if (rtp_sync_completion_init(&channel->done) != 0) {
+        PyObject_Del(channel);
+        channel = NULL;
+        PyErr_SetString(PyExc_RuntimeError,
+            "failed to initialize command completion");
+        goto fail_out_q;
+    }
 
     channel->server_obj = (PyObject *)self;
     Py_INCREF(self);
@@ -1368,37 +1518,21 @@ PyRtpServer_create_channel(PyRtpServer *self, PyObject *args, PyObject *kwds)
     cmd->u.add_channel.channel = state;
     Py_INCREF(channel);
 
-    if (server_waiter_acquire(self, &waiter) != 0) {
+    if (channel_enqueue_command(channel, self, cmd, 1) != 0)
         goto fail_cmd_channel_fd;
-    }
-    cmd->waiter = waiter;
-
-    if (enqueue_command(self, cmd, 1) != 0) {
-        goto fail_waiter_channel_fd;
-    }
     cmd = NULL;
 
-    Py_BEGIN_ALLOW_THREADS
-    cmd_status = rtp_sync_waiter_wait(waiter);
-    Py_END_ALLOW_THREADS
-
-    if (cmd_status != 0) {
-        if (cmd_status == ENOMEM) {
-            PyErr_NoMemory();
-        } else {
-            PyErr_Format(PyExc_RuntimeError,
-                "failed to add channel to worker (status=%d: %s)",
-                cmd_status, strerror(cmd_status));
+    /* Without waiting, a failure to add is reported by channel.wait() */
+    if (wait) {
+        cmd_status = channel_wait_commands(channel);
+        if (cmd_status != 0) {
+            raise_cmd_status(cmd_status, "add channel to worker");
+            goto fail_channel_cmd;
         }
-        goto fail_cmd;
     }
-    server_waiter_release(self);
 
     return (PyObject *)channel;
 
-fail_cmd:
-fail_waiter_channel_fd:
-    server_waiter_release(self);
 fail_cmd_channel_fd:
     if (cmd != NULL)
         free_command(cmd);
@@ -1463,20 +1597,17 @@ PyRtpChannel_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 }
 
 static int
-rtp_channel_close_internal(PyRtpChannel *self, int with_error)
+rtp_channel_close_internal(PyRtpChannel *self, int wait)
 {
     RtpServerCmd *cmd;
-    RtpCmdWaiter *waiter = NULL;
     PyRtpServer *server;
     RtpChannelState *state;
     int cmd_status = 0;
-    int wait_for_remove = 0;
 
     assert(self != NULL);
     if (self->closed) {
-        if (with_error)
-            PyErr_SetString(PyExc_RuntimeError, "channel is already closed");
-        return with_error ? -1 : 0;
+        PyErr_SetString(PyExc_RuntimeError, "channel is already closed");
+        return -1;
     }
 
     assert (self->server_obj != NULL);
@@ -1487,102 +1618,110 @@ rtp_channel_close_internal(PyRtpChannel *self, int with_error)
     assert(server->worker_running);
     if (!server->accepting_commands) {
         self->closed = 1;
-        if (with_error)
-            PyErr_SetString(PyExc_RuntimeError, "Server has been shutdown");
-        return with_error ? -1 : 0;
+        PyErr_SetString(PyExc_RuntimeError, "Server has been shutdown");
+        return -1;
     }
-    wait_for_remove = !pthread_equal(pthread_self(), server->worker);
+    if (on_worker_thread(server))
+        wait = 0;
 
     cmd = calloc(1, sizeof(*cmd));
     if (cmd == NULL) {
-        if (with_error)
-            PyErr_NoMemory();
+        PyErr_NoMemory();
         return -1;
     }
 
     cmd->type = CMD_REMOVE_CHANNEL;
     cmd->u.remove_channel.channel = state;
 
-    if (wait_for_remove) {
-        if (server_waiter_acquire(server, &waiter) != 0) {
-            if (with_error) {
-                free_command(cmd);
-                return -1;
-            }
-            PyErr_Clear();
-            wait_for_remove = 0;
-        } else {
-            cmd->waiter = waiter;
-        }
-    }
-
-    if (enqueue_command(server, cmd, with_error) != 0) {
-        if (waiter != NULL)
-            server_waiter_release(server);
+    if (channel_enqueue_command(self, server, cmd, 1) != 0) {
         free_command(cmd);
-        if (with_error && !PyErr_ExceptionMatches(PyExc_RuntimeError))
+        if (!PyErr_ExceptionMatches(PyExc_RuntimeError))
             return -1;
         PyErr_Clear();
         self->closed = 1;
         return 0;
     }
+    self->closed = 1;
 
-    if (waiter != NULL) {
-        Py_BEGIN_ALLOW_THREADS
-        cmd_status = rtp_sync_waiter_wait(waiter);
-        Py_END_ALLOW_THREADS
-        server_waiter_release(server);
-
-        if (cmd_status != 0 && with_error) {
-            PyErr_Format(PyExc_RuntimeError,
-                "failed to remove channel from worker (status=%d: %s)",
-                cmd_status, strerror(cmd_status));
+    if (wait) {
+        cmd_status = channel_wait_commands(self);
+        if (cmd_status != 0) {
+            raise_cmd_status(cmd_status, "remove channel from worker");
             return -1;
         }
-        Py_DECREF(self);
     }
-
-    self->closed = 1;
     return 0;
 }
 
+/*
+ * Every queued command and the worker's channel table hold a reference,
+ * so there is nothing left to remove by the time the channel goes away.
+ */
 static void
 PyRtpChannel_dealloc(PyRtpChannel *self)
 {
-    if (!self->closed)
-        rtp_channel_close_internal(self, 0);
+    self->closed = 1;
     rtp_channel_cleanup(self);
+    rtp_sync_completion_destroy(&self->done);
     Py_DECREF(self->server_obj);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
 static PyObject *
-PyRtpChannel_close(PyRtpChannel *self, PyObject *args)
+PyRtpChannel_close(PyRtpChannel *self, PyObject *args, PyObject *kwds)
 {
-    if (!PyArg_ParseTuple(args, ":close"))
+    static char *kwlist[] = {"wait", NULL};
+    int wait = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|p:close", kwlist, &wait))
         return NULL;
 
-    if (rtp_channel_close_internal(self, 1) != 0)
+    if (rtp_channel_close_internal(self, wait) != 0)
         return NULL;
 
     Py_RETURN_NONE;
 }
 
 static PyObject *
-PyRtpChannel_set_target(PyRtpChannel *self, PyObject *args)
+PyRtpChannel_wait(PyRtpChannel *self, PyObject *args)
 {
+    PyRtpServer *server;
+    int cmd_status;
+
+    if (!PyArg_ParseTuple(args, ":wait"))
+        return NULL;
+
+    server = (PyRtpServer *)self->server_obj;
+    if (on_worker_thread(server)) {
+        PyErr_SetString(PyExc_RuntimeError,
+            "cannot wait for the worker from its own thread");
+        return NULL;
+    }
+    cmd_status = channel_wait_commands(self);
+    if (cmd_status != 0) {
+        raise_cmd_status(cmd_status, "complete command on worker");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpChannel_set_target(PyRtpChannel *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"host", "port", "wait", NULL};
     const char *host = NULL;
     int port = 0;
+    int wait = 1;
     struct sockaddr_storage target;
     socklen_t target_len = 0;
     int family_hint = AF_UNSPEC;
     RtpServerCmd *cmd;
-    RtpCmdWaiter *waiter = NULL;
     int cmd_status;
     PyRtpServer *server;
     RtpChannelState *state;
 
-    if (!PyArg_ParseTuple(args, "si:set_target", &host, &port))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "si|p:set_target", kwlist,
+        &host, &port, &wait))
         return NULL;
 
     if (self->closed) {
@@ -1595,6 +1734,11 @@ PyRtpChannel_set_target(PyRtpChannel *self, PyObject *args)
         PyErr_SetString(PyExc_RuntimeError, "RtpServer is shutting down");
         return NULL;
     }
+    if (wait && on_worker_thread(server)) {
+        PyErr_SetString(PyExc_RuntimeError,
+            "cannot wait for the worker from its own thread");
+        return NULL;
+    }
 
     if (self->local_len > 0)
         family_hint = ((struct sockaddr *)&self->local_addr)->sa_family;
@@ -1613,37 +1757,21 @@ PyRtpChannel_set_target(PyRtpChannel *self, PyObject *args)
     cmd->u.set_target.addr = target;
     cmd->u.set_target.addrlen = target_len;
 
-    if (server_waiter_acquire(server, &waiter) != 0)
-        goto e0;
-
-    cmd->waiter = waiter;
-
-    if (enqueue_command(server, cmd, 1) != 0)
-        goto e1;
-
-    Py_BEGIN_ALLOW_THREADS
-    cmd_status = rtp_sync_waiter_wait(waiter);
-    Py_END_ALLOW_THREADS
-    server_waiter_release(server);
+    if (channel_enqueue_command(self, server, cmd, 1) != 0) {
+        free_command(cmd);
+        return NULL;
+    }
 
-    if (cmd_status != 0) {
-        if (cmd_status == ENOENT) {
-            PyErr_SetString(PyExc_RuntimeError, "channel is no longer present");
-        } else {
-            PyErr_Format(PyExc_RuntimeError,
-                "failed to set target on worker (status=%d: %s)",
-                cmd_status, strerror(cmd_status));
+    if (wait) {
+        cmd_status = channel_wait_commands(self);
+        if (cmd_status != 0) {
+            raise_cmd_status(cmd_status, "set target on worker");
+            return NULL;
         }
-        return NULL;
     }
 
     self->has_target = 1;
     Py_RETURN_NONE;
-e1:
-    server_waiter_release(server);
-e0:
-    free_command(cmd);
-    return NULL;
 }
 
 static int
@@ -1666,14 +1794,85 @@ bytes_from_obj(PyObject *obj, const unsigned char **data, Py_ssize_t *size,
     return 0;
 }
 
+static int
+channel_check_send(PyRtpChannel *self)
+{
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_RuntimeError, "channel is closed");
+        return -1;
+    }
+    if (!self->has_target) {
+        PyErr_SetString(PyExc_RuntimeError, "channel target is not set");
+        return -1;
+    }
+    if (self->state.out_q == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "channel output queue is unavailable");
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    PyObject *owner;
+    RtpSendItem *item;
+} RtpSendRef;
+
+/*
+ * Set up the output ring record for the packet: the bytes are to be copied
+ * inline, so the owner only has to live until the push, unless the packet
+ * is too large for the ring and has to go by reference.
+ */
+static int
+send_rec_from_obj(ByteRing *out_q, PyObject *data_obj,
+    struct byte_ring_rec *rec, RtpSendRef *ref)
+{
+    const unsigned char *data = NULL;
+    Py_ssize_t size = 0;
+
+    ref->item = NULL;
+    if (bytes_from_obj(data_obj, &data, &size, &ref->owner) != 0)
+        return -1;
+
+    if ((size_t)size <= byte_ring_max_len(out_q)) {
+        rec->tag = OUTQ_INLINE;
+        rec->len = (uint32_t)size;
+        rec->data = data;
+        return 0;
+    }
+    ref->item = calloc(1, sizeof(*ref->item));
+    if (ref->item == NULL) {
+        Py_CLEAR(ref->owner);
+        PyErr_NoMemory();
+        return -1;
+    }
+    ref->item->data = data;
+    ref->item->size = (size_t)size;
+    ref->item->data_ref = ref->owner;
+    ref->owner = NULL;
+    rec->tag = OUTQ_REF;
+    rec->len = sizeof(ref->item);
+    rec->data = &ref->item;
+    return 0;
+}
+
+/* Drop what the ring does not hold onto after the push */
+static void
+send_ref_release(RtpSendRef *ref, int queued)
+{
+
+    Py_CLEAR(ref->owner);
+    if (ref->item != NULL && !queued)
+        free_send_item(ref->item);
+    ref->item = NULL;
+}
+
 static PyObject *
 PyRtpChannel_send_pkt(PyRtpChannel *self, PyObject *args)
 {
     PyObject *data_obj = NULL;
-    PyObject *bytes_owner = NULL;
-    const unsigned char *data = NULL;
-    Py_ssize_t size = 0;
-    RtpSendItem *item = NULL;
+    struct byte_ring_rec rec;
+    RtpSendRef ref;
     int queued = 0;
     PyRtpServer *server;
     RtpChannelState *state;
@@ -1681,49 +1880,28 @@ PyRtpChannel_send_pkt(PyRtpChannel *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "O:send_pkt", &data_obj))
         return NULL;
 
-    if (self->closed) {
-        PyErr_SetString(PyExc_RuntimeError, "channel is closed");
+    if (channel_check_send(self) != 0)
         return NULL;
-    }
-    if (!self->has_target) {
-        PyErr_SetString(PyExc_RuntimeError, "channel target is not set");
-        return NULL;
-    }
-    if (self->state.out_q == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "channel output queue is unavailable");
-        return NULL;
-    }
     state = &self->state;
     assert(state->out_q != NULL);
 
-    if (bytes_from_obj(data_obj, &data, &size, &bytes_owner) != 0)
+    if (send_rec_from_obj(state->out_q, data_obj, &rec, &ref) != 0)
         return NULL;
 
-    item = calloc(1, sizeof(*item));
-    if (item == NULL) {
-        Py_DECREF(bytes_owner);
-        return PyErr_NoMemory();
-    }
-
-    item->data = data;
-    item->size = (size_t)size;
-    item->data_ref = bytes_owner;
-    bytes_owner = NULL;
-
     server = (PyRtpServer *)self->server_obj;
     assert(server->worker_running);
     if (!server->accepting_commands) {
-        free_send_item(item);
+        send_ref_release(&ref, 0);
         PyErr_SetString(PyExc_RuntimeError, "RtpServer is shutting down");
         return NULL;
     }
 
-    queued = try_push(state->out_q, item) ? 1 : 0;
+    queued = byte_ring_try_push_many(state->out_q, &rec, 1) == 1;
     if (queued)
         pthread_cond_signal(&server->cmd_cv);
+    send_ref_release(&ref, queued);
 
     if (!queued) {
-        free_send_item(item);
         PyErr_SetString(RtpQueueFullError, "channel output queue is full");
         return NULL;
     }
@@ -1731,6 +1909,78 @@ PyRtpChannel_send_pkt(PyRtpChannel *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+/*
+ * Enqueue a burst of packets with a single publication to the worker.
+ * Returns the number of packets queued, the ones that did not fit into
+ * the queue are dropped.
+ */
+static PyObject *
+PyRtpChannel_send_pkts(PyRtpChannel *self, PyObject *args)
+{
+    PyObject *pkts_obj = NULL;
+    PyObject *seq = NULL;
+    struct byte_ring_rec *recs = NULL;
+    RtpSendRef *refs = NULL;
+    Py_ssize_t npkts, i, nrecs = 0;
+    size_t queued = 0;
+    PyRtpServer *server;
+    RtpChannelState *state;
+
+    if (!PyArg_ParseTuple(args, "O:send_pkts", &pkts_obj))
+        return NULL;
+
+    if (channel_check_send(self) != 0)
+        return NULL;
+    state = &self->state;
+    assert(state->out_q != NULL);
+
+    seq = PySequence_Fast(pkts_obj, "pkts must be a sequence");
+    if (seq == NULL)
+        return NULL;
+    npkts = PySequence_Fast_GET_SIZE(seq);
+    if (npkts == 0) {
+        Py_DECREF(seq);
+        return PyLong_FromLong(0);
+    }
+    recs = PyMem_Malloc((size_t)npkts * sizeof(*recs));
+    refs = PyMem_Malloc((size_t)npkts * sizeof(*refs));
+    if (recs == NULL || refs == NULL) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+    for (nrecs = 0; nrecs < npkts; nrecs++) {
+        if (send_rec_from_obj(state->out_q, PySequence_Fast_GET_ITEM(seq, nrecs),
+            &recs[nrecs], &refs[nrecs]) != 0)
+            goto fail;
+    }
+
+    server = (PyRtpServer *)self->server_obj;
+    assert(server->worker_running);
+    if (!server->accepting_commands) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpServer is shutting down");
+        goto fail;
+    }
+
+    queued = byte_ring_try_push_many(state->out_q, recs, (size_t)nrecs);
+    if (queued > 0)
+        pthread_cond_signal(&server->cmd_cv);
+    for (i = 0; i < nrecs; i++)
+        send_ref_release(&refs[i], i < (Py_ssize_t)queued);
+    PyMem_Free(recs);
+    PyMem_Free(refs);
+    Py_DECREF(seq);
+
+    return PyLong_FromSize_t(queued);
+
+fail:
+    for (i = 0; i < nrecs; i++)
+        send_ref_release(&refs[i], 0);
+    PyMem_Free(recs);
+    PyMem_Free(refs);
+    Py_DECREF(seq);
+    return NULL;
+}
+
 static PyObject *
 PyRtpChannel_get_local_addr(PyRtpChannel *self, void *closure)
 {
@@ -1758,9 +2008,13 @@ PyRtpChannel_get_closed(PyRtpChannel *self, void *closure)
 }
 
 static PyMethodDef PyRtpChannel_methods[] = {
-    {"set_target", (PyCFunction)PyRtpChannel_set_target, METH_VARARGS, NULL},
+    {"set_target", (PyCFunction)PyRtpChannel_set_target,
+        METH_VARARGS | METH_KEYWORDS, NULL},
     {"send_pkt", (PyCFunction)PyRtpChannel_send_pkt, METH_VARARGS, NULL},
-    {"close", (PyCFunction)PyRtpChannel_close, METH_VARARGS, NULL},
+    {"send_pkts", (PyCFunction)PyRtpChannel_send_pkts, METH_VARARGS, NULL},
+    {"close", (PyCFunction)PyRtpChannel_close,
+        METH_VARARGS | METH_KEYWORDS, NULL},
+    {"wait", (PyCFunction)PyRtpChannel_wait, METH_VARARGS, NULL},
     {NULL}
 };
 
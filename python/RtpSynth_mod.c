@@ -11,6 +11,8 @@
 #include <Python.h>
 
 #include "rtpsynth.h"
+#include "rsynth_pool.h"
+#include "rsynth_pacer.h"
 
 #define MODULE_NAME "rtpsynth.RtpSynth"
 
@@ -19,6 +21,23 @@ typedef struct {
     void *rs;
 } PyRtpSynth;
 
+typedef struct {
+    PyObject_HEAD
+    void *rp;
+} PyRtpSynthPool;
+
+typedef struct {
+    PyObject *pload;
+} PyRtpSynthPacerSrc;
+
+typedef struct {
+    PyObject_HEAD
+    void *pp;
+    unsigned int capacity;
+    unsigned int max_plen;
+    PyRtpSynthPacerSrc **srcs;
+} PyRtpSynthPacer;
+
 static PyObject *g_randfunc = NULL;
 
 static uint32_t
@@ -75,14 +94,35 @@ PyRtpSynth_dealloc(PyRtpSynth *self)
 static int
 PyRtpSynth_init(PyRtpSynth *self, PyObject *args, PyObject *kwds)
 {
+    static char *kwlist[] = {"srate", "ptime", "prng", NULL};
     int srate = 0;
     int ptime = 0;
+    PyObject *prng = Py_None;
 
-    if (!PyArg_ParseTuple(args, "ii:RtpSynth", &srate, &ptime))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii|O:RtpSynth", kwlist,
+        &srate, &ptime, &prng))
         return -1;
-    (void)kwds;
 
-    self->rs = rsynth_ctor(srate, ptime);
+    if (self->rs != NULL) {
+        rsynth_dtor(self->rs);
+        self->rs = NULL;
+    }
+    if (prng == Py_None || prng == Py_False) {
+        self->rs = rsynth_ctor(srate, ptime);
+    } else if (prng == Py_True) {
+        self->rs = rsynth_ctor_rf(srate, ptime, NULL, NULL);
+    } else if (PyLong_Check(prng)) {
+        struct rsynth_prng rng;
+        unsigned long long seed = PyLong_AsUnsignedLongLongMask(prng);
+
+        if (PyErr_Occurred())
+            return -1;
+        rsynth_prng_seed(&rng, seed);
+        self->rs = rsynth_ctor_rf(srate, ptime, rsynth_prng_next, &rng);
+    } else {
+        PyErr_SetString(PyExc_TypeError, "prng expects None, a bool or an integer seed");
+        return -1;
+    }
     if (self->rs == NULL) {
         PyErr_SetString(PyExc_RuntimeError, "rsynth_ctor() failed");
         return -1;
@@ -93,10 +133,12 @@ PyRtpSynth_init(PyRtpSynth *self, PyObject *args, PyObject *kwds)
 static PyObject *
 PyRtpSynth_next_pkt(PyRtpSynth *self, PyObject *args, PyObject *kwds)
 {
-    static char *kwlist[] = {"plen", "pt", "pload", NULL};
+    static char *kwlist[] = {"plen", "pt", "pload", "now_ns", NULL};
     int plen = 0;
     int pt = 0;
     PyObject *pload = Py_None;
+    PyObject *now_obj = Py_None;
+    unsigned long long now_ns = 0;
     PyObject *payload_bytes = NULL;
     const char *payload_data = NULL;
     Py_ssize_t payload_len = 0;
@@ -111,11 +153,17 @@ PyRtpSynth_next_pkt(PyRtpSynth *self, PyObject *args, PyObject *kwds)
         return NULL;
     }
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii|O:next_pkt", kwlist,
-        &plen, &pt, &pload))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii|OO:next_pkt", kwlist,
+        &plen, &pt, &pload, &now_obj))
         return NULL;
 
-    pktlen = plen + 32;
+    if (now_obj != Py_None) {
+        now_ns = PyLong_AsUnsignedLongLong(now_obj);
+        if (PyErr_Occurred())
+            return NULL;
+    }
+
+    pktlen = plen + (int)rsynth_hdr_len(self->rs) + 32;
     if (pktlen <= 0) {
         PyErr_SetString(PyExc_ValueError, "invalid packet length");
         return NULL;
@@ -159,7 +207,13 @@ PyRtpSynth_next_pkt(PyRtpSynth *self, PyObject *args, PyObject *kwds)
         memcpy(buf, payload_data, (size_t)payload_len);
     }
 
-    outlen = rsynth_next_pkt_pa(self->rs, plen, pt, buf, (unsigned int)pktlen, filled);
+    if (now_obj != Py_None) {
+        outlen = rsynth_next_pkt_pa_at(self->rs, plen, pt, buf,
+          (unsigned int)pktlen, filled, now_ns);
+    } else {
+        outlen = rsynth_next_pkt_pa(self->rs, plen, pt, buf,
+          (unsigned int)pktlen, filled);
+    }
     if (outlen < 0 || outlen > pktlen) {
         Py_DECREF(out);
         Py_XDECREF(payload_bytes);
@@ -181,6 +235,94 @@ PyRtpSynth_next_pkt(PyRtpSynth *self, PyObject *args, PyObject *kwds)
     return out;
 }
 
+static PyObject *
+PyRtpSynth_next_pkts(PyRtpSynth *self, PyObject *args)
+{
+    int npkts = 0;
+    int plen = 0;
+    int pt = 0;
+    size_t pktlen;
+    char *buf = NULL;
+    unsigned int *offs = NULL;
+    unsigned int *lens = NULL;
+    int ngen;
+    PyObject *out = NULL;
+
+    if (self->rs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynth handle is not initialized");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "iii:next_pkts", &npkts, &plen, &pt))
+        return NULL;
+
+    if (npkts <= 0 || plen < 0) {
+        PyErr_SetString(PyExc_ValueError, "invalid packet count or length");
+        return NULL;
+    }
+    pktlen = (size_t)plen + rsynth_hdr_len(self->rs);
+    if (pktlen > UINT32_MAX / (size_t)npkts) {
+        PyErr_SetString(PyExc_ValueError, "batch is too large");
+        return NULL;
+    }
+
+    buf = PyMem_Malloc(pktlen * (size_t)npkts);
+    offs = PyMem_Calloc((size_t)npkts, sizeof(*offs));
+    lens = PyMem_Calloc((size_t)npkts, sizeof(*lens));
+    if (buf == NULL || offs == NULL || lens == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+
+    ngen = rsynth_next_pkts(self->rs, npkts, plen, pt, buf,
+      (unsigned int)(pktlen * (size_t)npkts), offs, lens);
+    if (ngen != npkts) {
+        PyErr_SetString(PyExc_RuntimeError, "rsynth_next_pkts() failed");
+        goto out;
+    }
+
+    out = PyList_New(ngen);
+    if (out == NULL)
+        goto out;
+    for (int i = 0; i < ngen; i++) {
+        PyObject *pkt = PyBytes_FromStringAndSize(buf + offs[i], lens[i]);
+        if (pkt == NULL) {
+            Py_CLEAR(out);
+            goto out;
+        }
+        PyList_SET_ITEM(out, i, pkt);
+    }
+
+out:
+    PyMem_Free(lens);
+    PyMem_Free(offs);
+    PyMem_Free(buf);
+    return out;
+}
+
+static PyObject *
+PyRtpSynth_next_hdr(PyRtpSynth *self, PyObject *args)
+{
+    int pt = 0;
+    char hbuf[128];
+    int hlen;
+
+    if (self->rs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynth handle is not initialized");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "i:next_hdr", &pt))
+        return NULL;
+
+    hlen = rsynth_next_hdr(self->rs, pt, hbuf, sizeof(hbuf));
+    if (hlen < 0) {
+        PyErr_SetString(PyExc_RuntimeError, "rsynth_next_hdr() failed");
+        return NULL;
+    }
+    return PyBytes_FromStringAndSize(hbuf, hlen);
+}
+
 static PyObject *
 PyRtpSynth_pkt_free(PyRtpSynth *self, PyObject *args)
 {
@@ -247,6 +389,52 @@ PyRtpSynth_resync(PyRtpSynth *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+PyRtpSynth_resync_at(PyRtpSynth *self, PyObject *args)
+{
+    unsigned long long now_ns;
+
+    if (self->rs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynth handle is not initialized");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "K:resync_at", &now_ns))
+        return NULL;
+
+    rsynth_resync_at(self->rs, NULL, now_ns);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynth_set_clock(PyRtpSynth *self, PyObject *args)
+{
+    int new_clk;
+    enum rsynth_clock old_clk;
+
+    if (self->rs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynth handle is not initialized");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "i:set_clock", &new_clk))
+        return NULL;
+
+    switch (new_clk) {
+    case RSYNTH_CLOCK_MONOTONIC:
+    case RSYNTH_CLOCK_COARSE:
+    case RSYNTH_CLOCK_NONE:
+        break;
+
+    default:
+        PyErr_SetString(PyExc_ValueError, "invalid clock mode");
+        return NULL;
+    }
+
+    old_clk = rsynth_set_clock(self->rs, (enum rsynth_clock)new_clk);
+    return PyLong_FromLong(old_clk);
+}
+
 static PyObject *
 PyRtpSynth_skip(PyRtpSynth *self, PyObject *args)
 {
@@ -264,6 +452,88 @@ PyRtpSynth_skip(PyRtpSynth *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+PyRtpSynth_hdrext_add(PyRtpSynth *self, PyObject *args)
+{
+    int id;
+    Py_buffer data;
+    int rval;
+
+    if (self->rs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynth handle is not initialized");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "iy*:hdrext_add", &id, &data))
+        return NULL;
+
+    rval = rsynth_hdrext_add(self->rs, id, data.buf, (unsigned int)data.len);
+    PyBuffer_Release(&data);
+    if (rval != 0) {
+        PyErr_SetString(PyExc_ValueError, "invalid, duplicate or oversized "
+          "header extension element");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynth_hdrext_set(PyRtpSynth *self, PyObject *args)
+{
+    int id;
+    PyObject *val;
+    int rval;
+
+    if (self->rs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynth handle is not initialized");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "iO:hdrext_set", &id, &val))
+        return NULL;
+
+    if (PyLong_Check(val)) {
+        unsigned long v = PyLong_AsUnsignedLong(val);
+
+        if (PyErr_Occurred())
+            return NULL;
+        if (v > UINT32_MAX) {
+            PyErr_SetString(PyExc_OverflowError, "value is too large");
+            return NULL;
+        }
+        rval = rsynth_hdrext_set_uint(self->rs, id, (uint32_t)v);
+    } else {
+        Py_buffer data;
+
+        if (PyObject_GetBuffer(val, &data, PyBUF_SIMPLE) != 0)
+            return NULL;
+        rval = rsynth_hdrext_set(self->rs, id, data.buf, (unsigned int)data.len);
+        PyBuffer_Release(&data);
+    }
+    if (rval != 0) {
+        PyErr_SetString(PyExc_ValueError, "no such header extension element "
+          "or length mismatch");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynth_hdrext_clear(PyRtpSynth *self, PyObject *args)
+{
+
+    if (self->rs == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynth handle is not initialized");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, ":hdrext_clear"))
+        return NULL;
+
+    rsynth_hdrext_clear(self->rs);
+    Py_RETURN_NONE;
+}
+
 static PyObject *
 PyRtpSynth_set_randfunc(PyObject *self, PyObject *args)
 {
@@ -294,10 +564,17 @@ PyRtpSynth_set_randfunc(PyObject *self, PyObject *args)
 
 static PyMethodDef PyRtpSynth_methods[] = {
     {"next_pkt", (PyCFunction)PyRtpSynth_next_pkt, METH_VARARGS | METH_KEYWORDS, NULL},
+    {"next_pkts", (PyCFunction)PyRtpSynth_next_pkts, METH_VARARGS, NULL},
+    {"next_hdr", (PyCFunction)PyRtpSynth_next_hdr, METH_VARARGS, NULL},
     {"pkt_free", (PyCFunction)PyRtpSynth_pkt_free, METH_VARARGS, NULL},
     {"set_mbt", (PyCFunction)PyRtpSynth_set_mbt, METH_VARARGS, NULL},
     {"resync", (PyCFunction)PyRtpSynth_resync, METH_VARARGS, NULL},
+    {"resync_at", (PyCFunction)PyRtpSynth_resync_at, METH_VARARGS, NULL},
+    {"set_clock", (PyCFunction)PyRtpSynth_set_clock, METH_VARARGS, NULL},
     {"skip", (PyCFunction)PyRtpSynth_skip, METH_VARARGS, NULL},
+    {"hdrext_add", (PyCFunction)PyRtpSynth_hdrext_add, METH_VARARGS, NULL},
+    {"hdrext_set", (PyCFunction)PyRtpSynth_hdrext_set, METH_VARARGS, NULL},
+    {"hdrext_clear", (PyCFunction)PyRtpSynth_hdrext_clear, METH_VARARGS, NULL},
     {NULL}
 };
 
@@ -313,6 +590,458 @@ static PyTypeObject PyRtpSynthType = {
     .tp_methods = PyRtpSynth_methods,
 };
 
+static void
+PyRtpSynthPool_dealloc(PyRtpSynthPool *self)
+{
+    if (self->rp != NULL) {
+        rsynth_pool_dtor(self->rp);
+        self->rp = NULL;
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+PyRtpSynthPool_init(PyRtpSynthPool *self, PyObject *args, PyObject *kwds)
+{
+    unsigned int capacity = 0;
+    int ptime = 0;
+
+    if (!PyArg_ParseTuple(args, "Ii:RtpSynthPool", &capacity, &ptime))
+        return -1;
+    (void)kwds;
+
+    if (self->rp != NULL)
+        rsynth_pool_dtor(self->rp);
+    self->rp = rsynth_pool_ctor(capacity, ptime);
+    if (self->rp == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "rsynth_pool_ctor() failed");
+        return -1;
+    }
+    return 0;
+}
+
+#define POOL_CHECK(self) \
+    if ((self)->rp == NULL) { \
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynthPool handle is not initialized"); \
+        return NULL; \
+    }
+
+#define POOL_CHECK_IDX(self, idx) \
+    if ((idx) >= rsynth_pool_size((self)->rp)) { \
+        PyErr_SetString(PyExc_IndexError, "stream index out of range"); \
+        return NULL; \
+    }
+
+static PyObject *
+PyRtpSynthPool_add(PyRtpSynthPool *self, PyObject *args)
+{
+    int srate = 0;
+    int pt = 0;
+    int idx;
+
+    POOL_CHECK(self);
+    if (!PyArg_ParseTuple(args, "ii:add", &srate, &pt))
+        return NULL;
+
+    idx = rsynth_pool_add(self->rp, srate, pt);
+    if (idx < 0) {
+        PyErr_SetString(PyExc_OverflowError, "RtpSynthPool is full");
+        return NULL;
+    }
+    return PyLong_FromLong(idx);
+}
+
+static PyObject *
+PyRtpSynthPool_remove(PyRtpSynthPool *self, PyObject *args)
+{
+    unsigned int idx;
+
+    POOL_CHECK(self);
+    if (!PyArg_ParseTuple(args, "I:remove", &idx))
+        return NULL;
+    POOL_CHECK_IDX(self, idx);
+
+    return PyLong_FromLong(rsynth_pool_remove(self->rp, idx));
+}
+
+static PyObject *
+PyRtpSynthPool_set_mbt(PyRtpSynthPool *self, PyObject *args)
+{
+    unsigned int idx;
+    unsigned int new_st;
+
+    POOL_CHECK(self);
+    if (!PyArg_ParseTuple(args, "II:set_mbt", &idx, &new_st))
+        return NULL;
+    POOL_CHECK_IDX(self, idx);
+
+    return PyLong_FromUnsignedLong(rsynth_pool_set_mbt(self->rp, idx, new_st));
+}
+
+static PyObject *
+PyRtpSynthPool_skip(PyRtpSynthPool *self, PyObject *args)
+{
+    unsigned int idx;
+    int npkts;
+
+    POOL_CHECK(self);
+    if (!PyArg_ParseTuple(args, "Ii:skip", &idx, &npkts))
+        return NULL;
+    POOL_CHECK_IDX(self, idx);
+
+    rsynth_pool_skip(self->rp, idx, npkts);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynthPool_tick(PyRtpSynthPool *self, PyObject *args)
+{
+    PyObject *out;
+    unsigned int n;
+
+    POOL_CHECK(self);
+    if (!PyArg_ParseTuple(args, ":tick"))
+        return NULL;
+
+    n = rsynth_pool_size(self->rp);
+    out = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)n * RSYNTH_POOL_HDR_LEN);
+    if (out == NULL)
+        return NULL;
+    rsynth_pool_tick(self->rp, (unsigned char *)PyBytes_AS_STRING(out));
+    return out;
+}
+
+static Py_ssize_t
+PyRtpSynthPool_len(PyRtpSynthPool *self)
+{
+    if (self->rp == NULL)
+        return 0;
+    return rsynth_pool_size(self->rp);
+}
+
+static PyMethodDef PyRtpSynthPool_methods[] = {
+    {"add", (PyCFunction)PyRtpSynthPool_add, METH_VARARGS, NULL},
+    {"remove", (PyCFunction)PyRtpSynthPool_remove, METH_VARARGS, NULL},
+    {"set_mbt", (PyCFunction)PyRtpSynthPool_set_mbt, METH_VARARGS, NULL},
+    {"skip", (PyCFunction)PyRtpSynthPool_skip, METH_VARARGS, NULL},
+    {"tick", (PyCFunction)PyRtpSynthPool_tick, METH_VARARGS, NULL},
+    {NULL}
+};
+
+static PySequenceMethods PyRtpSynthPool_as_sequence = {
+    .sq_length = (lenfunc)PyRtpSynthPool_len,
+};
+
+static PyTypeObject PyRtpSynthPoolType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = MODULE_NAME ".RtpSynthPool",
+    .tp_basicsize = sizeof(PyRtpSynthPool),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)PyRtpSynthPool_init,
+    .tp_dealloc = (destructor)PyRtpSynthPool_dealloc,
+    .tp_methods = PyRtpSynthPool_methods,
+    .tp_as_sequence = &PyRtpSynthPool_as_sequence,
+};
+
+static int
+PyRtpSynthPacer_pload(void *arg, char *pload, unsigned int maxlen,
+  uint64_t deadline_ns)
+{
+    PyRtpSynthPacerSrc *srcp = (PyRtpSynthPacerSrc *)arg;
+    Py_ssize_t plen;
+
+    (void)deadline_ns;
+    if (srcp->pload == NULL)
+        return RSYNTH_PACER_NOPKT;
+    plen = PyBytes_GET_SIZE(srcp->pload);
+    if ((size_t)plen > maxlen)
+        plen = maxlen;
+    memcpy(pload, PyBytes_AS_STRING(srcp->pload), plen);
+    return (int)plen;
+}
+
+static void
+PyRtpSynthPacer_free_src(PyRtpSynthPacer *self, int id)
+{
+    PyRtpSynthPacerSrc *srcp = self->srcs[id];
+
+    if (srcp == NULL)
+        return;
+    Py_XDECREF(srcp->pload);
+    PyMem_Free(srcp);
+    self->srcs[id] = NULL;
+}
+
+static void
+PyRtpSynthPacer_dealloc(PyRtpSynthPacer *self)
+{
+    if (self->pp != NULL) {
+        rsynth_pacer_dtor(self->pp);
+        self->pp = NULL;
+    }
+    if (self->srcs != NULL) {
+        for (unsigned int i = 0; i < self->capacity; i++)
+            PyRtpSynthPacer_free_src(self, i);
+        PyMem_Free(self->srcs);
+        self->srcs = NULL;
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+PyRtpSynthPacer_init(PyRtpSynthPacer *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"capacity", "tick_ns", "max_plen", "max_late", NULL};
+    unsigned int capacity = 0;
+    unsigned long long tick_ns = 1000000;
+    unsigned int max_plen = 1024;
+    unsigned int max_late = 5;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "I|KII:RtpSynthPacer", kwlist,
+        &capacity, &tick_ns, &max_plen, &max_late))
+        return -1;
+
+    if (self->pp != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynthPacer is already initialized");
+        return -1;
+    }
+    self->srcs = PyMem_Calloc(capacity, sizeof(*self->srcs));
+    if (self->srcs == NULL && capacity > 0) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->pp = rsynth_pacer_ctor(capacity, tick_ns, max_plen, max_late);
+    if (self->pp == NULL) {
+        PyMem_Free(self->srcs);
+        self->srcs = NULL;
+        PyErr_SetString(PyExc_RuntimeError, "rsynth_pacer_ctor() failed");
+        return -1;
+    }
+    self->capacity = capacity;
+    self->max_plen = max_plen;
+    return 0;
+}
+
+#define PACER_CHECK(self) \
+    if ((self)->pp == NULL) { \
+        PyErr_SetString(PyExc_RuntimeError, "RtpSynthPacer handle is not initialized"); \
+        return NULL; \
+    }
+
+#define PACER_CHECK_ID(self, id) \
+    if ((id) < 0 || (unsigned int)(id) >= (self)->capacity || \
+      (self)->srcs[(id)] == NULL) { \
+        PyErr_SetString(PyExc_KeyError, "no such stream"); \
+        return NULL; \
+    }
+
+static int
+PyRtpSynthPacer_set_src_pload(PyRtpSynthPacerSrc *srcp, PyObject *pload)
+{
+    PyObject *pload_bytes = NULL;
+
+    if (pload != Py_None) {
+        pload_bytes = PyBytes_Check(pload) ? (Py_INCREF(pload), pload) :
+          PyObject_Bytes(pload);
+        if (pload_bytes == NULL)
+            return -1;
+    }
+    Py_XDECREF(srcp->pload);
+    srcp->pload = pload_bytes;
+    return 0;
+}
+
+static PyObject *
+PyRtpSynthPacer_add(PyRtpSynthPacer *self, PyObject *args)
+{
+    int srate, ptime, pt, id;
+    PyObject *pload;
+    unsigned long long start_ns;
+    PyRtpSynthPacerSrc *srcp;
+
+    PACER_CHECK(self);
+    if (!PyArg_ParseTuple(args, "iiiOK:add", &srate, &ptime, &pt, &pload,
+        &start_ns))
+        return NULL;
+
+    srcp = PyMem_Calloc(1, sizeof(*srcp));
+    if (srcp == NULL)
+        return PyErr_NoMemory();
+    if (PyRtpSynthPacer_set_src_pload(srcp, pload) != 0) {
+        PyMem_Free(srcp);
+        return NULL;
+    }
+    id = rsynth_pacer_add(self->pp, srate, ptime, pt, PyRtpSynthPacer_pload,
+      srcp, start_ns);
+    if (id < 0) {
+        Py_XDECREF(srcp->pload);
+        PyMem_Free(srcp);
+        PyErr_SetString(PyExc_OverflowError, "RtpSynthPacer is full");
+        return NULL;
+    }
+    self->srcs[id] = srcp;
+    return PyLong_FromLong(id);
+}
+
+static PyObject *
+PyRtpSynthPacer_set_pload(PyRtpSynthPacer *self, PyObject *args)
+{
+    int id;
+    PyObject *pload;
+
+    PACER_CHECK(self);
+    if (!PyArg_ParseTuple(args, "iO:set_pload", &id, &pload))
+        return NULL;
+    PACER_CHECK_ID(self, id);
+
+    if (PyRtpSynthPacer_set_src_pload(self->srcs[id], pload) != 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynthPacer_remove(PyRtpSynthPacer *self, PyObject *args)
+{
+    int id;
+
+    PACER_CHECK(self);
+    if (!PyArg_ParseTuple(args, "i:remove", &id))
+        return NULL;
+    PACER_CHECK_ID(self, id);
+
+    rsynth_pacer_remove(self->pp, id);
+    PyRtpSynthPacer_free_src(self, id);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynthPacer_pause(PyRtpSynthPacer *self, PyObject *args)
+{
+    int id;
+
+    PACER_CHECK(self);
+    if (!PyArg_ParseTuple(args, "i:pause", &id))
+        return NULL;
+    PACER_CHECK_ID(self, id);
+
+    rsynth_pacer_pause(self->pp, id);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynthPacer_resume(PyRtpSynthPacer *self, PyObject *args)
+{
+    int id;
+    unsigned long long now_ns;
+
+    PACER_CHECK(self);
+    if (!PyArg_ParseTuple(args, "iK:resume", &id, &now_ns))
+        return NULL;
+    PACER_CHECK_ID(self, id);
+
+    rsynth_pacer_resume(self->pp, id, now_ns);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+PyRtpSynthPacer_run(PyRtpSynthPacer *self, PyObject *args)
+{
+    unsigned long long now_ns;
+    int maxpkts = 64;
+    size_t blen;
+    char *buf = NULL;
+    struct rsynth_pacer_pkt *pkts = NULL;
+    PyObject *out = NULL;
+    int npkts;
+
+    PACER_CHECK(self);
+    if (!PyArg_ParseTuple(args, "K|i:run", &now_ns, &maxpkts))
+        return NULL;
+    if (maxpkts <= 0) {
+        PyErr_SetString(PyExc_ValueError, "maxpkts must be positive");
+        return NULL;
+    }
+
+    blen = (size_t)maxpkts * (self->max_plen + 16 + RSYNTH_HDREXT_MAXLEN);
+    if (blen > UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "batch is too large");
+        return NULL;
+    }
+    buf = PyMem_Malloc(blen);
+    pkts = PyMem_Calloc((size_t)maxpkts, sizeof(*pkts));
+    if (buf == NULL || pkts == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+
+    npkts = rsynth_pacer_run(self->pp, now_ns, buf, (unsigned int)blen, pkts,
+      maxpkts);
+    out = PyList_New(npkts);
+    if (out == NULL)
+        goto out;
+    for (int i = 0; i < npkts; i++) {
+        PyObject *pkt, *item;
+
+        pkt = PyBytes_FromStringAndSize(buf + pkts[i].off, pkts[i].len);
+        if (pkt == NULL) {
+            Py_CLEAR(out);
+            goto out;
+        }
+        item = Py_BuildValue("(iKN)", pkts[i].id,
+          (unsigned long long)pkts[i].deadline_ns, pkt);
+        if (item == NULL) {
+            Py_CLEAR(out);
+            goto out;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+
+out:
+    PyMem_Free(pkts);
+    PyMem_Free(buf);
+    return out;
+}
+
+static PyObject *
+PyRtpSynthPacer_next_deadline(PyRtpSynthPacer *self, PyObject *args)
+{
+    uint64_t dl;
+
+    PACER_CHECK(self);
+    if (!PyArg_ParseTuple(args, ":next_deadline"))
+        return NULL;
+
+    dl = rsynth_pacer_next_deadline(self->pp);
+    if (dl == UINT64_MAX)
+        Py_RETURN_NONE;
+    return PyLong_FromUnsignedLongLong(dl);
+}
+
+static PyMethodDef PyRtpSynthPacer_methods[] = {
+    {"add", (PyCFunction)PyRtpSynthPacer_add, METH_VARARGS, NULL},
+    {"set_pload", (PyCFunction)PyRtpSynthPacer_set_pload, METH_VARARGS, NULL},
+    {"remove", (PyCFunction)PyRtpSynthPacer_remove, METH_VARARGS, NULL},
+    {"pause", (PyCFunction)PyRtpSynthPacer_pause, METH_VARARGS, NULL},
+    {"resume", (PyCFunction)PyRtpSynthPacer_resume, METH_VARARGS, NULL},
+    {"run", (PyCFunction)PyRtpSynthPacer_run, METH_VARARGS, NULL},
+    {"next_deadline", (PyCFunction)PyRtpSynthPacer_next_deadline, METH_VARARGS, NULL},
+    {NULL}
+};
+
+static PyTypeObject PyRtpSynthPacerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = MODULE_NAME ".RtpSynthPacer",
+    .tp_basicsize = sizeof(PyRtpSynthPacer),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)PyRtpSynthPacer_init,
+    .tp_dealloc = (destructor)PyRtpSynthPacer_dealloc,
+    .tp_methods = PyRtpSynthPacer_methods,
+};
+
 static PyMethodDef RtpSynth_module_methods[] = {
     {"set_randfunc", (PyCFunction)PyRtpSynth_set_randfunc, METH_VARARGS, NULL},
     {NULL}
@@ -333,6 +1062,10 @@ PyInit_RtpSynth(void)
 
     if (PyType_Ready(&PyRtpSynthType) < 0)
         return NULL;
+    if (PyType_Ready(&PyRtpSynthPoolType) < 0)
+        return NULL;
+    if (PyType_Ready(&PyRtpSynthPacerType) < 0)
+        return NULL;
 
     module = PyModule_Create(&RtpSynth_module);
     if (module == NULL)
@@ -340,6 +1073,14 @@ PyInit_RtpSynth(void)
 
     Py_INCREF(&PyRtpSynthType);
     PyModule_AddObject(module, "RtpSynth", (PyObject *)&PyRtpSynthType);
+    Py_INCREF(&PyRtpSynthPoolType);
+    PyModule_AddObject(module, "RtpSynthPool", (PyObject *)&PyRtpSynthPoolType);
+    Py_INCREF(&PyRtpSynthPacerType);
+    PyModule_AddObject(module, "RtpSynthPacer", (PyObject *)&PyRtpSynthPacerType);
+
+    PyModule_AddIntConstant(module, "RSYNTH_CLOCK_MONOTONIC", RSYNTH_CLOCK_MONOTONIC);
+    PyModule_AddIntConstant(module, "RSYNTH_CLOCK_COARSE", RSYNTH_CLOCK_COARSE);
+    PyModule_AddIntConstant(module, "RSYNTH_CLOCK_NONE", RSYNTH_CLOCK_NONE);
 
     return module;
 }
@@ -16,9 +16,12 @@ is_win = get_platform().startswith('win')
 is_mac = get_platform().startswith('macosx-')
 is_elf = not is_win and not is_mac
 
-rtpsynth_ext_srcs = ['python/RtpSynth_mod.c', 'src/rtpsynth.c', 'src/rtp.c']
+rtpsynth_ext_srcs = ['python/RtpSynth_mod.c', 'src/rtpsynth.c', 'src/rsynth_pool.c',
+  'src/rsynth_pacer.c', 'src/rtp.c']
 rtpjbuf_ext_srcs = ['python/RtpJBuf_mod.c', 'src/rtp.c', 'src/rtpjbuf.c']
-rtpserver_ext_srcs = ['python/RtpServer_mod.c', 'src/SPMCQueue.c', 'src/rtp_sync.c']
+if not is_win:
+    rtpjbuf_ext_srcs += ['src/rtpjbuf_mgr.c', 'src/SPMCQueue.c']
+rtpserver_ext_srcs = ['python/RtpServer_mod.c', 'src/ByteRing.c', 'src/rtp_sync.c']
 rtputils_ext_srcs = ['python/RtpUtils_mod.c']
 rtpproc_ext_srcs = ['python/RtpProc_mod.c', 'src/rtp_sync.c']
 
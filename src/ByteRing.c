@@ -0,0 +1,282 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#include "ByteRing.h"
+#include "mp_ring_int.h"
+
+#if !defined(CACHE_LINE_SIZE)
+#define CACHE_LINE_SIZE 64 // Common cache line size
+#endif
+
+/* Filler up to the end of the ring, the record follows from the start */
+#define BR_TAG_PAD UINT32_MAX
+
+/*
+ * Records are 8-byte headers followed by the data padded to 8 bytes. A
+ * record never wraps around: if it doesn't fit before the end of the
+ * ring, the rest is skipped with a BR_TAG_PAD header. Limiting records to
+ * half of the ring guarantees that any of them fits once the ring drains.
+ * Indices are byte offsets that only grow, multi-producer mode claims the
+ * space through the reserveIdx, same as the SPMCQueue does (mp_ring_int.h).
+ */
+struct br_hdr {
+    uint32_t len;
+    uint32_t tag;
+};
+
+struct ByteRing {
+    size_t size;
+    uint64_t mask;
+    bool mp;
+    unsigned char *buf;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t writeIdx;
+    _Alignas(CACHE_LINE_SIZE) uint64_t readIdxCache;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t readIdx;
+    uint64_t peekIdx;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t reserveIdx;
+};
+
+#define BR_ALIGN(x) (((x) + 7) & ~(uint64_t)7)
+#define BR_RECLEN(len) (sizeof(struct br_hdr) + BR_ALIGN((uint64_t)(len)))
+
+static void *
+br_aligned_alloc(size_t alignment, size_t size)
+{
+    size_t alloc_size = (size + alignment - 1) & ~(alignment - 1);
+#if defined(_WIN32)
+    return _aligned_malloc(alloc_size, alignment);
+#elif defined(__APPLE__)
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, alignment, alloc_size) != 0) {
+        return NULL;
+    }
+    return ptr;
+#else
+    return aligned_alloc(alignment, alloc_size);
+#endif
+}
+
+static void
+br_aligned_free(void *ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// Function to create a new ring of size bytes, a power of two
+ByteRing *
+create_byte_ring(size_t size, bool mp)
+{
+    if (size < 2 * BR_RECLEN(0) || (size & (size - 1)) != 0)
+        return NULL;
+    if (size > SIZE_MAX - sizeof(ByteRing) - CACHE_LINE_SIZE)
+        return NULL;
+    ByteRing* ring = (ByteRing*) br_aligned_alloc(CACHE_LINE_SIZE,
+        sizeof(ByteRing) + size);
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->size = size;
+    ring->mask = size - 1;
+    ring->mp = mp;
+    ring->buf = (unsigned char *)(ring + 1);
+    atomic_init(&ring->writeIdx, 0);
+    atomic_init(&ring->readIdx, 0);
+    atomic_init(&ring->reserveIdx, 0);
+    ring->readIdxCache = 0;
+    ring->peekIdx = 0;
+    return ring;
+}
+
+// Function to destroy a ring
+void
+destroy_byte_ring(ByteRing* ring)
+{
+    br_aligned_free(ring);
+}
+
+// Largest record that the ring takes
+size_t
+byte_ring_max_len(const ByteRing* ring)
+{
+    return ring->size / 2 - sizeof(struct br_hdr);
+}
+
+#define LOAD_R_IDX(q, mo) \
+    (atomic_load_explicit(&(q)->readIdx,             (mo)))
+#define LOAD_W_IDX(q, mo) \
+    (atomic_load_explicit(&(q)->writeIdx,            (mo)))
+#define UPDATE_R_IDX(q, v) \
+    (atomic_store_explicit(&(q)->readIdx,       (v), memory_order_release))
+#define UPDATE_W_IDX(q, v) \
+    (atomic_store_explicit(&(q)->writeIdx,      (v), memory_order_release))
+
+// Lay out up to howmany records starting at writeIdx within the room,
+// returns how many fit and the end offset in *endp. Stops at a record
+// tagged BR_TAG_PAD, as the consumer would take it for the filler.
+static size_t
+br_layout(const ByteRing* ring, uint64_t writeIdx, uint64_t room,
+    const struct byte_ring_rec* recs, size_t howmany, uint64_t* endp)
+{
+    uint64_t pos = writeIdx;
+    size_t n;
+
+    for (n = 0; n < howmany; n++) {
+        uint64_t need = BR_RECLEN(recs[n].len);
+        uint64_t npos = pos;
+        if (recs[n].len > byte_ring_max_len(ring) || recs[n].tag == BR_TAG_PAD)
+            break;
+        if ((npos & ring->mask) + need > ring->size)
+            npos += ring->size - (npos & ring->mask);
+        if (npos + need - writeIdx > room)
+            break;
+        pos = npos + need;
+    }
+    *endp = pos;
+    return n;
+}
+
+static void
+br_fill(ByteRing* ring, uint64_t pos, const struct byte_ring_rec* recs,
+    size_t n)
+{
+    struct br_hdr *hp;
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t need = BR_RECLEN(recs[i].len);
+        if ((pos & ring->mask) + need > ring->size) {
+            hp = (struct br_hdr *)(ring->buf + (pos & ring->mask));
+            hp->tag = BR_TAG_PAD;
+            hp->len = 0;
+            pos += ring->size - (pos & ring->mask);
+        }
+        hp = (struct br_hdr *)(ring->buf + (pos & ring->mask));
+        hp->tag = recs[i].tag;
+        hp->len = recs[i].len;
+        memcpy(hp + 1, recs[i].data, recs[i].len);
+        pos += need;
+    }
+}
+
+struct br_fit_arg {
+    const ByteRing* ring;
+    const struct byte_ring_rec* recs;
+    size_t howmany;
+};
+
+static size_t
+br_fit_mp(const void* arg, uint64_t writeIdx, uint64_t room, uint64_t* endp)
+{
+    const struct br_fit_arg* ap = arg;
+
+    return br_layout(ap->ring, writeIdx, room, ap->recs, ap->howmany, endp);
+}
+
+static size_t
+br_try_push_many_mp(ByteRing* ring, const struct byte_ring_rec* recs,
+    size_t howmany)
+{
+    struct br_fit_arg fa = {.ring = ring, .recs = recs, .howmany = howmany};
+    uint64_t writeIdx, endIdx;
+    size_t n;
+
+    n = mp_reserve(&ring->reserveIdx, &ring->readIdx, ring->size,
+        br_fit_mp, &fa, &writeIdx, &endIdx);
+    if (n == 0)
+        return 0;
+    br_fill(ring, writeIdx, recs, n);
+    mp_publish(&ring->writeIdx, writeIdx, endIdx);
+    return n;
+}
+
+// Function to push up to howmany records, publishing them all at once.
+// Returns the number of records pushed, which is less than howmany if the
+// ring is getting full. Records longer than byte_ring_max_len() never fit,
+// neither do the ones tagged UINT32_MAX, which is reserved.
+size_t
+byte_ring_try_push_many(ByteRing* ring, const struct byte_ring_rec* recs,
+    size_t howmany)
+{
+    uint64_t writeIdx, endIdx;
+    size_t n;
+
+    if (ring->mp)
+        return br_try_push_many_mp(ring, recs, howmany);
+    writeIdx = LOAD_W_IDX(ring, memory_order_relaxed);
+    n = br_layout(ring, writeIdx, ring->size - (writeIdx - ring->readIdxCache),
+        recs, howmany, &endIdx);
+    if (n < howmany) {
+        // Update the cached index and retry
+        ring->readIdxCache = LOAD_R_IDX(ring, memory_order_acquire);
+        n = br_layout(ring, writeIdx, ring->size - (writeIdx - ring->readIdxCache),
+            recs, howmany, &endIdx);
+        if (n == 0)
+            return 0;
+    }
+    br_fill(ring, writeIdx, recs, n);
+    UPDATE_W_IDX(ring, endIdx);
+    return n;
+}
+
+bool
+byte_ring_try_push(ByteRing* ring, uint32_t tag, const void* data, size_t len)
+{
+    struct byte_ring_rec rec;
+
+    if (len > byte_ring_max_len(ring) || tag == BR_TAG_PAD)
+        return false;
+    rec.tag = tag;
+    rec.len = (uint32_t)len;
+    rec.data = data;
+    return byte_ring_try_push_many(ring, &rec, 1) == 1;
+}
+
+// Function to look at up to howmany oldest records, which stay in the ring
+// until byte_ring_consume(). This should be called from a single consumer
+// thread. Returns the number of records found.
+size_t
+byte_ring_peek_many(ByteRing* ring, struct byte_ring_rec* recs, size_t howmany)
+{
+    uint64_t readIdx = LOAD_R_IDX(ring, memory_order_relaxed);
+    uint64_t writeIdx = LOAD_W_IDX(ring, memory_order_acquire);
+    const struct br_hdr *hp;
+    size_t n;
+
+    for (n = 0; n < howmany && readIdx != writeIdx; n++) {
+        hp = (const struct br_hdr *)(ring->buf + (readIdx & ring->mask));
+        // A pad is always published along with the record that follows it
+        if (hp->tag == BR_TAG_PAD) {
+            readIdx += ring->size - (readIdx & ring->mask);
+            hp = (const struct br_hdr *)ring->buf;
+        }
+        recs[n].tag = hp->tag;
+        recs[n].len = hp->len;
+        recs[n].data = hp + 1;
+        readIdx += BR_RECLEN(hp->len);
+    }
+    ring->peekIdx = readIdx;
+    return n;
+}
+
+bool
+byte_ring_peek(ByteRing* ring, struct byte_ring_rec* rec)
+{
+    return byte_ring_peek_many(ring, rec, 1) == 1;
+}
+
+// Function to retire the records returned by the last byte_ring_peek*()
+void
+byte_ring_consume(ByteRing* ring)
+{
+    UPDATE_R_IDX(ring, ring->peekIdx);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Variable-length byte ring with the records copied inline, for one
+ * consumer and either one or (mp) many producers. Each record carries a
+ * small caller-defined tag along with the bytes, any but UINT32_MAX,
+ * which the ring reserves for its own use.
+ */
+struct ByteRing;
+
+typedef struct ByteRing ByteRing;
+
+struct byte_ring_rec {
+    uint32_t tag;
+    uint32_t len;
+    const void *data;
+};
+
+ByteRing* create_byte_ring(size_t size, bool mp);
+void destroy_byte_ring(ByteRing* ring);
+size_t byte_ring_max_len(const ByteRing* ring);
+
+bool byte_ring_try_push(ByteRing* ring, uint32_t tag, const void* data,
+    size_t len);
+size_t byte_ring_try_push_many(ByteRing* ring, const struct byte_ring_rec* recs,
+    size_t howmany);
+bool byte_ring_peek(ByteRing* ring, struct byte_ring_rec* rec);
+size_t byte_ring_peek_many(ByteRing* ring, struct byte_ring_rec* recs,
+    size_t howmany);
+void byte_ring_consume(ByteRing* ring);
@@ -9,6 +9,7 @@
 #endif
 
 #include "SPMCQueue.h"
+#include "mp_ring_int.h"
 
 #if !defined(CACHE_LINE_SIZE)
 #define CACHE_LINE_SIZE 64 // Common cache line size
@@ -16,13 +17,19 @@
 
 #define RESERVED_BITS 4
 
+/*
+ * In the multi-producer mode (create_queue_mp()) producers claim their slots
+ * through the reserveIdx, see mp_ring_int.h.
+ */
 struct SPMCQueue {
     size_t capacity;
     uint64_t mask;
+    bool mp;
     _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t writeIdx;
     _Alignas(CACHE_LINE_SIZE) uint64_t readIdxCache;
     _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t readIdx;
     _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t writeIdxCache;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t reserveIdx;
     _Alignas(CACHE_LINE_SIZE) void* slots[]; // FAM for void pointer type slots
 };
 
@@ -77,13 +84,26 @@ create_queue(size_t capacity)
     }
     queue->capacity = capacity;
     queue->mask = capacity - 1;
+    queue->mp = false;
     atomic_init(&queue->writeIdx, 0);
     atomic_init(&queue->readIdx, 0);
     atomic_init(&queue->writeIdxCache, 0);
+    atomic_init(&queue->reserveIdx, 0);
     queue->readIdxCache = 0;
     return queue;
 }
 
+// Same as create_queue(), but try_push() can be called from any number
+// of producer threads concurrently.
+SPMCQueue *
+create_queue_mp(size_t capacity)
+{
+    SPMCQueue* queue = create_queue(capacity);
+    if (queue != NULL)
+        queue->mp = true;
+    return queue;
+}
+
 // Function to destroy a queue
 void destroy_queue(SPMCQueue* queue) {
     spmc_aligned_free(queue);
@@ -104,11 +124,40 @@ void destroy_queue(SPMCQueue* queue) {
 #define UPDATE_W_CACHE(q, v) \
     (atomic_store_explicit(&(q)->writeIdxCache, (v), memory_order_relaxed))
 
+static size_t
+fit_mp(const void* arg, uint64_t writeIdx, uint64_t room, uint64_t* endp)
+{
+    size_t howmany = *(const size_t *)arg;
+    size_t n = (howmany < room) ? howmany : (size_t)room;
+
+    *endp = writeIdx + n;
+    return n;
+}
+
+static size_t
+try_push_many_mp(SPMCQueue* queue, void* const* values, size_t howmany)
+{
+    uint64_t writeIdx, endIdx;
+    size_t n;
+
+    n = mp_reserve(&queue->reserveIdx, &queue->readIdx, queue->capacity,
+        fit_mp, &howmany, &writeIdx, &endIdx);
+    if (n == 0)
+        return 0;
+    for (size_t i = 0; i < n; i++)
+        queue->slots[(writeIdx + i) & queue->mask] = values[i];
+    mp_publish(&queue->writeIdx, writeIdx, endIdx);
+    return n;
+}
+
 // Function to push an element into the queue.
-// This should be called from a single producer thread.
+// This should be called from a single producer thread, unless the queue
+// has been created by the create_queue_mp().
 bool
 try_push(SPMCQueue* queue, void* value)
 {
+    if (queue->mp)
+        return try_push_many_mp(queue, &value, 1) == 1;
     uint64_t writeIdx = LOAD_W_IDX(queue, memory_order_relaxed);
     uint64_t nextWriteIdx = writeIdx + 1;
     // If the queue is not full
@@ -130,6 +179,31 @@ try_push(SPMCQueue* queue, void* value)
     return false;
 }
 
+// Function to push up to howmany elements into the queue, publishing them
+// all at once. Returns the number of elements pushed, which is less than
+// howmany if the queue is getting full.
+size_t
+try_push_many(SPMCQueue* queue, void* const* values, size_t howmany)
+{
+    if (queue->mp)
+        return try_push_many_mp(queue, values, howmany);
+    uint64_t writeIdx = LOAD_W_IDX(queue, memory_order_relaxed);
+    uint64_t room = queue->capacity - (writeIdx - queue->readIdxCache);
+    if (room < howmany) {
+        // Update the cached index and retry
+        queue->readIdxCache = LOAD_R_IDX(queue, memory_order_acquire);
+        room = queue->capacity - (writeIdx - queue->readIdxCache);
+        if (room < howmany)
+            howmany = room;
+        if (howmany == 0)
+            return 0;
+    }
+    for (size_t i = 0; i < howmany; i++)
+        queue->slots[(writeIdx + i) & queue->mask] = values[i];
+    UPDATE_W_IDX(queue, writeIdx + howmany);
+    return howmany;
+}
+
 // Function to pop an element from the queue.
 // This can be called from multiple consumer threads.
 bool
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+/*
+ * Multi-producer side shared by the SPMCQueue and the ByteRing, not part
+ * of the public API. Producers claim the space by bumping reserveIdx, fill
+ * it in and then publish it in the claim order through the writeIdx, so
+ * the consumer side stays the same as with a single producer.
+ */
+
+/* Spins on the publish turn before giving the CPU up to a preempted peer */
+#define MP_SPIN_MAX 64
+
+/*
+ * Returns how many of the caller's items fit into the room starting at
+ * writeIdx, with the index past the last of them in *endp.
+ */
+typedef size_t (*mp_fit_t)(const void *arg, uint64_t writeIdx, uint64_t room,
+    uint64_t *endp);
+
+// Claim the space for up to as many items as fit out of the size slots
+// (or bytes). Returns the number of items claimed, with the space being
+// [*writeIdxp, *endp) if any.
+static inline size_t
+mp_reserve(_Atomic uint64_t *reserveIdx, _Atomic uint64_t *readIdx,
+    uint64_t size, mp_fit_t fit, const void *arg, uint64_t *writeIdxp,
+    uint64_t *endp)
+{
+    uint64_t writeIdx = atomic_load_explicit(reserveIdx, memory_order_relaxed);
+    size_t n;
+
+    do {
+        // readIdx only grows, so a stale one is on the safe side
+        uint64_t room = size -
+          (writeIdx - atomic_load_explicit(readIdx, memory_order_acquire));
+        n = fit(arg, writeIdx, room, endp);
+        if (n == 0)
+            return 0;
+    } while (!atomic_compare_exchange_weak_explicit(reserveIdx, &writeIdx,
+      *endp, memory_order_relaxed, memory_order_relaxed));
+    *writeIdxp = writeIdx;
+    return n;
+}
+
+// Publish the space claimed by mp_reserve() once it has been filled in
+static inline void
+mp_publish(_Atomic uint64_t *writeIdxp, uint64_t writeIdx,
+    uint64_t nextWriteIdx)
+{
+    // Wait for the producers that claimed the preceding space to publish,
+    // acquire to pass their stores on to the consumers
+    for (int i = 0; atomic_load_explicit(writeIdxp, memory_order_acquire) !=
+      writeIdx; i++) {
+        if (i < MP_SPIN_MAX)
+            continue;
+#if defined(_WIN32)
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+        i = 0;
+    }
+    atomic_store_explicit(writeIdxp, nextWriteIdx, memory_order_release);
+}
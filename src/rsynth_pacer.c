@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#if defined(_WIN32) || defined(_WIN64)
+#pragma comment(linker, "/export:rsynth_pacer_ctor")
+#pragma comment(linker, "/export:rsynth_pacer_dtor")
+#pragma comment(linker, "/export:rsynth_pacer_add")
+#pragma comment(linker, "/export:rsynth_pacer_remove")
+#pragma comment(linker, "/export:rsynth_pacer_get_rsynth")
+#pragma comment(linker, "/export:rsynth_pacer_pause")
+#pragma comment(linker, "/export:rsynth_pacer_resume")
+#pragma comment(linker, "/export:rsynth_pacer_run")
+#pragma comment(linker, "/export:rsynth_pacer_next_deadline")
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtpsynth.h"
+#include "rsynth_pacer.h"
+
+/*
+ * Three-level wheel: 256 slots of tick_ns, then 64 slots of 256 ticks
+ * each, then 64 slots of 16384 ticks each. Anything further out than
+ * that parks in the last slot of the top level and gets re-cascaded.
+ */
+#define RSP_L0_BITS 8
+#define RSP_LN_BITS 6
+#define RSP_L0_SIZE (1 << RSP_L0_BITS)
+#define RSP_LN_SIZE (1 << RSP_LN_BITS)
+#define RSP_L0_MASK (RSP_L0_SIZE - 1)
+#define RSP_LN_MASK (RSP_LN_SIZE - 1)
+#define RSP_L1_SHIFT RSP_L0_BITS
+#define RSP_L2_SHIFT (RSP_L0_BITS + RSP_LN_BITS)
+#define RSP_L1_SPAN ((uint64_t)1 << RSP_L1_SHIFT)
+#define RSP_L2_SPAN ((uint64_t)1 << RSP_L2_SHIFT)
+#define RSP_MAX_SPAN ((uint64_t)1 << (RSP_L2_SHIFT + RSP_LN_BITS))
+
+enum rsp_state {RSP_FREE = 0, RSP_ACTIVE, RSP_PAUSED};
+
+struct rsp_stream {
+    struct rsp_stream *next;
+    struct rsp_stream **pprev;
+    void *ri;
+    rsynth_pacer_pload_t cb;
+    void *arg;
+    uint64_t deadline_ns;
+    uint64_t ptime_ns;
+    int pt;
+    int id;
+    enum rsp_state state;
+};
+
+struct rsynth_pacer {
+    uint64_t tick_ns;
+    uint64_t cur_tick;
+    uint64_t cascaded_tick;
+    unsigned int max_plen;
+    unsigned int max_late;
+    unsigned int capacity;
+    struct rsp_stream *free;
+    struct rsp_stream *l0[RSP_L0_SIZE];
+    struct rsp_stream *l1[RSP_LN_SIZE];
+    struct rsp_stream *l2[RSP_LN_SIZE];
+    struct rsp_stream streams[];
+};
+
+static void
+rsp_link(struct rsp_stream **headp, struct rsp_stream *sp)
+{
+
+    sp->next = *headp;
+    if (sp->next != NULL)
+        sp->next->pprev = &sp->next;
+    *headp = sp;
+    sp->pprev = headp;
+}
+
+static void
+rsp_unlink(struct rsp_stream *sp)
+{
+
+    if (sp->next != NULL)
+        sp->next->pprev = sp->pprev;
+    *sp->pprev = sp->next;
+    sp->next = NULL;
+    sp->pprev = NULL;
+}
+
+static void
+rsp_insert(struct rsynth_pacer *pp, struct rsp_stream *sp)
+{
+    uint64_t tick, delta;
+
+    tick = sp->deadline_ns / pp->tick_ns;
+    if (tick < pp->cur_tick)
+        tick = pp->cur_tick;
+    delta = tick - pp->cur_tick;
+    if (delta < RSP_L1_SPAN) {
+        rsp_link(&pp->l0[tick & RSP_L0_MASK], sp);
+    } else if (delta < RSP_L2_SPAN) {
+        rsp_link(&pp->l1[(tick >> RSP_L1_SHIFT) & RSP_LN_MASK], sp);
+    } else {
+        if (delta >= RSP_MAX_SPAN)
+            tick = pp->cur_tick + RSP_MAX_SPAN - RSP_L2_SPAN;
+        rsp_link(&pp->l2[(tick >> RSP_L2_SHIFT) & RSP_LN_MASK], sp);
+    }
+}
+
+static void
+rsp_cascade(struct rsynth_pacer *pp, struct rsp_stream **headp)
+{
+    struct rsp_stream *sp, *sp_next;
+
+    sp = *headp;
+    *headp = NULL;
+    for (; sp != NULL; sp = sp_next) {
+        sp_next = sp->next;
+        rsp_insert(pp, sp);
+    }
+}
+
+void *
+rsynth_pacer_ctor(unsigned int capacity, uint64_t tick_ns,
+  unsigned int max_plen, unsigned int max_late)
+{
+    struct rsynth_pacer *pp;
+    size_t asize;
+
+    if (capacity == 0 || tick_ns == 0 || capacity > INT32_MAX)
+        return (NULL);
+    asize = sizeof(struct rsynth_pacer) + sizeof(struct rsp_stream) * capacity;
+    pp = malloc(asize);
+    if (pp == NULL)
+        return (NULL);
+    memset(pp, '\0', asize);
+    pp->tick_ns = tick_ns;
+    pp->max_plen = max_plen;
+    pp->max_late = max_late;
+    pp->capacity = capacity;
+    pp->cascaded_tick = (uint64_t)-1;
+    for (unsigned int i = capacity; i > 0; i--) {
+        struct rsp_stream *sp = &pp->streams[i - 1];
+        sp->id = i - 1;
+        sp->next = pp->free;
+        pp->free = sp;
+    }
+    return ((void *)pp);
+}
+
+void
+rsynth_pacer_dtor(void *_pp)
+{
+    struct rsynth_pacer *pp;
+
+    pp = (struct rsynth_pacer *)_pp;
+    for (unsigned int i = 0; i < pp->capacity; i++) {
+        if (pp->streams[i].state != RSP_FREE)
+            rsynth_dtor(pp->streams[i].ri);
+    }
+    free(pp);
+}
+
+/*
+ * Add a new stream with its first packet due at start_ns. Returns stream
+ * id or -1 if the pacer is full or an rsynth instance cannot be created.
+ */
+int
+rsynth_pacer_add(void *_pp, int srate, int ptime, int pt,
+  rsynth_pacer_pload_t cb, void *arg, uint64_t start_ns)
+{
+    struct rsynth_pacer *pp;
+    struct rsp_stream *sp;
+
+    pp = (struct rsynth_pacer *)_pp;
+    if (pp->free == NULL || ptime <= 0)
+        return (-1);
+    sp = pp->free;
+    sp->ri = rsynth_ctor_rf(srate, ptime, NULL, NULL);
+    if (sp->ri == NULL)
+        return (-1);
+    pp->free = sp->next;
+    rsynth_set_clock(sp->ri, RSYNTH_CLOCK_NONE);
+    sp->cb = cb;
+    sp->arg = arg;
+    sp->pt = pt;
+    sp->ptime_ns = (uint64_t)ptime * 1000000;
+    sp->deadline_ns = start_ns;
+    sp->state = RSP_ACTIVE;
+    rsp_insert(pp, sp);
+    return (sp->id);
+}
+
+void
+rsynth_pacer_remove(void *_pp, int id)
+{
+    struct rsynth_pacer *pp;
+    struct rsp_stream *sp;
+
+    pp = (struct rsynth_pacer *)_pp;
+    sp = &pp->streams[id];
+    if (sp->state == RSP_FREE)
+        return;
+    if (sp->state == RSP_ACTIVE)
+        rsp_unlink(sp);
+    rsynth_dtor(sp->ri);
+    sp->ri = NULL;
+    sp->state = RSP_FREE;
+    sp->next = pp->free;
+    pp->free = sp;
+}
+
+void *
+rsynth_pacer_get_rsynth(void *_pp, int id)
+{
+    struct rsynth_pacer *pp;
+
+    pp = (struct rsynth_pacer *)_pp;
+    return (pp->streams[id].ri);
+}
+
+void
+rsynth_pacer_pause(void *_pp, int id)
+{
+    struct rsynth_pacer *pp;
+    struct rsp_stream *sp;
+
+    pp = (struct rsynth_pacer *)_pp;
+    sp = &pp->streams[id];
+    if (sp->state != RSP_ACTIVE)
+        return;
+    rsp_unlink(sp);
+    sp->state = RSP_PAUSED;
+}
+
+/*
+ * Resume paused stream. Slots that passed while the stream was paused are
+ * skipped over, so that the RTP timestamp reflects the real time elapsed
+ * and the deadline grid stays where it was.
+ */
+void
+rsynth_pacer_resume(void *_pp, int id, uint64_t now_ns)
+{
+    struct rsynth_pacer *pp;
+    struct rsp_stream *sp;
+
+    pp = (struct rsynth_pacer *)_pp;
+    sp = &pp->streams[id];
+    if (sp->state != RSP_PAUSED)
+        return;
+    if (now_ns > sp->deadline_ns) {
+        uint64_t nmissed = (now_ns - sp->deadline_ns) / sp->ptime_ns;
+
+        rsynth_skip(sp->ri, (int)nmissed);
+        sp->deadline_ns += nmissed * sp->ptime_ns;
+    }
+    sp->state = RSP_ACTIVE;
+    rsp_insert(pp, sp);
+}
+
+/*
+ * Emit a single packet for the stream if there is room in the batch.
+ * Returns -1 if the batch is full, 0 otherwise.
+ */
+static int
+rsp_emit(struct rsynth_pacer *pp, struct rsp_stream *sp, uint64_t now_ns,
+  char *buf, unsigned int blen, unsigned int *boff,
+  struct rsynth_pacer_pkt *pkts, int maxpkts, int *npkts)
+{
+    unsigned int hl;
+    int plen;
+    char *pbuf;
+
+    if (pp->max_late > 0 && now_ns > sp->deadline_ns &&
+      (now_ns - sp->deadline_ns) / sp->ptime_ns >= pp->max_late) {
+        uint64_t nmissed = (now_ns - sp->deadline_ns) / sp->ptime_ns;
+
+        /* Too far behind, drop missed slots and keep the grid */
+        rsynth_skip(sp->ri, (int)nmissed);
+        sp->deadline_ns += nmissed * sp->ptime_ns;
+    }
+    hl = rsynth_hdr_len(sp->ri);
+    if (*npkts == maxpkts || blen - *boff < hl + pp->max_plen)
+        return (-1);
+    pbuf = buf + *boff;
+    plen = sp->cb(sp->arg, pbuf + hl, pp->max_plen, sp->deadline_ns);
+    if (plen == RSYNTH_PACER_NOPKT || plen < 0) {
+        rsynth_skip(sp->ri, 1);
+    } else {
+        if ((unsigned int)plen > pp->max_plen)
+            plen = pp->max_plen;
+        (void)rsynth_next_hdr(sp->ri, sp->pt, pbuf, hl);
+        pkts[*npkts].id = sp->id;
+        pkts[*npkts].arg = sp->arg;
+        pkts[*npkts].deadline_ns = sp->deadline_ns;
+        pkts[*npkts].off = *boff;
+        pkts[*npkts].len = hl + plen;
+        *npkts += 1;
+        *boff += hl + plen;
+    }
+    sp->deadline_ns += sp->ptime_ns;
+    return (0);
+}
+
+/*
+ * Emit all packets due at or before now_ns into buf, describing each of
+ * them in pkts[]. Returns the number of packets emitted. If the batch
+ * fills up, whatever is still due is left in the wheel for the next call.
+ */
+int
+rsynth_pacer_run(void *_pp, uint64_t now_ns, char *buf, unsigned int blen,
+  struct rsynth_pacer_pkt *pkts, int maxpkts)
+{
+    struct rsynth_pacer *pp;
+    struct rsp_stream *sp, *due;
+    uint64_t target;
+    unsigned int boff = 0;
+    int npkts = 0;
+
+    pp = (struct rsynth_pacer *)_pp;
+    target = now_ns / pp->tick_ns;
+    if (pp->cur_tick == 0 && pp->cascaded_tick == (uint64_t)-1) {
+        /* First run, re-base the wheel to the current time */
+        struct rsp_stream *all = NULL;
+
+        for (unsigned int i = 0; i < pp->capacity; i++) {
+            sp = &pp->streams[i];
+            if (sp->state == RSP_ACTIVE) {
+                rsp_unlink(sp);
+                sp->next = all;
+                all = sp;
+            }
+        }
+        pp->cur_tick = target;
+        for (; all != NULL; all = sp) {
+            sp = all->next;
+            rsp_insert(pp, all);
+        }
+        pp->cascaded_tick = target;
+    }
+    while (pp->cur_tick <= target) {
+        if (pp->cascaded_tick != pp->cur_tick) {
+            pp->cascaded_tick = pp->cur_tick;
+            if ((pp->cur_tick & RSP_L0_MASK) == 0) {
+                if (((pp->cur_tick >> RSP_L1_SHIFT) & RSP_LN_MASK) == 0)
+                    rsp_cascade(pp, &pp->l2[(pp->cur_tick >> RSP_L2_SHIFT) &
+                      RSP_LN_MASK]);
+                rsp_cascade(pp, &pp->l1[(pp->cur_tick >> RSP_L1_SHIFT) &
+                  RSP_LN_MASK]);
+            }
+        }
+        while ((due = pp->l0[pp->cur_tick & RSP_L0_MASK]) != NULL) {
+            pp->l0[pp->cur_tick & RSP_L0_MASK] = NULL;
+            due->pprev = &due;
+            while (due != NULL) {
+                sp = due;
+                rsp_unlink(sp);
+                if (sp->deadline_ns / pp->tick_ns > pp->cur_tick) {
+                    rsp_insert(pp, sp);
+                    continue;
+                }
+                if (rsp_emit(pp, sp, now_ns, buf, blen, &boff, pkts, maxpkts,
+                  &npkts) != 0) {
+                    /* Batch is full, put everything back */
+                    rsp_insert(pp, sp);
+                    while (due != NULL) {
+                        sp = due;
+                        rsp_unlink(sp);
+                        rsp_insert(pp, sp);
+                    }
+                    return (npkts);
+                }
+                rsp_insert(pp, sp);
+            }
+        }
+        if (pp->cur_tick == target)
+            break;
+        pp->cur_tick += 1;
+    }
+    return (npkts);
+}
+
+static uint64_t
+rsp_min_deadline(struct rsp_stream *sp, uint64_t dmin)
+{
+
+    for (; sp != NULL; sp = sp->next) {
+        if (sp->deadline_ns < dmin)
+            dmin = sp->deadline_ns;
+    }
+    return (dmin);
+}
+
+/*
+ * Deadline of the earliest packet due, or UINT64_MAX if there is none.
+ */
+uint64_t
+rsynth_pacer_next_deadline(void *_pp)
+{
+    struct rsynth_pacer *pp;
+    uint64_t dmin = UINT64_MAX;
+
+    pp = (struct rsynth_pacer *)_pp;
+    for (unsigned int i = 0; i < RSP_L0_SIZE; i++) {
+        dmin = rsp_min_deadline(pp->l0[(pp->cur_tick + i) & RSP_L0_MASK], dmin);
+        if (dmin != UINT64_MAX)
+            break;
+    }
+    /* Upper levels may still hold something that is due before that */
+    for (unsigned int i = 0; i < RSP_LN_SIZE; i++) {
+        dmin = rsp_min_deadline(pp->l1[i], dmin);
+        dmin = rsp_min_deadline(pp->l2[i], dmin);
+    }
+    return (dmin);
+}
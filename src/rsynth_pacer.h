@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Real-time pacer driving many rsynth instances off a hierarchical timing
+ * wheel. Each stream has its own payload callback; packets that are due
+ * are emitted in batches into a caller-supplied buffer.
+ *
+ * Payload callback is invoked with the buffer to put payload into, its
+ * maximum size and the deadline of the packet. It returns the payload
+ * length, or RSYNTH_PACER_NOPKT to not send a packet in this slot (e.g.
+ * DTX / VAD), in which case only the timestamp is advanced.
+ */
+
+#define RSYNTH_PACER_NOPKT (-1)
+
+typedef int (*rsynth_pacer_pload_t)(void *arg, char *pload, unsigned int maxlen,
+  uint64_t deadline_ns);
+
+struct rsynth_pacer_pkt {
+    int id;
+    void *arg;
+    uint64_t deadline_ns;
+    unsigned int off;
+    unsigned int len;
+};
+
+void *rsynth_pacer_ctor(unsigned int capacity, uint64_t tick_ns,
+  unsigned int max_plen, unsigned int max_late);
+void rsynth_pacer_dtor(void *pp);
+int rsynth_pacer_add(void *pp, int srate, int ptime, int pt,
+  rsynth_pacer_pload_t cb, void *arg, uint64_t start_ns);
+void rsynth_pacer_remove(void *pp, int id);
+void *rsynth_pacer_get_rsynth(void *pp, int id);
+void rsynth_pacer_pause(void *pp, int id);
+void rsynth_pacer_resume(void *pp, int id, uint64_t now_ns);
+int rsynth_pacer_run(void *pp, uint64_t now_ns, char *buf, unsigned int blen,
+  struct rsynth_pacer_pkt *pkts, int maxpkts);
+uint64_t rsynth_pacer_next_deadline(void *pp);
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#if defined(_WIN32) || defined(_WIN64)
+#pragma comment(linker, "/export:rsynth_pool_ctor")
+#pragma comment(linker, "/export:rsynth_pool_dtor")
+#pragma comment(linker, "/export:rsynth_pool_add")
+#pragma comment(linker, "/export:rsynth_pool_remove")
+#pragma comment(linker, "/export:rsynth_pool_size")
+#pragma comment(linker, "/export:rsynth_pool_set_mbt")
+#pragma comment(linker, "/export:rsynth_pool_skip")
+#pragma comment(linker, "/export:rsynth_pool_tick")
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <arpa/inet.h>
+#else
+#include "winnet.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RSP_SIMD_SSE2 1
+#elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && \
+  __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define RSP_SIMD_NEON 1
+#endif
+
+#include "rsynth_pool.h"
+#include "rtpsynth_int.h"
+
+/*
+ * First 32-bit word of the RTP header is kept pre-built in the host order
+ * of a little-endian machine: version/flags byte, then M/PT byte, with the
+ * sequence number OR'ed into the upper half at stamping time.
+ */
+#define RSP_HW0_VER   0x80u
+#define RSP_HW0_MBT   0x8000u
+#define RSP_HW0(pt, mbt) (RSP_HW0_VER | (((uint32_t)(pt) & 0x7f) << 8) | \
+  ((mbt) ? RSP_HW0_MBT : 0))
+
+struct rsynth_pool {
+    unsigned int capacity;
+    unsigned int size;
+    int ptime;
+    uint32_t *hw0;
+    uint32_t *seq;
+    uint32_t *ts;
+    uint32_t *ts_inc;
+    uint32_t *ssrc_be;
+};
+
+void *
+rsynth_pool_ctor(unsigned int capacity, int ptime)
+{
+    struct rsynth_pool *rpp;
+    uint32_t *arena;
+
+    if (capacity == 0 || capacity > UINT32_MAX / (5 * sizeof(uint32_t)))
+        return (NULL);
+    rpp = malloc(sizeof(struct rsynth_pool));
+    if (rpp == NULL)
+        return (NULL);
+    memset(rpp, '\0', sizeof(struct rsynth_pool));
+    arena = malloc(5 * sizeof(uint32_t) * capacity);
+    if (arena == NULL) {
+        free(rpp);
+        return (NULL);
+    }
+    rpp->capacity = capacity;
+    rpp->ptime = ptime;
+    rpp->hw0 = arena;
+    rpp->seq = rpp->hw0 + capacity;
+    rpp->ts = rpp->seq + capacity;
+    rpp->ts_inc = rpp->ts + capacity;
+    rpp->ssrc_be = rpp->ts_inc + capacity;
+    return ((void *)rpp);
+}
+
+void
+rsynth_pool_dtor(void *_rpp)
+{
+    struct rsynth_pool *rpp;
+
+    rpp = (struct rsynth_pool *)_rpp;
+    free(rpp->hw0);
+    free(rpp);
+}
+
+int
+rsynth_pool_add(void *_rpp, int srate, int pt)
+{
+    struct rsynth_pool *rpp;
+    unsigned int i;
+
+    rpp = (struct rsynth_pool *)_rpp;
+    if (rpp->size == rpp->capacity)
+        return (-1);
+    i = rpp->size;
+    rpp->hw0[i] = RSP_HW0(pt, 1);
+    rpp->ssrc_be[i] = rsynth_rand32();
+    rpp->ts[i] = rsynth_rand32() & 0xfffffffe;
+    rpp->seq[i] = rsynth_rand32() & 0xffff;
+    rpp->ts_inc[i] = (uint32_t)((int64_t)srate * rpp->ptime / 1000);
+    rpp->size += 1;
+    return (i);
+}
+
+/*
+ * Remove stream at idx, moving the last stream into its slot. Returns
+ * the old index of the stream that has been moved, or -1 if none.
+ */
+int
+rsynth_pool_remove(void *_rpp, unsigned int idx)
+{
+    struct rsynth_pool *rpp;
+    unsigned int last;
+
+    rpp = (struct rsynth_pool *)_rpp;
+    if (idx >= rpp->size)
+        return (-1);
+    last = --rpp->size;
+    if (idx == last)
+        return (-1);
+    rpp->hw0[idx] = rpp->hw0[last];
+    rpp->seq[idx] = rpp->seq[last];
+    rpp->ts[idx] = rpp->ts[last];
+    rpp->ts_inc[idx] = rpp->ts_inc[last];
+    rpp->ssrc_be[idx] = rpp->ssrc_be[last];
+    return (last);
+}
+
+unsigned int
+rsynth_pool_size(void *_rpp)
+{
+
+    return (((struct rsynth_pool *)_rpp)->size);
+}
+
+unsigned int
+rsynth_pool_set_mbt(void *_rpp, unsigned int idx, unsigned int new_st)
+{
+    struct rsynth_pool *rpp;
+    unsigned int old_st;
+
+    rpp = (struct rsynth_pool *)_rpp;
+    old_st = (rpp->hw0[idx] & RSP_HW0_MBT) != 0;
+    if (new_st)
+        rpp->hw0[idx] |= RSP_HW0_MBT;
+    else
+        rpp->hw0[idx] &= ~RSP_HW0_MBT;
+    return (old_st);
+}
+
+void
+rsynth_pool_skip(void *_rpp, unsigned int idx, int npkts)
+{
+    struct rsynth_pool *rpp;
+
+    rpp = (struct rsynth_pool *)_rpp;
+    rpp->ts[idx] += rpp->ts_inc[idx] * npkts;
+}
+
+static void
+rsynth_pool_stamp1(struct rsynth_pool *rpp, unsigned int i, unsigned char *hp)
+{
+    uint32_t hw[3];
+    uint16_t seq_be;
+
+    hw[0] = htonl(rpp->ts[i]);
+    hw[1] = rpp->ssrc_be[i];
+    seq_be = htons((uint16_t)rpp->seq[i]);
+    hp[0] = rpp->hw0[i] & 0xff;
+    hp[1] = (rpp->hw0[i] >> 8) & 0xff;
+    memcpy(hp + 2, &seq_be, sizeof(seq_be));
+    memcpy(hp + 4, hw, 2 * sizeof(hw[0]));
+    rpp->hw0[i] &= ~RSP_HW0_MBT;
+    rpp->seq[i] = (rpp->seq[i] + 1) & 0xffff;
+    rpp->ts[i] += rpp->ts_inc[i];
+}
+
+#if defined(RSP_SIMD_SSE2)
+static inline __m128i
+bswap32_sse2(__m128i v)
+{
+    /* Swap 16-bit halves, then bytes within each half */
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return (_mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+}
+
+static unsigned int
+rsynth_pool_stamp4(struct rsynth_pool *rpp, unsigned char *hdrs)
+{
+    const __m128i mbt_clr = _mm_set1_epi32(~RSP_HW0_MBT);
+    const __m128i seq_mask = _mm_set1_epi32(0xffff);
+    const __m128i one = _mm_set1_epi32(1);
+    unsigned int i;
+
+    for (i = 0; i + 4 <= rpp->size; i += 4) {
+        __m128i hw0 = _mm_loadu_si128((const __m128i *)&rpp->hw0[i]);
+        __m128i seq = _mm_loadu_si128((const __m128i *)&rpp->seq[i]);
+        __m128i ts = _mm_loadu_si128((const __m128i *)&rpp->ts[i]);
+        __m128i ts_inc = _mm_loadu_si128((const __m128i *)&rpp->ts_inc[i]);
+        __m128i ssrc = _mm_loadu_si128((const __m128i *)&rpp->ssrc_be[i]);
+        __m128i seq_be, a, b, c;
+        __m128 ab_lo, ab_hi, bc_lo, bc_hi, ca_lo, ca_hi;
+
+        seq_be = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(seq,
+          _mm_set1_epi32(0xff)), 24), _mm_slli_epi32(_mm_srli_epi32(seq, 8), 16));
+        a = _mm_or_si128(hw0, seq_be);
+        b = bswap32_sse2(ts);
+        c = ssrc;
+
+        /* Interleave {a, b, c} x 4 into 4 consecutive 12-byte headers */
+        ab_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(a, b));
+        ab_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(a, b));
+        bc_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(b, c));
+        bc_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(b, c));
+        ca_lo = _mm_castsi128_ps(_mm_unpacklo_epi32(c, a));
+        ca_hi = _mm_castsi128_ps(_mm_unpackhi_epi32(c, a));
+        _mm_storeu_si128((__m128i *)(hdrs + 0), _mm_castps_si128(
+          _mm_shuffle_ps(ab_lo, ca_lo, _MM_SHUFFLE(3, 0, 1, 0))));
+        _mm_storeu_si128((__m128i *)(hdrs + 16), _mm_castps_si128(
+          _mm_shuffle_ps(bc_lo, ab_hi, _MM_SHUFFLE(1, 0, 3, 2))));
+        _mm_storeu_si128((__m128i *)(hdrs + 32), _mm_castps_si128(
+          _mm_shuffle_ps(ca_hi, bc_hi, _MM_SHUFFLE(3, 2, 3, 0))));
+        hdrs += 4 * RSYNTH_POOL_HDR_LEN;
+
+        _mm_storeu_si128((__m128i *)&rpp->hw0[i], _mm_and_si128(hw0, mbt_clr));
+        _mm_storeu_si128((__m128i *)&rpp->seq[i],
+          _mm_and_si128(_mm_add_epi32(seq, one), seq_mask));
+        _mm_storeu_si128((__m128i *)&rpp->ts[i], _mm_add_epi32(ts, ts_inc));
+    }
+    return (i);
+}
+#elif defined(RSP_SIMD_NEON)
+static unsigned int
+rsynth_pool_stamp4(struct rsynth_pool *rpp, unsigned char *hdrs)
+{
+    const uint32x4_t mbt_clr = vdupq_n_u32(~RSP_HW0_MBT);
+    const uint32x4_t seq_mask = vdupq_n_u32(0xffff);
+    const uint32x4_t one = vdupq_n_u32(1);
+    unsigned int i;
+
+    for (i = 0; i + 4 <= rpp->size; i += 4) {
+        uint32x4_t hw0 = vld1q_u32(&rpp->hw0[i]);
+        uint32x4_t seq = vld1q_u32(&rpp->seq[i]);
+        uint32x4_t ts = vld1q_u32(&rpp->ts[i]);
+        uint32x4_t ts_inc = vld1q_u32(&rpp->ts_inc[i]);
+        uint32x4x3_t hv;
+
+        hv.val[0] = vorrq_u32(hw0, vshlq_n_u32(vreinterpretq_u32_u8(
+          vrev16q_u8(vreinterpretq_u8_u32(seq))), 16));
+        hv.val[1] = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(ts)));
+        hv.val[2] = vld1q_u32(&rpp->ssrc_be[i]);
+        vst3q_u32((uint32_t *)hdrs, hv);
+        hdrs += 4 * RSYNTH_POOL_HDR_LEN;
+
+        vst1q_u32(&rpp->hw0[i], vandq_u32(hw0, mbt_clr));
+        vst1q_u32(&rpp->seq[i], vandq_u32(vaddq_u32(seq, one), seq_mask));
+        vst1q_u32(&rpp->ts[i], vaddq_u32(ts, ts_inc));
+    }
+    return (i);
+}
+#endif
+
+/*
+ * Stamp headers of all streams in the pool into hdrs, which has to have
+ * room for rsynth_pool_size() * RSYNTH_POOL_HDR_LEN bytes, header of the
+ * stream at index i goes at offset i * RSYNTH_POOL_HDR_LEN. Returns number
+ * of headers stamped.
+ */
+unsigned int
+rsynth_pool_tick(void *_rpp, unsigned char *hdrs)
+{
+    struct rsynth_pool *rpp;
+    unsigned int i;
+
+    rpp = (struct rsynth_pool *)_rpp;
+#if defined(RSP_SIMD_SSE2) || defined(RSP_SIMD_NEON)
+    i = rsynth_pool_stamp4(rpp, hdrs);
+#else
+    i = 0;
+#endif
+    for (; i < rpp->size; i++)
+        rsynth_pool_stamp1(rpp, i, hdrs + i * RSYNTH_POOL_HDR_LEN);
+    return (rpp->size);
+}
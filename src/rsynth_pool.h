@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Pool of many RTP streams sharing the same packet time, kept in
+ * structure-of-arrays form so that headers of all streams can be stamped
+ * in a single pass once per tick.
+ *
+ * Streams are kept dense: removing a stream moves the last one into the
+ * vacated slot. Stream indexes are therefore only stable until the next
+ * rsynth_pool_remove() call.
+ */
+
+#define RSYNTH_POOL_HDR_LEN 12
+
+void *rsynth_pool_ctor(unsigned int capacity, int ptime);
+void rsynth_pool_dtor(void *rpp);
+int rsynth_pool_add(void *rpp, int srate, int pt);
+int rsynth_pool_remove(void *rpp, unsigned int idx);
+unsigned int rsynth_pool_size(void *rpp);
+unsigned int rsynth_pool_set_mbt(void *rpp, unsigned int idx, unsigned int new_st);
+void rsynth_pool_skip(void *rpp, unsigned int idx, int npkts);
+unsigned int rsynth_pool_tick(void *rpp, unsigned char *hdrs);
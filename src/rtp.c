@@ -25,6 +25,16 @@
  *
  */
 
+#if defined(_WIN32) || defined(_WIN64)
+#pragma comment(linker, "/export:rtp_packet_parse_pm")
+#pragma comment(linker, "/export:rtp_packet_parse_batch")
+#pragma comment(linker, "/export:rtp_mux_classify")
+#pragma comment(linker, "/export:rtp_ptmap_init")
+#pragma comment(linker, "/export:rtp_ptmap_set")
+#pragma comment(linker, "/export:rtp_hdrext_iter_init")
+#pragma comment(linker, "/export:rtp_hdrext_iter_next")
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -34,11 +44,21 @@
 #include "winnet.h"
 #endif
 #include <assert.h>
+#include <ctype.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RTP_SIMD_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define RTP_SIMD_NEON 1
+#endif
+
 #include "rtp.h"
 #include "rtp_info.h"
+#include "rtpsynth_int.h"
 
 #define RTP_PROFILE_AUDIO(s, nc) {.ts_rate = (s), .sample_rate = (s), \
   .pt_kind = RTP_PTK_AUDIO, .nchannels = (nc)}
@@ -137,9 +157,94 @@ g723_samples(const unsigned char *buf, int maxlen)
     return samples;
 }
 
+/* Opus frame size in 48kHz samples by the TOC config, RFC 6716 3.1 */
+static int
+opus_frame_samples(unsigned char toc)
+{
+    static const int silk[4] = {480, 960, 1920, 2880};
+    static const int hybrid[2] = {480, 960};
+    static const int celt[4] = {120, 240, 480, 960};
+    int config = toc >> 3;
+
+    if (config < 12)
+        return silk[config & 3];
+    if (config < 16)
+        return hybrid[config & 1];
+    return celt[config & 3];
+}
+
+static int
+opus_samples(const unsigned char *buf, size_t nbytes)
+{
+    int nframes, samples;
+
+    switch (buf[0] & 3) {
+    case 0:
+        nframes = 1;
+        break;
+
+    case 1:
+    case 2:
+        nframes = 2;
+        break;
+
+    default:
+        if (nbytes < 2)
+            return RTP_NSAMPLES_UNKNOWN;
+        nframes = buf[1] & 0x3f;
+        break;
+    }
+    samples = nframes * opus_frame_samples(buf[0]);
+    /* No more than 120ms worth of audio in a packet */
+    if (samples == 0 || samples > 5760)
+        return RTP_NSAMPLES_UNKNOWN;
+    return samples;
+}
+
+/*
+ * Count frames in the AMR/AMR-WB payload by walking the table of contents,
+ * RFC 4867 4.3/4.4. Every ToC entry, NO_DATA included, is a 20ms frame.
+ */
+static int
+amr_frames(const unsigned char *buf, size_t nbytes, int octet_align)
+{
+    size_t bit, nbits;
+    int nframes;
+
+    if (octet_align) {
+        /* CMR octet, then a ToC octet per frame */
+        for (size_t i = 1; i < nbytes; i++) {
+            if ((buf[i] & 0x80) == 0)
+                return (int)i;
+        }
+        return RTP_NSAMPLES_UNKNOWN;
+    }
+    /* 4-bit CMR, then 6-bit ToC entries: F(1) FT(4) Q(1) */
+    nbits = nbytes * 8;
+    for (bit = 4, nframes = 1; bit + 6 <= nbits; bit += 6, nframes++) {
+        if ((buf[bit / 8] & (0x80 >> (bit % 8))) == 0)
+            return nframes;
+    }
+    return RTP_NSAMPLES_UNKNOWN;
+}
+
+static int
+ilbc_samples(size_t nbytes)
+{
+
+    /* 50 bytes per 30ms frame, 38 bytes per 20ms one */
+    if (nbytes % 50 == 0)
+        return 240 * (nbytes / 50);
+    if (nbytes % 38 == 0)
+        return 160 * (nbytes / 38);
+    return RTP_NSAMPLES_UNKNOWN;
+}
+
 static int
-rtp_calc_samples(int codec_id, size_t nbytes, const unsigned char *data)
+rtp_calc_samples(int codec_id, size_t nbytes, const unsigned char *data,
+  const struct rtp_profile *rpp, int flags)
 {
+    int n;
 
     switch (codec_id) {
         case RTP_PCMU:
@@ -158,13 +263,105 @@ rtp_calc_samples(int codec_id, size_t nbytes, const unsigned char *data)
         case RTP_G722:
             return nbytes;
 
+        case RTP_L16_MONO:
+        case RTP_L16_STEREO:
+        case RTP_L16:
+            return nbytes / (2 * (rpp->nchannels > 0 ? rpp->nchannels : 1));
+
+        case RTP_OPUS:
+            return opus_samples(data, nbytes);
+
+        case RTP_AMR:
+        case RTP_AMR_WB:
+            n = amr_frames(data, nbytes, flags & RTP_PTF_OCTET_ALIGN);
+            if (n == RTP_NSAMPLES_UNKNOWN)
+                return n;
+            return n * (codec_id == RTP_AMR ? 160 : 320);
+
+        case RTP_ILBC:
+            return ilbc_samples(nbytes);
+
+        case RTP_TEL_EVENT:
+            /* RFC 4733 event duration, from the event start */
+            if (nbytes < 4)
+                return RTP_NSAMPLES_UNKNOWN;
+            return (data[2] << 8) | data[3];
+
         default:
             return RTP_NSAMPLES_UNKNOWN;
     }
 }
 
+/*
+ * Common tail of the parsers, once the header layout has been validated.
+ */
+static rtp_parser_err_t
+rtp_packet_parse_fin(const rtp_hdr_t *header, unsigned int pt,
+  const unsigned char *buf, size_t size, int padding_size,
+  const struct rtp_ptmap *pm, struct rtp_info *rinfo)
+{
+    int codec_id, flags;
+
+    rinfo->data_size = size - rinfo->data_offset - padding_size;
+    rinfo->ts = ntohl(header->ts);
+    rinfo->seq = ntohs(header->seq);
+    rinfo->ssrc = ntohl(header->ssrc);
+    if (pm == NULL) {
+        rinfo->rtp_profile = &rtp_profiles[pt];
+        codec_id = pt;
+        flags = 0;
+    } else {
+        rinfo->rtp_profile = &pm->profiles[pt];
+        codec_id = pm->codecs[pt];
+        flags = pm->flags[pt];
+    }
+
+    if (rinfo->data_size == 0)
+        return RTP_PARSER_OK;
+
+    rinfo->nsamples = rtp_calc_samples(codec_id, rinfo->data_size,
+      &buf[rinfo->data_offset], rinfo->rtp_profile, flags);
+    /* 
+     * G.729 comfort noise frame as the last frame causes 
+     * packet to be non-appendable
+     */
+    if (codec_id == RTP_G729 && (rinfo->data_size % 10) != 0)
+        rinfo->appendable = 0;
+    return RTP_PARSER_OK;
+}
+
+/*
+ * Recreate the rinfo of a packet accepted by rtp_packet_parse_pm() before,
+ * out of the payload type, data offset and padding size it has found.
+ */
+void
+rtp_packet_parse_fill(const unsigned char *buf, size_t size, unsigned int pt,
+  unsigned int data_offset, int padding_size, const struct rtp_ptmap *pm,
+  struct rtp_info *rinfo)
+{
+
+    rinfo->data_offset = data_offset;
+    rinfo->appendable = 1;
+    rinfo->nsamples = RTP_NSAMPLES_UNKNOWN;
+    (void)rtp_packet_parse_fin((const rtp_hdr_t *)buf, pt, buf, size,
+      padding_size, pm, rinfo);
+}
+
 rtp_parser_err_t
 rtp_packet_parse_raw(const unsigned char *buf, size_t size, struct rtp_info *rinfo)
+{
+
+    return rtp_packet_parse_pm(buf, size, NULL, rinfo);
+}
+
+/*
+ * Same as rtp_packet_parse_raw(), but takes payload type map to look up
+ * profile and codec by, NULL selects the static rtp_profiles[]. The map
+ * has to outlive rtp_profile pointers stored into the rinfo.
+ */
+rtp_parser_err_t
+rtp_packet_parse_pm(const unsigned char *buf, size_t size,
+  const struct rtp_ptmap *pm, struct rtp_info *rinfo)
 {
     int padding_size;
     rtp_hdr_ext_t *hdr_ext_ptr;
@@ -209,22 +406,327 @@ rtp_packet_parse_raw(const unsigned char *buf, size_t size, struct rtp_info *rin
     if (size < rinfo->data_offset + padding_size)
         return RTP_PARSER_PTOOSHRTP;
 
-    rinfo->data_size = size - rinfo->data_offset - padding_size;
-    rinfo->ts = ntohl(header->ts);
-    rinfo->seq = ntohs(header->seq);
-    rinfo->ssrc = ntohl(header->ssrc);
-    rinfo->rtp_profile = &rtp_profiles[header->pt];
+    return rtp_packet_parse_fin(header, header->pt, buf, size, padding_size,
+      pm, rinfo);
+}
 
-    if (rinfo->data_size == 0)
-        return RTP_PARSER_OK;
+/*
+ * Tell apart protocols multiplexed on the same port by the first byte,
+ * RFC 7983 section 7, and RTP from RTCP by the payload type, RFC 5761
+ * section 4. Magic cookies and length fields are checked where cheap, so
+ * that junk is more likely to be left to the RTP parser to reject.
+ */
+enum rtp_mux_class
+rtp_mux_classify(const unsigned char *buf, size_t size)
+{
+    unsigned char b0;
+
+    if (size == 0)
+        return (RTP_MUX_UNKN);
+    b0 = buf[0];
+    if (b0 >= 128 && b0 <= 191) {
+        /* RTCP packet types 192-223 (200-204 in practice) */
+        if (size >= 8 && buf[1] >= 192 && buf[1] <= 223 &&
+          ((((size_t)buf[2] << 8) | buf[3]) + 1) * 4 <= size)
+            return (RTP_MUX_RTCP);
+        return (RTP_MUX_RTP);
+    }
+    if (b0 <= 3) {
+        if (size >= 20 && buf[4] == 0x21 && buf[5] == 0x12 &&
+          buf[6] == 0xa4 && buf[7] == 0x42)
+            return (RTP_MUX_STUN);
+        return (RTP_MUX_UNKN);
+    }
+    if (b0 >= 16 && b0 <= 19) {
+        if (size >= 12 && memcmp(buf + 4, "ZRTP", 4) == 0)
+            return (RTP_MUX_ZRTP);
+        return (RTP_MUX_UNKN);
+    }
+    if (b0 >= 20 && b0 <= 63) {
+        /* DTLS record header: type, version 0xfeff / 0xfefd */
+        if (size >= 13 && buf[1] == 0xfe && (buf[2] == 0xff || buf[2] == 0xfd))
+            return (RTP_MUX_DTLS);
+        return (RTP_MUX_UNKN);
+    }
+    if (b0 >= 64 && b0 <= 79) {
+        if (size >= 4 && (((size_t)buf[2] << 8) | buf[3]) + 4 <= size)
+            return (RTP_MUX_TURN);
+        return (RTP_MUX_UNKN);
+    }
+    return (RTP_MUX_UNKN);
+}
 
-    rinfo->nsamples = rtp_calc_samples(header->pt, rinfo->data_size,
-      &buf[rinfo->data_offset]);
-    /* 
-     * G.729 comfort noise frame as the last frame causes 
-     * packet to be non-appendable
-     */
-    if (header->pt == RTP_G729 && (rinfo->data_size % 10) != 0)
-        rinfo->appendable = 0;
-    return RTP_PARSER_OK;
+#define RTP_BATCH_LANES 16
+
+/*
+ * Return bitmask of the packets in the group of up to RTP_BATCH_LANES that
+ * have at least the fixed header, version 2 and neither padding nor
+ * extension bits set, i.e. can take the fast path.
+ */
+static unsigned int
+rtp_batch_plain_mask(const unsigned char *const bufs[], const size_t lens[],
+  int n)
+{
+    unsigned char b0[RTP_BATCH_LANES];
+    unsigned int mask;
+    int i;
+
+    for (i = 0; i < n; i++)
+        b0[i] = (lens[i] >= sizeof(rtp_hdr_t)) ? bufs[i][0] : 0;
+    for (; i < RTP_BATCH_LANES; i++)
+        b0[i] = 0;
+#if defined(RTP_SIMD_SSE2)
+    __m128i v = _mm_loadu_si128((const __m128i *)b0);
+    v = _mm_and_si128(v, _mm_set1_epi8((char)0xf0));
+    v = _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0x80));
+    mask = (unsigned int)_mm_movemask_epi8(v);
+#elif defined(RTP_SIMD_NEON)
+    static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+      1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t v = vld1q_u8(b0);
+    v = vceqq_u8(vandq_u8(v, vdupq_n_u8(0xf0)), vdupq_n_u8(0x80));
+    v = vandq_u8(v, vld1q_u8(bits));
+    mask = vaddv_u8(vget_low_u8(v)) | (vaddv_u8(vget_high_u8(v)) << 8);
+#else
+    mask = 0;
+    for (i = 0; i < RTP_BATCH_LANES; i++) {
+        if ((b0[i] & 0xf0) == 0x80)
+            mask |= 1U << i;
+    }
+#endif
+    return (mask);
+}
+
+/*
+ * Parse npkts datagrams at once, as received by recvmmsg(2) and friends.
+ * Plain headers are validated in groups with SIMD and parsed without any
+ * further branching on the header bits, packets with padding, extension
+ * or broken ones go through rtp_packet_parse_pm(). Result for each packet
+ * is stored into rvals[], returns the number of packets parsed OK.
+ */
+int
+rtp_packet_parse_batch(const unsigned char *const bufs[], const size_t lens[],
+  int npkts, const struct rtp_ptmap *pm, struct rtp_info rinfos[],
+  rtp_parser_err_t rvals[])
+{
+    int i, j, n, nok = 0;
+    unsigned int mask;
+
+    for (i = 0; i < npkts; i += RTP_BATCH_LANES) {
+        n = npkts - i;
+        if (n > RTP_BATCH_LANES)
+            n = RTP_BATCH_LANES;
+        mask = rtp_batch_plain_mask(&bufs[i], &lens[i], n);
+        for (j = 0; j < n; j++) {
+            const unsigned char *buf = bufs[i + j];
+            struct rtp_info *rinfo = &rinfos[i + j];
+            rtp_parser_err_t rval;
+
+            if ((mask & (1U << j)) == 0) {
+                rval = rtp_packet_parse_pm(buf, lens[i + j], pm, rinfo);
+            } else {
+                const rtp_hdr_t *header = (const rtp_hdr_t *)buf;
+
+                rinfo->data_size = 0;
+                rinfo->appendable = 1;
+                rinfo->nsamples = RTP_NSAMPLES_UNKNOWN;
+                rinfo->data_offset = RTP_HDR_LEN(header);
+                if (lens[i + j] < rinfo->data_offset)
+                    rval = RTP_PARSER_PTOOSHRTXH;
+                else
+                    rval = rtp_packet_parse_fin(header, header->pt, buf,
+                      lens[i + j], 0, pm, rinfo);
+            }
+            rvals[i + j] = rval;
+            nok += (rval == RTP_PARSER_OK);
+        }
+    }
+    return (nok);
+}
+
+/*
+ * Set up iterator over the RFC 8285 header extension elements of the
+ * packet. Nothing is copied, elements returned point into the buf. Returns
+ * 0 on success or -1 if the packet carries no (or non-RFC 8285, or
+ * truncated) extension block.
+ */
+int
+rtp_hdrext_iter_init(struct rtp_hdrext_iter *ip, const unsigned char *buf,
+  size_t size)
+{
+    const rtp_hdr_t *header;
+    const rtp_hdr_ext_t *hdr_ext_ptr;
+    size_t off, elen;
+    uint16_t profile;
+
+    header = (const rtp_hdr_t *)buf;
+    if (size < sizeof(*header) || header->version != 2 || header->x == 0)
+        return (-1);
+    off = RTP_HDR_LEN(header);
+    if (size < off + sizeof(*hdr_ext_ptr))
+        return (-1);
+    hdr_ext_ptr = (const rtp_hdr_ext_t *)&buf[off];
+    elen = ntohs(hdr_ext_ptr->length) * sizeof(hdr_ext_ptr->extension[0]);
+    off += sizeof(*hdr_ext_ptr);
+    if (size < off + elen)
+        return (-1);
+    profile = ntohs(hdr_ext_ptr->profile);
+    if (profile == RTP_HDREXT_ONEBYTE)
+        ip->twobyte = 0;
+    else if ((profile & RTP_HDREXT_TWOBYTE_MASK) == RTP_HDREXT_TWOBYTE)
+        ip->twobyte = 1;
+    else
+        return (-1);
+    ip->p = &buf[off];
+    ip->end = ip->p + elen;
+    return (0);
+}
+
+/*
+ * Fetch next extension element. Returns 1 if the element has been stored
+ * into ep, 0 at the end of the list or -1 if the block is malformed.
+ */
+int
+rtp_hdrext_iter_next(struct rtp_hdrext_iter *ip, struct rtp_hdrext_elt *ep)
+{
+    const unsigned char *p;
+    unsigned int len;
+    int id;
+
+    for (p = ip->p; p < ip->end && *p == 0; p++)
+        continue;
+    if (p == ip->end) {
+        ip->p = p;
+        return (0);
+    }
+    if (ip->twobyte == 0) {
+        id = *p >> 4;
+        if (id == 15) {
+            /* Reserved, processing has to stop here */
+            ip->p = ip->end;
+            return (0);
+        }
+        len = (*p & 0x0f) + 1;
+        p += 1;
+    } else {
+        if (ip->end - p < 2)
+            return (-1);
+        id = p[0];
+        len = p[1];
+        p += 2;
+    }
+    if ((size_t)(ip->end - p) < len)
+        return (-1);
+    ep->id = id;
+    ep->len = len;
+    ep->data = p;
+    ip->p = p + len;
+    return (1);
+}
+
+static const struct {
+    const char *name;
+    int codec_id;
+} rtp_codec_names[] = {
+    {"PCMU", RTP_PCMU},
+    {"GSM", RTP_GSM},
+    {"G723", RTP_G723},
+    {"PCMA", RTP_PCMA},
+    {"G722", RTP_G722},
+    {"G729", RTP_G729},
+    {"opus", RTP_OPUS},
+    {"AMR", RTP_AMR},
+    {"AMR-WB", RTP_AMR_WB},
+    {"iLBC", RTP_ILBC},
+    {"L16", RTP_L16},
+    {"telephone-event", RTP_TEL_EVENT},
+    {NULL, RTP_UNKN}
+};
+
+void
+rtp_ptmap_init(struct rtp_ptmap *pm)
+{
+
+    memcpy(pm->profiles, rtp_profiles, sizeof(pm->profiles));
+    for (int i = 0; i < 128; i++)
+        pm->codecs[i] = i;
+    memset(pm->flags, '\0', sizeof(pm->flags));
+}
+
+/*
+ * Bind payload type to the codec out of the SDP a=rtpmap value
+ * ("opus/48000/2") and optionally a=fmtp one. Codecs not known to the
+ * parser are still registered, with the number of samples left unknown.
+ * Returns 0 on success or -1 if the pt or rtpmap is invalid.
+ */
+int
+rtp_ptmap_set(struct rtp_ptmap *pm, int pt, const char *rtpmap,
+  const char *fmtp)
+{
+    struct rtp_profile rp = {.pt_kind = RTP_PTK_AUDIO, .nchannels = 1};
+    const char *cp;
+    size_t nlen;
+    int codec_id = RTP_UNKN;
+    char *ep;
+    long v;
+
+    if (pt < 0 || pt > 127)
+        return (-1);
+    cp = strchr(rtpmap, '/');
+    if (cp == NULL || cp == rtpmap)
+        return (-1);
+    nlen = cp - rtpmap;
+    v = strtol(cp + 1, &ep, 10);
+    if (ep == cp + 1 || v <= 0 || v > INT32_MAX)
+        return (-1);
+    rp.ts_rate = rp.sample_rate = (int)v;
+    if (*ep == '/') {
+        cp = ep + 1;
+        v = strtol(cp, &ep, 10);
+        if (ep == cp || v <= 0 || v > 255)
+            return (-1);
+        rp.nchannels = (int)v;
+    }
+    if (*ep != '\0')
+        return (-1);
+
+    for (int i = 0; rtp_codec_names[i].name != NULL; i++) {
+        const char *np = rtp_codec_names[i].name;
+        size_t j;
+
+        if (strlen(np) != nlen)
+            continue;
+        for (j = 0; j < nlen; j++) {
+            if (tolower((unsigned char)np[j]) != tolower((unsigned char)rtpmap[j]))
+                break;
+        }
+        if (j == nlen) {
+            codec_id = rtp_codec_names[i].codec_id;
+            break;
+        }
+    }
+    switch (codec_id) {
+    case RTP_G722:
+        /* Historic quirk, clock rate is that of G.711 */
+        rp.sample_rate = 16000;
+        break;
+
+    case RTP_TEL_EVENT:
+        rp.pt_kind = RTP_PTK_SIGN;
+        break;
+
+    case RTP_UNKN:
+        rp.pt_kind = RTP_PTK_UNK;
+        break;
+
+    default:
+        break;
+    }
+
+    pm->profiles[pt] = rp;
+    pm->codecs[pt] = codec_id;
+    pm->flags[pt] = 0;
+    if (fmtp != NULL && strstr(fmtp, "octet-align=1") != NULL)
+        pm->flags[pt] |= RTP_PTF_OCTET_ALIGN;
+    return (0);
 }
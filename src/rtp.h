@@ -51,7 +51,14 @@ enum rtp_type {
     RTP_DVI4_22050 = 17,
     RTP_G729 = 18,
     RTP_TSE = 100,
-    RTP_TSE_CISCO = 101
+    RTP_TSE_CISCO = 101,
+    /* Dynamic codecs, only ever come out of the struct rtp_ptmap */
+    RTP_OPUS = 128,
+    RTP_AMR = 129,
+    RTP_AMR_WB = 130,
+    RTP_ILBC = 131,
+    RTP_L16 = 132,
+    RTP_TEL_EVENT = 133
 };
 
 enum rtp_pt_kind {RTP_PTK_AUDIO, RTP_PTK_VIDEO, RTP_PTK_SIGN, RTP_PTK_RES, RTP_PTK_UNK = 0};
@@ -65,6 +72,19 @@ struct rtp_profile {
 
 extern const struct rtp_profile rtp_profiles[];
 
+/* Payload format flags */
+#define RTP_PTF_OCTET_ALIGN	0x1	/* AMR/AMR-WB octet-aligned mode */
+
+/*
+ * Payload type map, to be populated out of the SDP rtpmap/fmtp. Starts
+ * off as a copy of the static rtp_profiles[].
+ */
+struct rtp_ptmap {
+    struct rtp_profile profiles[128];
+    short codecs[128];
+    unsigned char flags[128];
+};
+
 typedef enum rtp_type rtp_type_t;
 
 #define RTP_NSAMPLES_UNKNOWN  (-1)
@@ -146,6 +166,60 @@ typedef enum {
     RTP_PARSER_IPS = -7,
 } rtp_parser_err_t;
 
+/*
+ * What shares the port with RTP, by the first byte (RFC 7983, RFC 5761)
+ */
+enum rtp_mux_class {
+    RTP_MUX_UNKN = 0,
+    RTP_MUX_RTP,
+    RTP_MUX_RTCP,
+    RTP_MUX_STUN,
+    RTP_MUX_ZRTP,
+    RTP_MUX_DTLS,
+    RTP_MUX_TURN
+};
+
 struct rtp_info;
 
 rtp_parser_err_t rtp_packet_parse_raw(const unsigned char *, size_t, struct rtp_info *);
+rtp_parser_err_t rtp_packet_parse_pm(const unsigned char *, size_t,
+  const struct rtp_ptmap *, struct rtp_info *);
+int rtp_packet_parse_batch(const unsigned char *const *, const size_t *, int,
+  const struct rtp_ptmap *, struct rtp_info *, rtp_parser_err_t *);
+
+enum rtp_mux_class rtp_mux_classify(const unsigned char *, size_t);
+
+void rtp_ptmap_init(struct rtp_ptmap *);
+int rtp_ptmap_set(struct rtp_ptmap *, int, const char *, const char *);
+
+/*
+ * RFC 8285 header extensions
+ */
+#define RTP_HDREXT_ONEBYTE	0xBEDE
+#define RTP_HDREXT_TWOBYTE	0x1000
+#define RTP_HDREXT_TWOBYTE_MASK	0xFFF0
+
+#define RTP_HDREXT_ONEBYTE_MAXID	14
+#define RTP_HDREXT_ONEBYTE_MAXLEN	16
+
+/* RFC 6464 client-to-mixer audio level, level is -dBov (0..127) */
+#define RTP_HDREXT_AUDIO_LEVEL(vad, level) \
+  ((uint8_t)((((vad) != 0) << 7) | ((level) & 0x7f)))
+/* abs-send-time, 6.18 fixed point seconds out of ns, reduced mod 64 s first */
+#define RTP_HDREXT_ABS_SEND_TIME(ns) \
+  ((uint32_t)((((uint64_t)(ns) % 64000000000ULL) << 18) / 1000000000ULL))
+
+struct rtp_hdrext_iter {
+    const unsigned char *p;
+    const unsigned char *end;
+    int twobyte;
+};
+
+struct rtp_hdrext_elt {
+    int id;
+    unsigned int len;
+    const unsigned char *data;
+};
+
+int rtp_hdrext_iter_init(struct rtp_hdrext_iter *, const unsigned char *, size_t);
+int rtp_hdrext_iter_next(struct rtp_hdrext_iter *, struct rtp_hdrext_elt *);
@@ -27,108 +27,140 @@
 #endif
 
 int
-rtp_sync_waiter_init(rtp_sync_waiter *waiter)
+rtp_sync_completion_init(rtp_sync_completion *comp)
 {
-    assert(waiter != NULL);
-    if (pthread_mutex_init(&waiter->lock, NULL) != 0)
+    assert(comp != NULL);
+    if (pthread_mutex_init(&comp->lock, NULL) != 0)
         return -1;
-    if (pthread_cond_init(&waiter->cv, NULL) != 0) {
-        pthread_mutex_destroy(&waiter->lock);
+    if (pthread_cond_init(&comp->cv, NULL) != 0) {
+        pthread_mutex_destroy(&comp->lock);
         return -1;
     }
-    waiter->done = 0;
-    waiter->status = 0;
+    comp->pending = 0;
+    comp->status = 0;
     return 0;
 }
 
 void
-rtp_sync_waiter_destroy(rtp_sync_waiter *waiter)
+rtp_sync_completion_destroy(rtp_sync_completion *comp)
 {
-    assert(waiter != NULL);
-    pthread_cond_destroy(&waiter->cv);
-    pthread_mutex_destroy(&waiter->lock);
+    assert(comp != NULL);
+    assert(comp->pending == 0);
+    pthread_cond_destroy(&comp->cv);
+    pthread_mutex_destroy(&comp->lock);
 }
 
-int
-rtp_sync_waiter_reset(rtp_sync_waiter *waiter)
+void
+rtp_sync_completion_get(rtp_sync_completion *comp)
 {
-    if (pthread_mutex_lock(&waiter->lock) != 0)
-        return -1;
-    waiter->done = 0;
-    waiter->status = 0;
-    pthread_mutex_unlock(&waiter->lock);
-    return 0;
+    int rc;
+
+    assert(comp != NULL);
+    rc = pthread_mutex_lock(&comp->lock);
+    assert(rc == 0);
+    if (rc != 0)
+        return;
+    comp->pending += 1;
+    rc = pthread_mutex_unlock(&comp->lock);
+    assert(rc == 0);
 }
 
 void
-rtp_sync_waiter_complete(rtp_sync_waiter *waiter, int status)
+rtp_sync_completion_put(rtp_sync_completion *comp, int status)
 {
     int rc;
 
-    assert(waiter != NULL);
-    rc = pthread_mutex_lock(&waiter->lock);
+    assert(comp != NULL);
+    rc = pthread_mutex_lock(&comp->lock);
     assert(rc == 0);
     if (rc != 0)
         return;
-    waiter->status = status;
-    waiter->done = 1;
-    pthread_cond_signal(&waiter->cv);
-    rc = pthread_mutex_unlock(&waiter->lock);
+    assert(comp->pending > 0);
+    if (status != 0 && comp->status == 0)
+        comp->status = status;
+    comp->pending -= 1;
+    if (comp->pending == 0)
+        pthread_cond_broadcast(&comp->cv);
+    rc = pthread_mutex_unlock(&comp->lock);
     assert(rc == 0);
 }
 
 int
-rtp_sync_waiter_wait(rtp_sync_waiter *waiter)
+rtp_sync_completion_wait(rtp_sync_completion *comp)
 {
     int status = -1;
-    assert(waiter != NULL);
-    if (pthread_mutex_lock(&waiter->lock) != 0)
+
+    assert(comp != NULL);
+    if (pthread_mutex_lock(&comp->lock) != 0)
         return status;
-    while (!waiter->done)
-        (void)pthread_cond_wait(&waiter->cv, &waiter->lock);
-    status = waiter->status;
-    pthread_mutex_unlock(&waiter->lock);
+    while (comp->pending != 0)
+        (void)pthread_cond_wait(&comp->cv, &comp->lock);
+    status = comp->status;
+    comp->status = 0;
+    pthread_mutex_unlock(&comp->lock);
     return status;
 }
 
+#define CMD_NEXT(cmdq, cmd) ((void **)(((char *)(cmd)) + (cmdq)->next_off))
+
 void
+rtp_sync_cmdq_init(rtp_sync_cmdq *cmdq, size_t next_off)
+{
+    assert(cmdq != NULL);
+    atomic_init(&cmdq->head, NULL);
+    cmdq->next_off = next_off;
+}
+
+/*
+ * Returns 1 if the queue was empty, in which case the caller is the one
+ * to wake the consumer up.
+ */
+int
 rtp_sync_cmdq_push(rtp_sync_cmdq *cmdq, void *cmd)
 {
-    void **cmd_next;
+    void *head;
 
     assert(cmdq != NULL);
-    assert(cmdq->head != NULL);
-    assert(cmdq->tail != NULL);
     assert(cmd != NULL);
 
-    cmd_next = (void **)(((char *)cmd) + cmdq->next_off);
-    *cmd_next = NULL;
-
-    if (*cmdq->tail != NULL) {
-        void **tail_next = (void **)(((char *)*cmdq->tail) + cmdq->next_off);
-        *tail_next = cmd;
-        *cmdq->tail = cmd;
-    } else {
-        *cmdq->head = cmd;
-        *cmdq->tail = cmd;
-    }
+    head = atomic_load_explicit(&cmdq->head, memory_order_relaxed);
+    do {
+        *CMD_NEXT(cmdq, cmd) = head;
+    } while (!atomic_compare_exchange_weak_explicit(&cmdq->head, &head, cmd,
+        memory_order_release, memory_order_relaxed));
+    return (head == NULL);
 }
 
+/*
+ * Takes everything pushed so far, producers push onto the head so the list
+ * is reversed to hand the commands out in the order they were queued.
+ */
 void *
 rtp_sync_cmdq_detach_all(rtp_sync_cmdq *cmdq)
 {
-    void *out;
+    void *cmd, *out = NULL;
 
     assert(cmdq != NULL);
-    assert(cmdq->head != NULL);
-    assert(cmdq->tail != NULL);
 
-    out = *cmdq->head;
-    *cmdq->head = NULL;
-    *cmdq->tail = NULL;
+    if (atomic_load_explicit(&cmdq->head, memory_order_relaxed) == NULL)
+        return NULL;
+    cmd = atomic_exchange_explicit(&cmdq->head, NULL, memory_order_acquire);
+    while (cmd != NULL) {
+        void *next = *CMD_NEXT(cmdq, cmd);
+        *CMD_NEXT(cmdq, cmd) = out;
+        out = cmd;
+        cmd = next;
+    }
     return out;
 }
 
+int
+rtp_sync_cmdq_empty(rtp_sync_cmdq *cmdq)
+{
+    assert(cmdq != NULL);
+    return (atomic_load_explicit(&cmdq->head, memory_order_relaxed) == NULL);
+}
+
 int
 rtp_sync_cond_timedwait_abs_ns(rtp_sync_cond_ctx *cond_ctx, uint64_t abs_ns)
 {
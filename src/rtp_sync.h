@@ -1,20 +1,28 @@
 #pragma once
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
+/*
+ * Counts the commands in flight for one owner, wait() returns once all of
+ * them are done with the first non-zero status seen since the last wait().
+ */
 typedef struct {
     pthread_mutex_t lock;
     pthread_cond_t cv;
-    int done;
+    unsigned long pending;
     int status;
-} rtp_sync_waiter;
+} rtp_sync_completion;
 
+/*
+ * Lock-free multi-producer, single-consumer queue of commands linked
+ * through the pointer at next_off.
+ */
 typedef struct {
-    void **head;
-    void **tail;
+    _Atomic(void *) head;
     size_t next_off;
 } rtp_sync_cmdq;
 
@@ -24,14 +32,16 @@ typedef struct {
     clockid_t *clock_id;
 } rtp_sync_cond_ctx;
 
-int rtp_sync_waiter_init(rtp_sync_waiter *waiter);
-void rtp_sync_waiter_destroy(rtp_sync_waiter *waiter);
-int rtp_sync_waiter_reset(rtp_sync_waiter *waiter);
-void rtp_sync_waiter_complete(rtp_sync_waiter *waiter, int status);
-int rtp_sync_waiter_wait(rtp_sync_waiter *waiter);
+int rtp_sync_completion_init(rtp_sync_completion *comp);
+void rtp_sync_completion_destroy(rtp_sync_completion *comp);
+void rtp_sync_completion_get(rtp_sync_completion *comp);
+void rtp_sync_completion_put(rtp_sync_completion *comp, int status);
+int rtp_sync_completion_wait(rtp_sync_completion *comp);
 
-void rtp_sync_cmdq_push(rtp_sync_cmdq *cmdq, void *cmd);
+void rtp_sync_cmdq_init(rtp_sync_cmdq *cmdq, size_t next_off);
+int rtp_sync_cmdq_push(rtp_sync_cmdq *cmdq, void *cmd);
 void *rtp_sync_cmdq_detach_all(rtp_sync_cmdq *cmdq);
+int rtp_sync_cmdq_empty(rtp_sync_cmdq *cmdq);
 
 int rtp_sync_cond_timedwait_abs_ns(rtp_sync_cond_ctx *cond_ctx, uint64_t abs_ns);
 int rtp_sync_cond_timedwait_ns(rtp_sync_cond_ctx *cond_ctx, uint64_t wait_ns);
@@ -11,6 +11,7 @@
 #include "rtp.h"
 #include "rtp_info.h"
 #include "rtpjbuf.h"
+#include "rtpsynth_int.h"
 
 #define LRS_DEFAULT ((uint64_t)-1)
 #define LMS_DEFAULT LRS_DEFAULT
@@ -28,25 +29,119 @@
 
 #if defined(_WIN32) || defined(_WIN64)
 #pragma comment(linker, "/export:rtpjbuf_ctor")
+#pragma comment(linker, "/export:rtpjbuf_ctor_owned")
 #pragma comment(linker, "/export:rtpjbuf_dtor")
 #pragma comment(linker, "/export:rtpjbuf_frame_dtor")
+#pragma comment(linker, "/export:rtpjbuf_frame_size")
 #pragma comment(linker, "/export:rtpjbuf_udp_in")
+#pragma comment(linker, "/export:rtpjbuf_udp_in_many")
+#pragma comment(linker, "/export:rtpjbuf_udp_in_at")
+#pragma comment(linker, "/export:rtpjbuf_set_adaptive")
+#pragma comment(linker, "/export:rtpjbuf_get_delay")
+#pragma comment(linker, "/export:rtpjbuf_get_stats")
+#pragma comment(linker, "/export:rtpjbuf_set_pull")
+#pragma comment(linker, "/export:rtpjbuf_pull")
 #pragma comment(linker, "/export:rtpjbuf_flush")
+#pragma comment(linker, "/export:rtpjbuf_set_ptmap")
+#pragma comment(linker, "/export:rtpjbuf_set_restart")
 #endif
 
+/*
+ * Queued packets are only represented by the compact descriptors, so that
+ * the list walks and the ring lookups stay within a small, contiguous pool.
+ * The full struct rtp_frame (rtp_info and all) is built on release, in the
+ * slot that goes out via the ready / drop list.
+ */
+struct rjb_fdesc {
+    struct rjb_fdesc *next;
+    const unsigned char *data;
+    uint32_t lseq_off;          /* from jb.lseq_base */
+    unsigned int jbcnt;
+    uint16_t data_off;
+    uint16_t size;
+    uint8_t pt;
+    uint8_t flags;
+};
+_Static_assert(sizeof(struct rjb_fdesc) <= 32, "rjb_fdesc is too large");
+
+#define RJB_DF_PAD 0x1          /* padded, the count is in the last byte */
+
+/*
+ * Frames are kept in a list sorted by the logical SEQ. The list prefix that
+ * fits into [head, head + rmask] is also indexed by lseq & rmask in a
+ * power-of-two slot ring, with the occupancy bitmap in rocc, so that in-order
+ * inserts, duplicate checks and the tail purge do not need to walk the list.
+ * Frames that are too far ahead (i.e. SEQ jumps) are only linked after rlast
+ * and get indexed as the head moves forward.
+ */
 struct jitter_buffer {
-    struct rtp_frame *head;
+    struct rjb_fdesc *head;
+    struct rjb_fdesc *tail;
     unsigned int size;
     unsigned int capacity;
+    unsigned int depth;
+    struct rjb_fdesc *rlast;
+    uint64_t rmask;
+    uint64_t *rocc;
+    struct rjb_fdesc **rslots;
+    struct rjb_fdesc *dfree;
+    uint64_t lseq_base;
 };
 
-struct rtpjbuf_stats {
-    struct {
-        uint64_t dup;
-        uint64_t late;
-        uint64_t perror;
-    } drop;
-    uint64_t seq_wup;
+#define RJB_RING_MIN 64
+
+/* RFC 3550 A.1 */
+#define RJB_MAX_DROPOUT 3000
+#define RJB_MAX_MISORDER 100
+
+/* Target playout delay in the adaptive mode, multiple of the jitter */
+#define RJB_JITTER_MULT 4
+#define RJB_PTIME_DFLT_MS 20
+
+/*
+ * Adaptive depth: interarrival jitter as per RFC 3550 A.8 (scaled by 16,
+ * RTP clock units) drives the target delay within [min_ms, max_ms], which
+ * is then converted into the number of packets the buffer holds for a gap.
+ */
+struct rjb_adapt {
+    unsigned int min_ms;
+    unsigned int max_ms;
+    unsigned int target_ms;
+    int ts_rate;
+    uint32_t jitter;
+    int32_t last_transit;
+    uint32_t last_ts;
+    uint16_t last_seq;
+    int have_last;
+    uint32_t ptime_ts;
+};
+
+/*
+ * Frames come from the per-buffer slab, with the heap used only as a
+ * fallback when the caller holds onto more than capacity + 1 of them.
+ * The slab may outlive its buffer, it is released once the last frame
+ * has been returned. In the owned-copy mode each slot also has its own
+ * mtu-sized piece of the arena that follows the slots and is taken when
+ * the packet is copied in. Otherwise slots are taken on release only, so
+ * the heap ones are set aside in advance for the queued packets to never
+ * run out.
+ */
+struct rjb_slab;
+
+struct rjb_fslot {
+    struct rtp_frame frame;
+    struct rjb_slab *owner;
+    unsigned char *buf;
+    size_t size;                /* datagram size, RFT_RTP only */
+};
+
+struct rjb_slab {
+    struct rjb_fslot *free;
+    unsigned int nslots;
+    unsigned int nout;
+    int dead;
+    unsigned int mtu;
+    struct rjb_fslot slots[];
 };
 
 struct rtpjbuf_inst {
@@ -57,6 +152,34 @@ struct rtpjbuf_inst {
     struct jitter_buffer jb;
     struct rtpjbuf_stats jbs;
     struct rtp_frame ers_frame;
+    const struct rtp_ptmap *pm;
+    struct rjb_slab *slab;
+    struct rjb_fslot *spare;
+    unsigned int nspare;
+    struct rtp_frame *efs;
+    unsigned int nefs;
+    struct rjb_adapt adapt;
+    struct {
+        int on;
+        uint64_t delay_ns;
+        uint64_t max_hold_ns;
+        uint64_t now;
+        /* Playout clock: frame with ts0 is due at base_ns */
+        int have_base;
+        uint64_t base_ns;
+        uint32_t ts0;
+        int rate;
+    } pull;
+    struct rtp_frame rst_frame;
+    struct {
+        unsigned int flags;
+        unsigned int probation;
+        int have_ssrc;
+        uint32_t ssrc;
+        unsigned int nprobe;
+        uint32_t probe_ssrc;
+        uint16_t probe_seq;
+    } rst;
 };
 
 static void
@@ -66,55 +189,445 @@ d_assert(int invar)
         abort();
 }
 
+static inline int
+rjb_fls64(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (63 - __builtin_clzll(w));
+#else
+    int r = 0;
+
+    while (w >>= 1)
+        r++;
+    return (r);
+#endif
+}
+
+static inline uint64_t
+rjb_dlseq(const struct jitter_buffer *jbp, const struct rjb_fdesc *dp)
+{
+
+    return (jbp->lseq_base + dp->lseq_off);
+}
+
+static inline int
+rjb_ring_isset(const struct jitter_buffer *jbp, uint64_t lseq)
+{
+    uint64_t idx = lseq & jbp->rmask;
+
+    return ((jbp->rocc[idx / 64] >> (idx % 64)) & 1);
+}
+
+static inline void
+rjb_ring_set(struct jitter_buffer *jbp, struct rjb_fdesc *dp)
+{
+    uint64_t idx = rjb_dlseq(jbp, dp) & jbp->rmask;
+
+    jbp->rslots[idx] = dp;
+    jbp->rocc[idx / 64] |= (uint64_t)1 << (idx % 64);
+}
+
+static inline void
+rjb_ring_clr(struct jitter_buffer *jbp, uint64_t lseq)
+{
+    uint64_t idx = lseq & jbp->rmask;
+
+    jbp->rocc[idx / 64] &= ~((uint64_t)1 << (idx % 64));
+}
+
+/*
+ * Find indexed frame with the largest lseq below the given one, looking no
+ * further back than lo.
+ */
+static struct rjb_fdesc *
+rjb_ring_prev(const struct jitter_buffer *jbp, uint64_t lseq, uint64_t lo)
+{
+    uint64_t left, idx;
+
+    if (lseq <= lo)
+        return (NULL);
+    for (left = lseq - lo; left > 0;) {
+        idx = (lseq - 1) & jbp->rmask;
+        unsigned int bit = idx % 64;
+        uint64_t w = jbp->rocc[idx / 64];
+        if (bit < 63)
+            w &= ((uint64_t)1 << (bit + 1)) - 1;
+        if (w != 0) {
+            unsigned int dist = bit - rjb_fls64(w);
+            if (dist >= left)
+                return (NULL);
+            return (jbp->rslots[(idx - dist) & jbp->rmask]);
+        }
+        if (left <= bit + 1)
+            return (NULL);
+        left -= bit + 1;
+        lseq -= bit + 1;
+    }
+    return (NULL);
+}
+
+/* Index frames following rlast that fit into the window after head moved */
+static void
+rjb_ring_extend(struct jitter_buffer *jbp)
+{
+    struct rjb_fdesc *idp;
+    uint64_t wend;
+
+    if (jbp->head == NULL)
+        return;
+    wend = rjb_dlseq(jbp, jbp->head) + jbp->rmask;
+    idp = (jbp->rlast != NULL) ? jbp->rlast->next : jbp->head;
+    for (; idp != NULL && rjb_dlseq(jbp, idp) <= wend; idp = idp->next) {
+        rjb_ring_set(jbp, idp);
+        jbp->rlast = idp;
+    }
+}
+
+/* Take the run from the head up to and including ldp off the buffer */
+static void
+rjb_detach_head(struct jitter_buffer *jbp, struct rjb_fdesc *ldp)
+{
+    struct rjb_fdesc *dp = jbp->head;
+
+    jbp->head = ldp->next;
+    if (jbp->head == NULL)
+        jbp->tail = NULL;
+    /* Released run is a list prefix, so is the indexed part of it */
+    for (struct rjb_fdesc *rdp = dp; ; rdp = rdp->next) {
+        rjb_ring_clr(jbp, rjb_dlseq(jbp, rdp));
+        if (rdp == jbp->rlast) {
+            jbp->rlast = NULL;
+            break;
+        }
+        if (rdp == ldp)
+            break;
+    }
+    rjb_ring_extend(jbp);
+}
+
+static struct rjb_fdesc *
+rjb_desc_alloc(struct jitter_buffer *jbp, uint64_t lseq,
+  const struct rtp_info *rip, const unsigned char *data, size_t size)
+{
+    const rtp_hdr_t *hp = (const rtp_hdr_t *)data;
+    struct rjb_fdesc *dp;
+
+    /* Never holds more than capacity frames, the pool has one spare */
+    dp = jbp->dfree;
+    d_assert(dp != NULL);
+    jbp->dfree = dp->next;
+    /*
+     * Anything queued after this is at most one 64K range of lseq below,
+     * as it has to be in or before the current range.
+     */
+    if (jbp->head == NULL)
+        jbp->lseq_base = lseq - 0x20000;
+    d_assert(lseq - jbp->lseq_base <= UINT32_MAX);
+    dp->lseq_off = lseq - jbp->lseq_base;
+    dp->next = NULL;
+    dp->data = data;
+    dp->jbcnt = 0;
+    dp->data_off = rip->data_offset;
+    dp->size = size;
+    dp->pt = hp->pt;
+    dp->flags = (hp->p != 0) ? RJB_DF_PAD : 0;
+    return (dp);
+}
+
+static inline uint32_t
+rjb_desc_ts(const struct rjb_fdesc *dp)
+{
+
+    return (ntohl(((const rtp_hdr_t *)dp->data)->ts));
+}
+
+static inline void
+rjb_desc_free(struct jitter_buffer *jbp, struct rjb_fdesc *dp)
+{
+
+    dp->next = jbp->dfree;
+    jbp->dfree = dp;
+}
+
+static struct rjb_fslot *
+rjb_slot_get(struct rtpjbuf_inst *rjbp)
+{
+    struct rjb_slab *sp = rjbp->slab;
+    struct rjb_fslot *fsp;
+
+    fsp = sp->free;
+    if (fsp != NULL) {
+        sp->free = (struct rjb_fslot *)fsp->frame.next;
+        sp->nout += 1;
+        return (fsp);
+    }
+    fsp = rjbp->spare;
+    if (fsp != NULL) {
+        rjbp->spare = (struct rjb_fslot *)fsp->frame.next;
+        rjbp->nspare -= 1;
+        return (fsp);
+    }
+    fsp = malloc(sizeof(struct rjb_fslot) + sp->mtu);
+    if (fsp == NULL)
+        return (NULL);
+    fsp->owner = NULL;
+    fsp->buf = (sp->mtu != 0) ? (unsigned char *)(fsp + 1) : NULL;
+    return (fsp);
+}
+
+/*
+ * Zero-copy mode: have a slot ready for each of the queued packets and the
+ * incoming one, whichever of them is to go out.
+ */
+static int
+rjb_slot_reserve(struct rtpjbuf_inst *rjbp)
+{
+    struct rjb_slab *sp = rjbp->slab;
+    struct rjb_fslot *fsp;
+
+    if (sp->mtu != 0)
+        return (0);
+    while (sp->nslots - sp->nout + rjbp->nspare <= rjbp->jb.size) {
+        fsp = malloc(sizeof(struct rjb_fslot));
+        if (fsp == NULL)
+            return (-1);
+        fsp->owner = NULL;
+        fsp->buf = NULL;
+        fsp->frame.next = (struct rtp_frame *)rjbp->spare;
+        rjbp->spare = fsp;
+        rjbp->nspare += 1;
+    }
+    return (0);
+}
+
+/* Owned-copy mode: the slot that the packet has been copied into */
+static struct rjb_fslot *
+rjb_slot_of(struct rjb_slab *sp, const unsigned char *data)
+{
+    const unsigned char *arena = (const unsigned char *)&sp->slots[sp->nslots];
+
+    if (data >= arena && data < arena + (size_t)sp->nslots * sp->mtu)
+        return (&sp->slots[(size_t)(data - arena) / sp->mtu]);
+    /* Heap fallback, the data follows the slot */
+    return ((struct rjb_fslot *)(void *)data - 1);
+}
+
+static struct rtp_frame *
+rjb_frame_init(struct rjb_fslot *fsp, uint64_t lseq, unsigned int jbcnt,
+  const unsigned char *data, size_t size)
+{
+
+    fsp->frame.type = RFT_RTP;
+    fsp->frame.rtp.lseq = lseq;
+    fsp->frame.rtp.jbcnt = jbcnt;
+    fsp->frame.rtp.data = data;
+    fsp->frame.next = NULL;
+    fsp->size = size;
+    return (&fsp->frame);
+}
+
+/* Build the frame of the queued packet, in the slot that is there for it */
+static struct rtp_frame *
+rjb_desc_frame(struct rtpjbuf_inst *rjbp, const struct rjb_fdesc *dp)
+{
+    struct rjb_fslot *fsp;
+    struct rtp_frame *fp;
+
+    if (rjbp->slab->mtu != 0)
+        fsp = rjb_slot_of(rjbp->slab, dp->data);
+    else
+        fsp = rjb_slot_get(rjbp);
+    d_assert(fsp != NULL);
+    fp = rjb_frame_init(fsp, rjb_dlseq(&rjbp->jb, dp), dp->jbcnt, dp->data,
+      dp->size);
+    rtp_packet_parse_fill(dp->data, dp->size, dp->pt, dp->data_off,
+      (dp->flags & RJB_DF_PAD) ? dp->data[dp->size - 1] : 0, rjbp->pm,
+      &fp->rtp.info);
+    return (fp);
+}
+
+/*
+ * Turn the detached run of descriptors from dp up to and including ldp (or
+ * the end of the list if NULL) into the list of frames to hand out.
+ */
+static struct rtp_frame *
+rjb_desc_release(struct rtpjbuf_inst *rjbp, struct rjb_fdesc *dp,
+  struct rjb_fdesc *ldp, struct rtp_frame **lfpp)
+{
+    struct rtp_frame *fp, *hfp, **tailp;
+    struct rjb_fdesc *ndp;
+
+    tailp = &hfp;
+    for (;; dp = ndp) {
+        ndp = (dp == ldp) ? NULL : dp->next;
+        fp = rjb_desc_frame(rjbp, dp);
+        *tailp = fp;
+        tailp = &fp->next;
+        rjb_desc_free(&rjbp->jb, dp);
+        if (ndp == NULL)
+            break;
+    }
+    if (lfpp != NULL)
+        *lfpp = fp;
+    return (hfp);
+}
+
+/* Drop frames that no longer fit into the window from the index */
+static void
+rjb_ring_shrink(struct jitter_buffer *jbp, uint64_t new_lo)
+{
+    uint64_t wend = new_lo + jbp->rmask;
+
+    if (jbp->rlast == NULL || rjb_dlseq(jbp, jbp->rlast) <= wend)
+        return;
+    if (rjb_dlseq(jbp, jbp->head) > wend) {
+        memset(jbp->rocc, '\0', ((jbp->rmask + 1) / 64) * sizeof(uint64_t));
+        jbp->rlast = NULL;
+        return;
+    }
+    while (rjb_dlseq(jbp, jbp->rlast) > wend) {
+        rjb_ring_clr(jbp, rjb_dlseq(jbp, jbp->rlast));
+        jbp->rlast = rjb_ring_prev(jbp, rjb_dlseq(jbp, jbp->rlast),
+          rjb_dlseq(jbp, jbp->head));
+    }
+}
+
+/* Log2 buckets: 1, 2, 3-4, 5-8, ... (RJB_HIST_NBINS-1 catches the rest) */
+static inline void
+rjb_hist_add(uint64_t hist[RJB_HIST_NBINS], uint64_t d)
+{
+    unsigned int bin;
+
+    for (bin = 0; bin < RJB_HIST_NBINS - 1 && ((uint64_t)1 << bin) < d; bin++)
+        continue;
+    hist[bin] += 1;
+}
+
 static struct rtp_frame *
 purge_stale_tail(struct rtpjbuf_inst *rjbp)
 {
-    struct rtp_frame *prev = NULL;
-    struct rtp_frame *fp = rjbp->jb.head;
+    struct jitter_buffer *jbp = &rjbp->jb;
+    struct rjb_fdesc *prev;
+    struct rjb_fdesc *dp = jbp->tail;
 
-    if (fp == NULL || rjbp->jb.size < rjbp->jb.capacity - 1)
+    if (dp == NULL || jbp->size < jbp->capacity - 1)
         return NULL;
 
-    while (fp->next != NULL) {
-        prev = fp;
-        fp = fp->next;
-    }
-    fp->rtp.jbcnt += 1;
-    if (fp->rtp.jbcnt < rjbp->jb.capacity)
+    dp->jbcnt += 1;
+    if (dp->jbcnt < jbp->capacity)
         return NULL;
+    rjbp->jbs.drop.stale += 1;
 
+    if (dp == jbp->rlast) {
+        prev = rjb_ring_prev(jbp, rjb_dlseq(jbp, dp), rjb_dlseq(jbp, jbp->head));
+        rjb_ring_clr(jbp, rjb_dlseq(jbp, dp));
+        jbp->rlast = prev;
+    } else {
+        for (prev = jbp->rlast; prev->next != dp; prev = prev->next)
+            continue;
+    }
+    jbp->tail = prev;
     if (prev != NULL)
         prev->next = NULL;
     else
         rjbp->jb.head = NULL;
     rjbp->jb.size -= 1;
-    if (rjbp->last_max_lseq == fp->rtp.lseq)
-        rjbp->last_max_lseq = (prev != NULL) ? prev->rtp.lseq : LMS_DEFAULT;
-    fp->next = NULL;
-    return fp;
+    if (rjbp->last_max_lseq == rjb_dlseq(jbp, dp))
+        rjbp->last_max_lseq = (prev != NULL) ? rjb_dlseq(jbp, prev) : LMS_DEFAULT;
+    return rjb_desc_release(rjbp, dp, dp, NULL);
 }
 
 void *
 rtpjbuf_ctor(unsigned int capacity)
+{
+
+    return (rtpjbuf_ctor_owned(capacity, 0));
+}
+
+/*
+ * Owned-copy mode: datagrams up to mtu bytes are copied into the internal
+ * arena on insertion, so the caller can reuse its receive buffer as soon
+ * as the call returns. mtu of 0 keeps pointing at the caller's data.
+ */
+void *
+rtpjbuf_ctor_owned(unsigned int capacity, unsigned int mtu)
 {
     struct rtpjbuf_inst *rjbp;
+    struct rjb_slab *sp;
+    unsigned char *arena;
+    size_t rsize, asize;
 
-    rjbp = malloc(sizeof(struct rtpjbuf_inst));
+    /* Keep every arena piece aligned for the header access */
+    mtu = (mtu + 7) & ~7u;
+    /* Ring has to be a power of two, logical capacity is kept as is */
+    for (rsize = RJB_RING_MIN; rsize < capacity; rsize <<= 1)
+        continue;
+    asize = sizeof(struct rtpjbuf_inst) + rsize * sizeof(struct rjb_fdesc *) +
+      (rsize / 64) * sizeof(uint64_t) +
+      ((size_t)capacity + 1) * sizeof(struct rjb_fdesc);
+    rjbp = malloc(asize);
     if (rjbp == NULL)
         return (NULL);
-    memset(rjbp, '\0', sizeof(struct rtpjbuf_inst));
+    memset(rjbp, '\0', asize);
+    sp = malloc(sizeof(struct rjb_slab) +
+      (capacity + 1) * (sizeof(struct rjb_fslot) + (size_t)mtu));
+    if (sp == NULL) {
+        free(rjbp);
+        return (NULL);
+    }
+    sp->free = NULL;
+    sp->nslots = capacity + 1;
+    sp->nout = 0;
+    sp->dead = 0;
+    sp->mtu = mtu;
+    arena = (unsigned char *)&sp->slots[capacity + 1];
+    for (unsigned int i = capacity + 1; i > 0; i--) {
+        sp->slots[i - 1].owner = sp;
+        sp->slots[i - 1].buf = (mtu != 0) ? arena + (size_t)(i - 1) * mtu : NULL;
+        sp->slots[i - 1].frame.next = (struct rtp_frame *)sp->free;
+        sp->free = &sp->slots[i - 1];
+    }
+    rjbp->slab = sp;
     rjbp->jb.capacity = capacity;
+    rjbp->jb.depth = capacity;
+    rjbp->jb.rmask = rsize - 1;
+    rjbp->jb.rslots = (struct rjb_fdesc **)(rjbp + 1);
+    rjbp->jb.rocc = (uint64_t *)(rjbp->jb.rslots + rsize);
+    struct rjb_fdesc *dpool = (struct rjb_fdesc *)(rjbp->jb.rocc + rsize / 64);
+    for (unsigned int i = capacity + 1; i > 0; i--)
+        rjb_desc_free(&rjbp->jb, &dpool[i - 1]);
     rjbp->last_lseq = LRS_DEFAULT;
     rjbp->last_max_lseq = LMS_DEFAULT;
     rjbp->ers_frame.type = RFT_ERS;
+    rjbp->rst_frame.type = RFT_RST;
     return ((void *)rjbp);
 }
 
 void
 rtpjbuf_frame_dtor(void *_rfp)
+{
+    struct rjb_fslot *fsp;
+    struct rjb_slab *sp;
+
+    fsp = (struct rjb_fslot *)_rfp;
+    sp = fsp->owner;
+    if (sp == NULL) {
+        free(fsp);
+        return;
+    }
+    fsp->frame.next = (struct rtp_frame *)sp->free;
+    sp->free = fsp;
+    sp->nout -= 1;
+    if (sp->dead && sp->nout == 0)
+        free(sp);
+}
+
+/* Size of the whole datagram an RFT_RTP frame was parsed from */
+size_t
+rtpjbuf_frame_size(const struct rtp_frame *fp)
 {
 
-    free(_rfp);
+    return (((const struct rjb_fslot *)fp)->size);
 }
 
 void
@@ -123,34 +636,91 @@ rtpjbuf_dtor(void *_rjbp)
     struct rtpjbuf_inst *rjbp;
 
     rjbp = (struct rtpjbuf_inst *)_rjbp;
-    for (struct rtp_frame *rfp = rjbp->jb.head; rfp != NULL;) {
-        struct rtp_frame *rfp_next = rfp->next;
-        rtpjbuf_frame_dtor(rfp);
-        rfp = rfp_next;
+    /* Only the owned copies have their slots taken while queued */
+    for (struct rjb_fdesc *dp = rjbp->jb.head; rjbp->slab->mtu != 0 &&
+      dp != NULL; dp = dp->next)
+        rtpjbuf_frame_dtor(rjb_slot_of(rjbp->slab, dp->data));
+    while (rjbp->spare != NULL) {
+        struct rjb_fslot *fsp = rjbp->spare;
+        rjbp->spare = (struct rjb_fslot *)fsp->frame.next;
+        free(fsp);
     }
+    if (rjbp->slab->nout == 0)
+        free(rjbp->slab);
+    else
+        rjbp->slab->dead = 1;
+    free(rjbp->efs);
     free(rjbp);
 }
 
-static struct rtp_frame *
-insert_ers_frame(struct rtpjbuf_inst *rjbp, struct rtp_frame *fp)
+/*
+ * Use payload type map to find out profile and codec of the incoming
+ * packets, NULL reverts to the static one. The map is not copied and has to
+ * outlive the jitter buffer and all the frames it produces.
+ */
+void
+rtpjbuf_set_ptmap(void *_rjbp, const struct rtp_ptmap *pm)
+{
+    struct rtpjbuf_inst *rjbp;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    rjbp->pm = pm;
+}
+
+/*
+ * Detect the stream restarts as per flags (RJB_RST_SSRC, RJB_RST_SEQ) and
+ * handle them in place instead of dropping the packets of the new stream as
+ * late ones: the queue is flushed, an RFT_RST frame goes out and the new
+ * stream starts in the next 64K range of lseq. A restart has to be
+ * confirmed by the probation number of packets in sequence (RFC 3550
+ * suggests 2), which are dropped, 0 or 1 restarts on the first one. Zero
+ * flags turn it off.
+ */
+void
+rtpjbuf_set_restart(void *_rjbp, unsigned int flags, unsigned int probation)
+{
+    struct rtpjbuf_inst *rjbp;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    rjbp->rst.flags = flags;
+    rjbp->rst.probation = probation;
+    rjbp->rst.nprobe = 0;
+}
+
+/* Erasure for the packets missing in between the last one and lseq */
+static void
+rjb_ers_fill(struct rtpjbuf_inst *rjbp, struct rtp_frame *efp, uint64_t lseq,
+  uint32_t ts)
 {
     uint32_t ts_diff, lseq_diff;
 
-    if (rjbp->last_lseq + 1 == fp->rtp.lseq)
-        return (fp);
-    rjbp->ers_frame.next = fp;
-    rjbp->ers_frame.ers.lseq_start = rjbp->last_lseq + 1;
-    rjbp->ers_frame.ers.lseq_end = fp->rtp.lseq - 1;
-    if (rjbp->last_ts > fp->rtp.info.ts) {
-        uint64_t ts_diff64 = (uint64_t)0x100000000 + fp->rtp.info.ts - rjbp->last_ts;
+    efp->type = RFT_ERS;
+    efp->ers.lseq_start = rjbp->last_lseq + 1;
+    efp->ers.lseq_end = lseq - 1;
+    if (rjbp->last_ts > ts) {
+        uint64_t ts_diff64 = (uint64_t)0x100000000 + ts - rjbp->last_ts;
         d_assert(ts_diff64 < 0x100000000);
         ts_diff = ts_diff64;
     } else {
-        ts_diff = fp->rtp.info.ts - rjbp->last_ts;
+        ts_diff = ts - rjbp->last_ts;
     }
-    lseq_diff = rjbp->ers_frame.ers.lseq_end - rjbp->ers_frame.ers.lseq_start + 1;
-    rjbp->ers_frame.ers.ts_diff = ts_diff * lseq_diff / (lseq_diff + 1);
-    return (&rjbp->ers_frame);
+    lseq_diff = efp->ers.lseq_end - efp->ers.lseq_start + 1;
+    rjbp->jbs.ers.count += 1;
+    rjbp->jbs.ers.frames += lseq_diff;
+    rjb_hist_add(rjbp->jbs.ers.len_hist, lseq_diff);
+    efp->ers.ts_diff = ts_diff * lseq_diff / (lseq_diff + 1);
+}
+
+static struct rtp_frame *
+insert_ers_frame(struct rtpjbuf_inst *rjbp, struct rtp_frame *fp,
+  struct rtp_frame *efp)
+{
+
+    if (rjbp->last_lseq + 1 == fp->rtp.lseq)
+        return (fp);
+    rjb_ers_fill(rjbp, efp, fp->rtp.lseq, fp->rtp.info.ts);
+    efp->next = fp;
+    return (efp);
 }
 
 static void
@@ -162,34 +732,340 @@ save_last(struct rtpjbuf_inst *rjbp, const struct rtp_packet *rp)
     rjbp->last_ts = rp->info.ts;
 }
 
-struct rjb_udp_in_r
-rtpjbuf_udp_in(void *_rjbp, const unsigned char *data, size_t size)
+static void
+rjb_adapt_depth(struct rtpjbuf_inst *rjbp)
+{
+    struct rjb_adapt *ap = &rjbp->adapt;
+    uint64_t target, ptime_ts, depth, mindepth;
+
+    target = (uint64_t)(ap->jitter >> 4) * 1000 * RJB_JITTER_MULT / ap->ts_rate;
+    if (target < ap->min_ms)
+        target = ap->min_ms;
+    else if (target > ap->max_ms)
+        target = ap->max_ms;
+    ap->target_ms = target;
+    ptime_ts = ap->ptime_ts;
+    if (ptime_ts == 0)
+        ptime_ts = ap->ts_rate * RJB_PTIME_DFLT_MS / 1000;
+    if (ptime_ts == 0)
+        ptime_ts = 1;
+    /* Holding N packets before giving up on a gap is N packet times */
+    depth = (target * ap->ts_rate / 1000 + ptime_ts - 1) / ptime_ts + 1;
+    mindepth = (rjbp->jb.capacity < 2) ? rjbp->jb.capacity : 2;
+    if (depth < mindepth)
+        depth = mindepth;
+    else if (depth > rjbp->jb.capacity)
+        depth = rjbp->jb.capacity;
+    rjbp->jb.depth = depth;
+}
+
+static void
+rjb_jitter_update(struct rtpjbuf_inst *rjbp, const struct rtp_info *ip,
+  uint64_t arrival_ns)
+{
+    struct rjb_adapt *ap = &rjbp->adapt;
+    uint32_t arrival;
+    int32_t transit;
+    int64_t d;
+    int rate;
+
+    rate = ip->rtp_profile->ts_rate;
+    if (rate <= 0)
+        return;
+    if (rate != ap->ts_rate) {
+        ap->ts_rate = rate;
+        ap->have_last = 0;
+        ap->jitter = 0;
+        ap->ptime_ts = 0;
+    }
+    arrival = (uint32_t)((arrival_ns / 1000000000) * rate +
+      (arrival_ns % 1000000000) * rate / 1000000000);
+    transit = (int32_t)(arrival - ip->ts);
+    if (ap->have_last) {
+        /* Modulo 2^32 as in RFC 3550 A.8, transit may wrap in between */
+        d = (int32_t)((uint32_t)transit - (uint32_t)ap->last_transit);
+        if (d < 0)
+            d = -d;
+        ap->jitter += d - (int32_t)((ap->jitter + 8) >> 4);
+        if ((uint16_t)(ip->seq - ap->last_seq) == 1 && ip->ts != ap->last_ts &&
+          ip->ts - ap->last_ts < (uint32_t)rate)
+            ap->ptime_ts = ip->ts - ap->last_ts;
+    }
+    ap->last_transit = transit;
+    ap->last_ts = ip->ts;
+    ap->last_seq = ip->seq;
+    ap->have_last = 1;
+    if (ap->max_ms != 0)
+        rjb_adapt_depth(rjbp);
+}
+
+/*
+ * Let the buffer hold anything from min_ms to max_ms worth of packets,
+ * as dictated by the jitter observed. The capacity is still the upper
+ * bound. max_ms of 0 reverts to the fixed depth.
+ */
+int
+rtpjbuf_set_adaptive(void *_rjbp, unsigned int min_ms, unsigned int max_ms)
 {
     struct rtpjbuf_inst *rjbp;
-    struct rtp_frame *fp, *ifp, *ifp_pre;
-    struct rjb_udp_in_r ruir = { 0 };
 
     rjbp = (struct rtpjbuf_inst *)_rjbp;
-    ruir.drop = purge_stale_tail(rjbp);
-    fp = malloc(sizeof(struct rtp_frame));
-    if x_unlikely(fp == NULL) {
+    if (min_ms > max_ms)
+        return (-1);
+    rjbp->adapt.min_ms = min_ms;
+    rjbp->adapt.max_ms = max_ms;
+    if (max_ms == 0) {
+        rjbp->adapt.target_ms = 0;
+        rjbp->jb.depth = rjbp->jb.capacity;
+    } else if (rjbp->adapt.ts_rate > 0) {
+        rjb_adapt_depth(rjbp);
+    } else {
+        rjbp->adapt.target_ms = min_ms;
+    }
+    return (0);
+}
+
+void
+rtpjbuf_get_stats(void *_rjbp, struct rtpjbuf_stats *sp)
+{
+    struct rtpjbuf_inst *rjbp;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    *sp = rjbp->jbs;
+    sp->occupancy = rjbp->jb.size;
+}
+
+void
+rtpjbuf_get_delay(void *_rjbp, struct rjb_delay *dp)
+{
+    struct rtpjbuf_inst *rjbp;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    dp->jitter = rjbp->adapt.jitter >> 4;
+    dp->jitter_us = (rjbp->adapt.ts_rate > 0) ?
+      (uint64_t)dp->jitter * 1000000 / rjbp->adapt.ts_rate : 0;
+    dp->target_ms = rjbp->adapt.target_ms;
+    dp->depth = rjbp->jb.depth;
+}
+
+static struct rjb_udp_in_r
+rjb_flush(struct rtpjbuf_inst *rjbp, struct rtp_frame *efp)
+{
+    struct rtp_frame *fp, *ifp;
+    uint64_t lseq;
+    struct rjb_udp_in_r ruir = { 0 };
+
+    if (rjbp->jb.head == NULL)
+        return (ruir);
+    lseq = rjb_dlseq(&rjbp->jb, rjbp->jb.head);
+    d_assert(lseq - 1 > rjbp->last_lseq || rjbp->last_lseq == LRS_DEFAULT ||
+      (rjbp->pull.on && lseq - 1 == rjbp->last_lseq));
+    fp = rjb_desc_release(rjbp, rjbp->jb.head, NULL, NULL);
+    for (ifp = fp; ifp->next != NULL; ifp = ifp->next) {
+resume:
+        if (ifp->rtp.lseq + 1 != ifp->next->rtp.lseq) {
+            struct rtp_frame *tfp = ifp->next;
+            ifp->next = ruir.drop;
+            ruir.drop = fp;
+            ifp = fp = tfp;
+            if (fp->next == NULL)
+                break;
+            goto resume;
+        }
+    }
+    ruir.ready = insert_ers_frame(rjbp, fp, efp);
+    save_last(rjbp, &ifp->rtp);
+    rjbp->jb.head = rjbp->jb.tail = rjbp->jb.rlast = NULL;
+    rjbp->jb.size = 0;
+    memset(rjbp->jb.rocc, '\0', ((rjbp->jb.rmask + 1) / 64) * sizeof(uint64_t));
+    return (ruir);
+}
+
+/*
+ * Decide if the packet starts a new stream: SSRC changed or SEQ jumped
+ * further than RFC 3550 A.1 allows, as enabled by the flags. The new one
+ * has to deliver the probation number of packets in sequence to take over,
+ * until then they are dropped. Returns 1 to restart, -1 to drop and 0 for
+ * the packets of the current stream.
+ */
+static int
+rjb_restart_check(struct rtpjbuf_inst *rjbp, const struct rtp_info *rip)
+{
+    int cand;
+
+    if x_unlikely(!rjbp->rst.have_ssrc) {
+        rjbp->rst.have_ssrc = 1;
+        rjbp->rst.ssrc = rip->ssrc;
+        return (0);
+    }
+    cand = 0;
+    if ((rjbp->rst.flags & RJB_RST_SSRC) && rip->ssrc != rjbp->rst.ssrc) {
+        cand = 1;
+    } else if ((rjbp->rst.flags & RJB_RST_SEQ) &&
+      rjbp->last_max_lseq != LMS_DEFAULT) {
+        uint16_t udelta = rip->seq - (uint16_t)rjbp->last_max_lseq;
+        cand = BOOLVAL(udelta >= RJB_MAX_DROPOUT &&
+          udelta < 65536 - RJB_MAX_MISORDER);
+    }
+    if (!cand) {
+        rjbp->rst.nprobe = 0;
+        return (0);
+    }
+    if (rjbp->rst.nprobe > 0 && rip->ssrc == rjbp->rst.probe_ssrc &&
+      rip->seq == (uint16_t)(rjbp->rst.probe_seq + 1))
+        rjbp->rst.nprobe += 1;
+    else
+        rjbp->rst.nprobe = 1;
+    rjbp->rst.probe_ssrc = rip->ssrc;
+    rjbp->rst.probe_seq = rip->seq;
+    if (rjbp->rst.nprobe < rjbp->rst.probation)
+        return (-1);
+    rjbp->rst.nprobe = 0;
+    rjbp->rst.ssrc = rip->ssrc;
+    return (1);
+}
+
+/*
+ * Start over with the packet of the new stream: release everything queued
+ * as rtpjbuf_flush() does, followed by the restart marker in rfp, and move
+ * the logical SEQ into the next 64K range, so that it keeps growing. The
+ * buffer is primed to have the packet next in line, so the playout goes on
+ * without another warm-up. Returns the list of frames to prepend to the
+ * ready list, the flushed drops go into the *dropp.
+ */
+static struct rtp_frame *
+rjb_restart(struct rtpjbuf_inst *rjbp, const struct rtp_info *rip,
+  struct rtp_frame *efp, struct rtp_frame *rfp, struct rtp_frame **dropp)
+{
+    struct rjb_udp_in_r fr;
+    struct rtp_frame *lfp;
+    uint64_t top;
+
+    fr = rjb_flush(rjbp, efp);
+    if (fr.drop != NULL) {
+        for (lfp = fr.drop; lfp->next != NULL; lfp = lfp->next)
+            continue;
+        lfp->next = *dropp;
+        *dropp = fr.drop;
+    }
+    top = 0;
+    if (rjbp->last_lseq != LRS_DEFAULT)
+        top = rjbp->last_lseq;
+    if (rjbp->last_max_lseq != LMS_DEFAULT && rjbp->last_max_lseq > top)
+        top = rjbp->last_max_lseq;
+    rjbp->lseq_mask = ((top >> 16) + 1) << 16;
+    rjbp->last_max_lseq = LMS_DEFAULT;
+    rjbp->last_lseq = (rjbp->lseq_mask | rip->seq) - 1;
+    rjbp->last_ts = rip->ts;
+    rjbp->adapt.have_last = 0;
+    rjbp->pull.have_base = 0;
+    rjbp->jbs.restart += 1;
+    rfp->type = RFT_RST;
+    rfp->rst.lseq = rjbp->lseq_mask | rip->seq;
+    rfp->rst.ssrc = rip->ssrc;
+    rfp->next = NULL;
+    if (fr.ready == NULL)
+        return (rfp);
+    for (lfp = fr.ready; lfp->next != NULL; lfp = lfp->next)
+        continue;
+    lfp->next = rfp;
+    return (fr.ready);
+}
+
+/* Frame of the incoming packet that goes out right away */
+static struct rtp_frame *
+rjb_pkt_frame(struct rtpjbuf_inst *rjbp, struct rjb_fslot *fsp,
+  const struct rtp_info *rip, uint64_t lseq, const unsigned char *data,
+  size_t size)
+{
+    struct rtp_frame *fp;
+
+    if (fsp == NULL)
+        fsp = rjb_slot_get(rjbp);
+    d_assert(fsp != NULL);
+    fp = rjb_frame_init(fsp, lseq, 0, data, size);
+    fp->rtp.info = *rip;
+    return (fp);
+}
+
+static struct rjb_udp_in_r
+rjb_udp_in(struct rtpjbuf_inst *rjbp, const unsigned char *data, size_t size,
+  uint64_t arrival_ns, struct rtp_frame *efp, struct rtp_frame *rfp)
+{
+    struct jitter_buffer *jbp;
+    struct rtp_frame *fp, *lfp, *pre;
+    struct rjb_fdesc *dp, *idp, *idp_pre;
+    struct rjb_fslot *fsp;
+    struct rtp_info info;
+    uint64_t lseq;
+    struct rjb_udp_in_r ruir = { 0 };
+
+    jbp = &rjbp->jb;
+    dp = NULL;
+    pre = NULL;
+    fsp = NULL;
+    ruir.mux = rtp_mux_classify(data, size);
+    if x_unlikely(ruir.mux != RTP_MUX_RTP && ruir.mux != RTP_MUX_UNKN) {
+        /* RTCP, STUN, DTLS etc: not for us, leave it to the caller */
+        rjbp->jbs.nonrtp += 1;
+        return (ruir);
+    }
+    if x_unlikely(size > ((rjbp->slab->mtu != 0) ? rjbp->slab->mtu : UINT16_MAX)) {
+        rjbp->jbs.drop.perror += 1;
+        ruir.error = RJB_E2BIG;
+        return (ruir);
+    }
+    if x_unlikely(rjb_slot_reserve(rjbp) != 0) {
         ruir.error = RJB_ENOMEM;
         return (ruir);
     }
-    memset(fp, '\0', sizeof(struct rtp_frame));
-    int perror = rtp_packet_parse_raw(data, size, &fp->rtp.info);
+    ruir.drop = purge_stale_tail(rjbp);
+    if (rjbp->slab->mtu != 0) {
+        fsp = rjb_slot_get(rjbp);
+        if x_unlikely(fsp == NULL) {
+            ruir.error = RJB_ENOMEM;
+            return (ruir);
+        }
+        memcpy(fsp->buf, data, size);
+        data = fsp->buf;
+    }
+    int perror = rtp_packet_parse_pm(data, size, rjbp->pm, &info);
     if x_unlikely(perror != RTP_PARSER_OK) {
-        free(fp);
+        if (fsp != NULL)
+            rtpjbuf_frame_dtor(fsp);
         rjbp->jbs.drop.perror += 1;
         ruir.error = perror;
         return (ruir);
     }
-    fp->type = RFT_RTP;
-    fp->rtp.data = data;
-    fp->rtp.jbcnt = 0;
+    if x_unlikely(rjbp->rst.flags != 0) {
+        switch (rjb_restart_check(rjbp, &info)) {
+        case -1:
+            fp = rjb_pkt_frame(rjbp, fsp, &info, rjbp->lseq_mask | info.seq,
+              data, size);
+            rjbp->jbs.drop.probation += 1;
+            fp->next = ruir.drop;
+            ruir.drop = fp;
+            return (ruir);
+
+        case 1:
+            /* Queue is empty after this, the packet can't produce an erasure */
+            pre = rjb_restart(rjbp, &info, efp, rfp, &ruir.drop);
+            break;
+        }
+    }
+    if (arrival_ns != 0)
+        rjb_jitter_update(rjbp, &info, arrival_ns);
+    if x_unlikely(rjbp->pull.on && !rjbp->pull.have_base) {
+        /* The first frame sets the playout clock */
+        rjbp->pull.have_base = 1;
+        rjbp->pull.base_ns = ((arrival_ns != 0) ? arrival_ns :
+          rjbp->pull.now) + rjbp->pull.delay_ns;
+        rjbp->pull.ts0 = info.ts;
+        rjbp->pull.rate = info.rtp_profile->ts_rate;
+    }
 
     /* Check for SEQ wrap-out and convert SEQ to the logical SEQ */
-    fp->rtp.lseq = rjbp->lseq_mask | fp->rtp.info.seq;
+    lseq = rjbp->lseq_mask | info.seq;
 
     int warm_up = BOOLVAL(rjbp->last_lseq == LRS_DEFAULT);
     if x_unlikely(warm_up) {};
@@ -199,125 +1075,347 @@ rtpjbuf_udp_in(void *_rjbp, const unsigned char *data, size_t size)
         goto lms_init;
     }
 
-    d_assert(rjbp->jb.head == NULL || warm_up || rjbp->jb.head->rtp.lseq - 1 > rjbp->last_lseq);
+    d_assert(jbp->head == NULL || warm_up ||
+      rjb_dlseq(jbp, jbp->head) - 1 > rjbp->last_lseq ||
+      (rjbp->pull.on && rjb_dlseq(jbp, jbp->head) - 1 == rjbp->last_lseq));
 
-    if x_unlikely(rjbp->last_max_lseq % 65536 < 536  && fp->rtp.info.seq > 65000) {
+    if x_unlikely(rjbp->last_max_lseq % 65536 < 536  && info.seq > 65000) {
         /* Pre-wrap packet received after a wrap */
-        fp->rtp.lseq -= 0x10000;
-    } else if x_unlikely(rjbp->last_max_lseq > 65000 && fp->rtp.lseq < rjbp->last_max_lseq - 65000) {
+        lseq -= 0x10000;
+    } else if x_unlikely(rjbp->last_max_lseq > 65000 && lseq < rjbp->last_max_lseq - 65000) {
         rjbp->lseq_mask += 0x10000;
-        fp->rtp.lseq += 0x10000;
+        lseq += 0x10000;
         rjbp->jbs.seq_wup += 1;
     }
-    if x_unlikely(!warm_up && fp->rtp.lseq <= rjbp->last_lseq) {
-        int ldist = rjbp->last_lseq - fp->rtp.lseq;
+    if x_unlikely(!warm_up && lseq <= rjbp->last_lseq) {
+        int ldist = rjbp->last_lseq - lseq;
         if (ldist == 0)
             goto gotdup;
         rjbp->jbs.drop.late += 1;
+        rjb_hist_add(rjbp->jbs.late_hist, ldist);
+        fp = rjb_pkt_frame(rjbp, fsp, &info, lseq, data, size);
         fp->next = ruir.drop;
         ruir.drop = fp;
-        return (ruir);
+        goto done;
     }
     if (rjbp->jb.head == NULL) {
         d_assert(rjbp->jb.size == 0);
-        d_assert(rjbp->last_max_lseq < fp->rtp.lseq);
+        d_assert(rjbp->last_max_lseq < lseq);
 lms_init:
-        rjbp->last_max_lseq = fp->rtp.lseq;
-        if (!warm_up && rjbp->last_lseq == fp->rtp.lseq - 1) {
+        rjbp->last_max_lseq = lseq;
+        /* In the pull mode everything waits for rtpjbuf_pull() */
+        if (!rjbp->pull.on && !warm_up && rjbp->last_lseq == lseq - 1) {
+            fp = rjb_pkt_frame(rjbp, fsp, &info, lseq, data, size);
             save_last(rjbp, &fp->rtp);
             ruir.ready = fp;
-        } else if x_unlikely(warm_up && fp->rtp.lseq == 0) {
+        } else if x_unlikely(!rjbp->pull.on && warm_up && lseq == 0) {
             d_assert(rjbp->last_lseq == LRS_DEFAULT);
+            fp = rjb_pkt_frame(rjbp, fsp, &info, lseq, data, size);
             save_last(rjbp, &fp->rtp);
             ruir.ready = fp;
         } else {
-            rjbp->jb.head = fp;
-            rjbp->jb.size = 1;
+            dp = rjb_desc_alloc(jbp, lseq, &info, data, size);
+            d_assert(jbp->rlast == NULL);
+            jbp->head = jbp->tail = jbp->rlast = dp;
+            rjb_ring_set(jbp, dp);
+            jbp->size = 1;
+            if (jbp->size > rjbp->jbs.peak)
+                rjbp->jbs.peak = jbp->size;
         }
-        return (ruir);
+        goto done;
     }
-    ifp_pre = NULL;
-    for (ifp = rjbp->jb.head; ifp != NULL; ifp = ifp->next) {
-        if (ifp->rtp.lseq < fp->rtp.lseq) {
-            ifp_pre = ifp;
-            continue;
-        }
-        if (ifp->rtp.lseq == fp->rtp.lseq)
+    dp = rjb_desc_alloc(jbp, lseq, &info, data, size);
+    if (lseq < rjb_dlseq(jbp, jbp->head)) {
+        /* New head, window moves back */
+        rjb_ring_shrink(jbp, lseq);
+        dp->next = jbp->head;
+        jbp->head = dp;
+        if (jbp->rlast == NULL)
+            jbp->rlast = dp;
+        rjb_ring_set(jbp, dp);
+    } else if (lseq <= rjb_dlseq(jbp, jbp->head) + jbp->rmask) {
+        if (rjb_ring_isset(jbp, lseq))
             goto gotdup;
-        break;
-    }
-    if (ifp != NULL) {
-        fp->next = ifp;
-        if (ifp_pre == NULL) {
-            d_assert(ifp == rjbp->jb.head);
-            fp->next = ifp;
-            rjbp->jb.head = fp;
-        } else {
-            ifp_pre->next = fp;
+        idp_pre = rjb_ring_prev(jbp, lseq, rjb_dlseq(jbp, jbp->head));
+        d_assert(idp_pre != NULL);
+        dp->next = idp_pre->next;
+        idp_pre->next = dp;
+        if (idp_pre == jbp->rlast)
+            jbp->rlast = dp;
+        rjb_ring_set(jbp, dp);
+        if (idp_pre == jbp->tail) {
+            jbp->tail = dp;
+            d_assert (rjbp->last_max_lseq < lseq);
+            rjbp->last_max_lseq = lseq;
         }
+    } else if (rjb_dlseq(jbp, jbp->tail) < lseq) {
+        jbp->tail->next = dp;
+        jbp->tail = dp;
+        d_assert (rjbp->last_max_lseq < lseq);
+        rjbp->last_max_lseq = lseq;
     } else {
-        ifp_pre->next = fp;
-        d_assert (rjbp->last_max_lseq < fp->rtp.lseq);
-        rjbp->last_max_lseq = fp->rtp.lseq;
+        /* Out of the window and not at the end, slow path */
+        for (idp_pre = jbp->rlast; ; idp_pre = idp) {
+            idp = idp_pre->next;
+            if (rjb_dlseq(jbp, idp) < lseq)
+                continue;
+            if (rjb_dlseq(jbp, idp) == lseq)
+                goto gotdup;
+            break;
+        }
+        dp->next = idp;
+        idp_pre->next = dp;
     }
+    if (lseq < rjbp->last_max_lseq)
+        rjb_hist_add(rjbp->jbs.reorder_hist, rjbp->last_max_lseq - lseq);
     rjbp->jb.size += 1;
-    int flush = BOOLVAL(!warm_up && rjbp->jb.head->rtp.lseq == rjbp->last_lseq + 1);
-    if (rjbp->jb.size == rjbp->jb.capacity || flush) {
-        fp = rjbp->jb.head;
+    if (rjbp->jb.size > rjbp->jbs.peak)
+        rjbp->jbs.peak = rjbp->jb.size;
+    int flush = BOOLVAL(!rjbp->pull.on && !warm_up &&
+      rjb_dlseq(jbp, rjbp->jb.head) == rjbp->last_lseq + 1);
+    if (rjbp->jb.size >= rjbp->jb.depth || flush) {
+        dp = rjbp->jb.head;
         rjbp->jb.size -= 1;
-        for (ifp = fp; ifp->next != NULL; ifp = ifp->next) {
-            if (ifp->rtp.lseq + 1 != ifp->next->rtp.lseq)
+        for (idp = dp; idp->next != NULL; idp = idp->next) {
+            if (rjb_dlseq(jbp, idp) + 1 != rjb_dlseq(jbp, idp->next))
                 break;
             rjbp->jb.size -= 1;
         }
-        rjbp->jb.head = ifp->next;
+        rjb_detach_head(jbp, idp);
+        fp = rjb_desc_release(rjbp, dp, idp, &lfp);
         d_assert(warm_up || rjbp->last_lseq < fp->rtp.lseq);
         d_assert(!warm_up || rjbp->last_lseq == LMS_DEFAULT);
         if (!warm_up)
-            fp = insert_ers_frame(rjbp, fp);
-        save_last(rjbp, &ifp->rtp);
-        ifp->next = NULL;
+            fp = insert_ers_frame(rjbp, fp, efp);
+        save_last(rjbp, &lfp->rtp);
         ruir.ready = fp;
         if (rjbp->jb.head == NULL)
             d_assert(rjbp->jb.size == 0);
         else
             d_assert(rjbp->jb.size > 0);
     }
-    return (ruir);
+    goto done;
 gotdup:
+    if (dp != NULL)
+        rjb_desc_free(jbp, dp);
     rjbp->jbs.drop.dup += 1;
+    fp = rjb_pkt_frame(rjbp, fsp, &info, lseq, data, size);
     fp->next = ruir.drop;
     ruir.drop = fp;
+done:
+    if x_unlikely(pre != NULL) {
+        rfp->next = ruir.ready;
+        ruir.ready = pre;
+    }
     return (ruir);
 }
 
 struct rjb_udp_in_r
-rtpjbuf_flush(void *_rjbp)
+rtpjbuf_udp_in(void *_rjbp, const unsigned char *data, size_t size)
 {
     struct rtpjbuf_inst *rjbp;
-    struct rtp_frame *fp, *ifp;
-    struct rjb_udp_in_r ruir = { 0 };
+
     rjbp = (struct rtpjbuf_inst *)_rjbp;
+    return (rjb_udp_in(rjbp, data, size, 0, &rjbp->ers_frame,
+      &rjbp->rst_frame));
+}
 
-    if (rjbp->jb.head == NULL)
-        return (ruir);
-    d_assert(rjbp->jb.head->rtp.lseq - 1 > rjbp->last_lseq || rjbp->last_lseq == LRS_DEFAULT);
-    fp = rjbp->jb.head;
-    for (ifp = fp; ifp->next != NULL; ifp = ifp->next) {
-resume:
-        if (ifp->rtp.lseq + 1 != ifp->next->rtp.lseq) {
-            struct rtp_frame *tfp = ifp->next;
-            ifp->next = ruir.drop;
-            ruir.drop = fp;
-            ifp = fp = tfp;
-            if (fp->next == NULL)
-                break;
-            goto resume;
+/*
+ * Same as rtpjbuf_udp_in(), with the arrival time (any monotonic clock)
+ * feeding the jitter estimate.
+ */
+struct rjb_udp_in_r
+rtpjbuf_udp_in_at(void *_rjbp, const unsigned char *data, size_t size,
+  uint64_t arrival_ns)
+{
+    struct rtpjbuf_inst *rjbp;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    return (rjb_udp_in(rjbp, data, size, arrival_ns,
+      &rjbp->ers_frame, &rjbp->rst_frame));
+}
+
+/*
+ * Feed a batch of datagrams, e.g. a single recvmmsg(2) worth, and return
+ * merged ready and drop lists. The outcome is the same as calling
+ * rtpjbuf_udp_in() on each datagram in turn and concatenating the results.
+ * Arrival times, if known, go into arrival_ns[], which may be NULL.
+ * Per-datagram status goes into errors[] if it's not NULL: 0 for accepted
+ * ones, parser error or RJB_ENOMEM for failed ones and RJB_EBYPASS for the
+ * non-RTP datagrams left to the caller. The error in the result is the
+ * first failure in the batch, if any, and the mux is always RTP_MUX_RTP.
+ */
+struct rjb_udp_in_r
+rtpjbuf_udp_in_many(void *_rjbp, const unsigned char *const data[],
+  const size_t sizes[], unsigned int npkts, const uint64_t arrival_ns[],
+  int errors[])
+{
+    struct rtpjbuf_inst *rjbp;
+    struct rjb_udp_in_r ruir = { 0 }, r1;
+    struct rtp_frame **ready_tail, *efp;
+    unsigned int i, nefs;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    if (npkts > rjbp->nefs) {
+        /*
+         * Up to one erasure and one restart marker per datagram, valid
+         * until the next call.
+         */
+        efp = realloc(rjbp->efs, 2 * npkts * sizeof(struct rtp_frame));
+        if (efp == NULL) {
+            for (i = 0; errors != NULL && i < npkts; i++)
+                errors[i] = RJB_ENOMEM;
+            ruir.error = RJB_ENOMEM;
+            return (ruir);
+        }
+        rjbp->efs = efp;
+        rjbp->nefs = npkts;
+    }
+    ruir.mux = RTP_MUX_RTP;
+    ready_tail = &ruir.ready;
+    for (i = nefs = 0; i < npkts; i++) {
+        r1 = rjb_udp_in(rjbp, data[i], sizes[i],
+          (arrival_ns != NULL) ? arrival_ns[i] : 0, &rjbp->efs[nefs],
+          &rjbp->efs[rjbp->nefs + i]);
+        if (errors != NULL) {
+            if (r1.mux != RTP_MUX_RTP && r1.mux != RTP_MUX_UNKN)
+                errors[i] = RJB_EBYPASS;
+            else
+                errors[i] = r1.error;
+        }
+        if (r1.error != 0 && ruir.error == 0)
+            ruir.error = r1.error;
+        if (r1.ready != NULL) {
+            if (r1.ready->type == RFT_ERS)
+                nefs += 1;
+            *ready_tail = r1.ready;
+            for (; *ready_tail != NULL; ready_tail = &(*ready_tail)->next)
+                continue;
+        }
+        if (r1.drop != NULL) {
+            for (efp = r1.drop; efp->next != NULL; efp = efp->next)
+                continue;
+            efp->next = ruir.drop;
+            ruir.drop = r1.drop;
         }
     }
-    ruir.ready = insert_ers_frame(rjbp, fp);
-    save_last(rjbp, &ifp->rtp);
-    rjbp->jb.head = NULL;
-    rjbp->jb.size = 0;
     return (ruir);
 }
+
+/*
+ * Switch to the pull mode: rtpjbuf_udp_in() and friends only queue packets
+ * (releasing the oldest run only once the depth is reached) and playout is
+ * driven by the caller's clock via rtpjbuf_pull(). The very first frame is
+ * due delay_ms after its arrival and the rest follow at their RTP
+ * timestamps from there. A gap is given up on once the missing frame is
+ * max_hold_ms overdue.
+ */
+void
+rtpjbuf_set_pull(void *_rjbp, unsigned int delay_ms, unsigned int max_hold_ms)
+{
+    struct rtpjbuf_inst *rjbp;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    rjbp->pull.on = 1;
+    rjbp->pull.delay_ns = (uint64_t)delay_ms * 1000000;
+    rjbp->pull.max_hold_ns = (uint64_t)max_hold_ms * 1000000;
+    rjbp->pull.have_base = 0;
+}
+
+/* Playout time of the frame with the given ts */
+static uint64_t
+rjb_pull_due(const struct rtpjbuf_inst *rjbp, uint32_t ts)
+{
+    int32_t d;
+    uint64_t off;
+
+    if (rjbp->pull.rate <= 0)
+        return (rjbp->pull.base_ns);
+    d = (int32_t)(ts - rjbp->pull.ts0);
+    if (d >= 0)
+        return (rjbp->pull.base_ns + (uint64_t)d * 1000000000 / rjbp->pull.rate);
+    off = (uint64_t)(-(int64_t)d) * 1000000000 / rjbp->pull.rate;
+    return ((rjbp->pull.base_ns > off) ? rjbp->pull.base_ns - off : 0);
+}
+
+/* Move the playout clock along before ts - ts0 gets out of the int32 range */
+static void
+rjb_pull_rebase(struct rtpjbuf_inst *rjbp, uint32_t ts)
+{
+    uint32_t d;
+
+    d = ts - rjbp->pull.ts0;
+    if (rjbp->pull.rate <= 0 || d < 0x40000000 || d >= 0x80000000)
+        return;
+    rjbp->pull.base_ns += (uint64_t)d * 1000000000 / rjbp->pull.rate;
+    rjbp->pull.ts0 = ts;
+}
+
+/*
+ * Return the frame due at now_ns, if any: the next one in sequence once
+ * its playout time has come, or an erasure for the missing packets if the
+ * gap has not filled within the maximum hold time past that. Packets
+ * queued without the arrival time are stamped with the now_ns of the last
+ * call. The erasure frame is only valid until the next call.
+ */
+struct rjb_udp_in_r
+rtpjbuf_pull(void *_rjbp, uint64_t now_ns)
+{
+    struct rtpjbuf_inst *rjbp;
+    struct rtp_frame *fp, *efp;
+    struct rjb_fdesc *dp;
+    struct rjb_udp_in_r ruir = { 0 };
+    uint32_t ts, ts_gap;
+    uint64_t lseq, due_ns;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    rjbp->pull.now = now_ns;
+    ruir.mux = RTP_MUX_RTP;
+    dp = rjbp->jb.head;
+    if (dp == NULL) {
+        /* Only once playing and with the next frame due */
+        if (rjbp->last_lseq != LRS_DEFAULT && (rjbp->adapt.ptime_ts == 0 ||
+          now_ns >= rjb_pull_due(rjbp, rjbp->last_ts + rjbp->adapt.ptime_ts)))
+            rjbp->jbs.underrun += 1;
+        return (ruir);
+    }
+    lseq = rjb_dlseq(&rjbp->jb, dp);
+    ts = rjb_desc_ts(dp);
+    if (rjbp->last_lseq == LRS_DEFAULT || lseq == rjbp->last_lseq + 1) {
+        if (now_ns < rjb_pull_due(rjbp, ts))
+            return (ruir);
+        rjb_detach_head(&rjbp->jb, dp);
+        rjbp->jb.size -= 1;
+        fp = rjb_desc_release(rjbp, dp, dp, NULL);
+        save_last(rjbp, &fp->rtp);
+        rjb_pull_rebase(rjbp, ts);
+        ruir.ready = fp;
+        return (ruir);
+    }
+    /* The first missing frame is due in between the last one and the head */
+    ts_gap = (ts - rjbp->last_ts) / (lseq - rjbp->last_lseq);
+    due_ns = rjb_pull_due(rjbp, rjbp->last_ts + ts_gap);
+    if (now_ns < due_ns)
+        return (ruir);
+    if (now_ns < due_ns + rjbp->pull.max_hold_ns) {
+        /* Missing one(s) might still show up */
+        rjbp->jbs.underrun += 1;
+        return (ruir);
+    }
+    efp = &rjbp->ers_frame;
+    rjb_ers_fill(rjbp, efp, lseq, ts);
+    efp->next = NULL;
+    rjbp->last_lseq = efp->ers.lseq_end;
+    rjbp->last_ts += efp->ers.ts_diff;
+    ruir.ready = efp;
+    return (ruir);
+}
+
+struct rjb_udp_in_r
+rtpjbuf_flush(void *_rjbp)
+{
+    struct rtpjbuf_inst *rjbp;
+
+    rjbp = (struct rtpjbuf_inst *)_rjbp;
+    return (rjb_flush(rjbp, &rjbp->ers_frame));
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-enum rtp_frame_type { RFT_RTP = 0, RFT_ERS = 1};
+enum rtp_frame_type { RFT_RTP = 0, RFT_ERS = 1, RFT_RST = 2};
 
 struct rtp_packet {
     struct rtp_info info;
@@ -15,11 +15,18 @@ struct ers_frame {
     uint32_t ts_diff;
 };
 
+/* Stream restart: frames that follow belong to the new SSRC / SEQ space */
+struct rst_frame {
+    uint64_t lseq;              /* first lseq of the new stream */
+    uint32_t ssrc;
+};
+
 struct rtp_frame {
     enum rtp_frame_type type;
     union {
         struct rtp_packet rtp;
         struct ers_frame ers;
+        struct rst_frame rst;
     };
     struct rtp_frame *next;
 };
@@ -28,12 +35,68 @@ struct rjb_udp_in_r {
     int error;
     struct rtp_frame *ready;
     struct rtp_frame *drop;
+    enum rtp_mux_class mux;
+};
+
+struct rjb_delay {
+    uint32_t jitter;            /* RFC 3550 interarrival jitter, RTP clock */
+    uint64_t jitter_us;
+    unsigned int target_ms;     /* target playout delay, adaptive mode */
+    unsigned int depth;         /* packets held for a gap */
+};
+
+#define RJB_HIST_NBINS 8
+
+/*
+ * Histograms use log2 buckets of the distance in packets: 1, 2, 3-4, 5-8,
+ * 9-16, 17-32, 33-64 and 65+.
+ */
+struct rtpjbuf_stats {
+    struct {
+        uint64_t dup;
+        uint64_t late;
+        uint64_t perror;
+        uint64_t stale;         /* far-ahead packets purged from the tail */
+        uint64_t probation;     /* new stream candidates not yet confirmed */
+    } drop;
+    uint64_t seq_wup;
+    uint64_t nonrtp;
+    struct {
+        uint64_t count;         /* erasure frames emitted */
+        uint64_t frames;        /* packets covered by them */
+        uint64_t len_hist[RJB_HIST_NBINS];
+    } ers;
+    uint64_t reorder_hist[RJB_HIST_NBINS];     /* behind the newest queued */
+    uint64_t late_hist[RJB_HIST_NBINS];        /* behind the last released */
+    uint64_t underrun;          /* rtpjbuf_pull() calls, due frame missing */
+    uint64_t restart;           /* SSRC changes / SEQ jumps handled */
+    unsigned int occupancy;
+    unsigned int peak;
 };
 
 #define RJB_ENOMEM (RTP_PARSER_IPS-1000)
+#define RJB_EBYPASS (RTP_PARSER_IPS-1001)
+#define RJB_E2BIG (RTP_PARSER_IPS-1002)
+
+#define RJB_RST_SSRC 0x1        /* restart on the SSRC change */
+#define RJB_RST_SEQ 0x2         /* restart on the SEQ jump (RFC 3550 A.1) */
 
 void *rtpjbuf_ctor(unsigned int capacity);
+void *rtpjbuf_ctor_owned(unsigned int capacity, unsigned int mtu);
 void rtpjbuf_dtor(void *_rjbp);
 void rtpjbuf_frame_dtor(void *_rfp);
+size_t rtpjbuf_frame_size(const struct rtp_frame *fp);
 struct rjb_udp_in_r rtpjbuf_udp_in(void *_rjbp, const unsigned char *data, size_t size);
+struct rjb_udp_in_r rtpjbuf_udp_in_at(void *_rjbp, const unsigned char *data,
+  size_t size, uint64_t arrival_ns);
+struct rjb_udp_in_r rtpjbuf_udp_in_many(void *_rjbp,
+  const unsigned char *const data[], const size_t sizes[], unsigned int npkts,
+  const uint64_t arrival_ns[], int errors[]);
 struct rjb_udp_in_r rtpjbuf_flush(void *_rjbp);
+void rtpjbuf_set_pull(void *_rjbp, unsigned int delay_ms, unsigned int max_hold_ms);
+struct rjb_udp_in_r rtpjbuf_pull(void *_rjbp, uint64_t now_ns);
+void rtpjbuf_set_ptmap(void *_rjbp, const struct rtp_ptmap *pm);
+int rtpjbuf_set_adaptive(void *_rjbp, unsigned int min_ms, unsigned int max_ms);
+void rtpjbuf_get_delay(void *_rjbp, struct rjb_delay *dp);
+void rtpjbuf_get_stats(void *_rjbp, struct rtpjbuf_stats *sp);
+void rtpjbuf_set_restart(void *_rjbp, unsigned int flags, unsigned int probation);
@@ -0,0 +1,614 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtp.h"
+#include "rtp_info.h"
+#include "rtpjbuf.h"
+#include "rtpjbuf_mgr.h"
+#include "SPMCQueue.h"
+
+#define RJB_MGR_BATCH 64
+#define RJB_MGR_HBITS_MIN 4
+#define RJB_MGR_GOLDEN 0x9E3779B97F4A7C15ULL
+
+enum rjb_mgr_cmd { RJB_MGR_PKT = 0, RJB_MGR_REMOVE = 1 };
+
+/*
+ * Input and output share the same allocation: the buffers are run in the
+ * zero-copy mode over the item's data, so an RTP frame released by a
+ * buffer is turned into the output item in place.
+ */
+struct rjb_mgr_item {
+    struct rtpjbuf_mgr_frame pub;
+    enum rjb_mgr_cmd cmd;
+    uint64_t arrival_ns;
+    unsigned char data[];
+};
+
+struct rjb_mgr_stream {
+    uint64_t id;
+    void *jb;
+};
+
+/* Only ever written by a single thread, so no RMW is needed */
+#define RJB_MGR_INC(cntp) atomic_store_explicit((cntp), \
+  atomic_load_explicit((cntp), memory_order_relaxed) + 1, memory_order_relaxed)
+
+struct rjb_mgr_shard {
+    SPMCQueue *in_q;
+    SPMCQueue *out_q;
+    unsigned int capacity;
+    pthread_t worker;
+    int worker_running;
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    _Atomic int sleeping;
+    _Atomic int shutdown;
+    /* Worker-private stream table, open addressing with linear probing */
+    struct rjb_mgr_stream *streams;
+    unsigned int sbits;
+    unsigned int nstreams;
+    struct {
+        _Atomic uint64_t in_full;
+        _Atomic uint64_t out_full;
+        _Atomic uint64_t perror;
+        _Atomic uint64_t nonrtp;
+        _Atomic uint64_t drop;
+        _Atomic unsigned int streams;
+    } st;
+};
+
+struct rtpjbuf_mgr {
+    unsigned int nshards;
+    unsigned int poll_next;
+    struct rjb_mgr_shard *shards[];
+};
+
+static inline uint64_t
+rjb_mgr_hash(uint64_t id)
+{
+
+    return (id * RJB_MGR_GOLDEN);
+}
+
+static inline struct rjb_mgr_item *
+rjb_mgr_item_of(const struct rtp_frame *fp)
+{
+
+    return ((struct rjb_mgr_item *)(void *)(fp->rtp.data -
+      offsetof(struct rjb_mgr_item, data)));
+}
+
+static struct rjb_mgr_stream *
+rjb_mgr_stream_find(struct rjb_mgr_shard *shp, uint64_t id)
+{
+    uint64_t mask, i;
+
+    if (shp->streams == NULL)
+        return (NULL);
+    mask = (1ULL << shp->sbits) - 1;
+    for (i = rjb_mgr_hash(id) >> (64 - shp->sbits); ; i = (i + 1) & mask) {
+        if (shp->streams[i].jb == NULL)
+            return (NULL);
+        if (shp->streams[i].id == id)
+            return (&shp->streams[i]);
+    }
+}
+
+static void
+rjb_mgr_stream_link(struct rjb_mgr_shard *shp, uint64_t id, void *jb)
+{
+    uint64_t mask, i;
+
+    mask = (1ULL << shp->sbits) - 1;
+    for (i = rjb_mgr_hash(id) >> (64 - shp->sbits); shp->streams[i].jb != NULL;
+      i = (i + 1) & mask)
+        continue;
+    shp->streams[i].id = id;
+    shp->streams[i].jb = jb;
+}
+
+static int
+rjb_mgr_stream_grow(struct rjb_mgr_shard *shp)
+{
+    struct rjb_mgr_stream *ostreams;
+    unsigned int osize, nbits;
+
+    nbits = (shp->streams == NULL) ? RJB_MGR_HBITS_MIN : shp->sbits + 1;
+    if (nbits >= 32)
+        return (-1);
+    ostreams = shp->streams;
+    osize = (ostreams == NULL) ? 0 : (1U << shp->sbits);
+    shp->streams = calloc(1U << nbits, sizeof(shp->streams[0]));
+    if (shp->streams == NULL) {
+        shp->streams = ostreams;
+        return (-1);
+    }
+    shp->sbits = nbits;
+    for (unsigned int i = 0; i < osize; i++) {
+        if (ostreams[i].jb != NULL)
+            rjb_mgr_stream_link(shp, ostreams[i].id, ostreams[i].jb);
+    }
+    free(ostreams);
+    return (0);
+}
+
+static void *
+rjb_mgr_stream_get(struct rjb_mgr_shard *shp, uint64_t id)
+{
+    struct rjb_mgr_stream *sp;
+    void *jb;
+
+    sp = rjb_mgr_stream_find(shp, id);
+    if (sp != NULL)
+        return (sp->jb);
+    /* Keep the load factor under 3/4 */
+    if (shp->streams == NULL ||
+      (shp->nstreams + 1) * 4 > (3U << shp->sbits)) {
+        if (rjb_mgr_stream_grow(shp) != 0)
+            return (NULL);
+    }
+    jb = rtpjbuf_ctor(shp->capacity);
+    if (jb == NULL)
+        return (NULL);
+    rjb_mgr_stream_link(shp, id, jb);
+    shp->nstreams += 1;
+    atomic_store_explicit(&shp->st.streams, shp->nstreams, memory_order_relaxed);
+    return (jb);
+}
+
+/* Backward-shift deletion, so that no tombstones are needed */
+static void
+rjb_mgr_stream_unlink(struct rjb_mgr_shard *shp, struct rjb_mgr_stream *sp)
+{
+    uint64_t mask, i, j, k;
+
+    mask = (1ULL << shp->sbits) - 1;
+    i = sp - shp->streams;
+    shp->streams[i].jb = NULL;
+    for (j = (i + 1) & mask; shp->streams[j].jb != NULL; j = (j + 1) & mask) {
+        k = rjb_mgr_hash(shp->streams[j].id) >> (64 - shp->sbits);
+        if (((j - k) & mask) < ((j - i) & mask))
+            continue;
+        shp->streams[i] = shp->streams[j];
+        shp->streams[j].jb = NULL;
+        i = j;
+    }
+    shp->nstreams -= 1;
+    atomic_store_explicit(&shp->st.streams, shp->nstreams, memory_order_relaxed);
+}
+
+static void
+rjb_mgr_drop_list(struct rjb_mgr_shard *shp, struct rtp_frame *fp)
+{
+
+    while (fp != NULL) {
+        struct rtp_frame *next = fp->next;
+        if (fp->type == RFT_RTP) {
+            free(rjb_mgr_item_of(fp));
+            rtpjbuf_frame_dtor(fp);
+            RJB_MGR_INC(&shp->st.drop);
+        }
+        fp = next;
+    }
+}
+
+static void
+rjb_mgr_ready_list(struct rjb_mgr_shard *shp, uint64_t id, struct rtp_frame *fp)
+{
+    struct rjb_mgr_item *ip;
+
+    while (fp != NULL) {
+        struct rtp_frame *next = fp->next;
+        if (fp->type == RFT_RTP) {
+            ip = rjb_mgr_item_of(fp);
+            ip->pub.frame = *fp;
+            rtpjbuf_frame_dtor(fp);
+        } else {
+            /* Erasures and restarts live in the buffer, make a copy */
+            ip = malloc(sizeof(*ip));
+            if (ip == NULL) {
+                RJB_MGR_INC(&shp->st.out_full);
+                fp = next;
+                continue;
+            }
+            ip->pub.frame = *fp;
+            ip->pub.size = 0;
+        }
+        ip->pub.stream_id = id;
+        ip->pub.frame.next = NULL;
+        if (!try_push(shp->out_q, ip)) {
+            RJB_MGR_INC(&shp->st.out_full);
+            free(ip);
+        }
+        fp = next;
+    }
+}
+
+static void
+rjb_mgr_pkt_in(struct rjb_mgr_shard *shp, struct rjb_mgr_item *ip)
+{
+    struct rjb_udp_in_r ruir;
+    uint64_t id;
+    void *jb;
+
+    id = ip->pub.stream_id;
+    jb = rjb_mgr_stream_get(shp, id);
+    if (jb == NULL) {
+        RJB_MGR_INC(&shp->st.perror);
+        free(ip);
+        return;
+    }
+    ruir = rtpjbuf_udp_in_at(jb, ip->data, ip->pub.size, ip->arrival_ns);
+    if (ruir.mux != RTP_MUX_RTP && ruir.mux != RTP_MUX_UNKN) {
+        RJB_MGR_INC(&shp->st.nonrtp);
+        free(ip);
+        return;
+    }
+    if (ruir.error != 0) {
+        /* Not queued, the item is still ours */
+        RJB_MGR_INC(&shp->st.perror);
+        free(ip);
+        rjb_mgr_drop_list(shp, ruir.drop);
+        return;
+    }
+    rjb_mgr_drop_list(shp, ruir.drop);
+    rjb_mgr_ready_list(shp, id, ruir.ready);
+}
+
+static void
+rjb_mgr_stream_close(struct rjb_mgr_shard *shp, struct rjb_mgr_stream *sp,
+  int deliver)
+{
+    struct rjb_udp_in_r ruir;
+
+    for (;;) {
+        ruir = rtpjbuf_flush(sp->jb);
+        if (ruir.ready == NULL && ruir.drop == NULL)
+            break;
+        rjb_mgr_drop_list(shp, ruir.drop);
+        if (deliver) {
+            rjb_mgr_ready_list(shp, sp->id, ruir.ready);
+        } else {
+            rjb_mgr_drop_list(shp, ruir.ready);
+        }
+    }
+    rtpjbuf_dtor(sp->jb);
+    rjb_mgr_stream_unlink(shp, sp);
+}
+
+static void
+rjb_mgr_process(struct rjb_mgr_shard *shp, struct rjb_mgr_item *ip)
+{
+    struct rjb_mgr_stream *sp;
+
+    switch (ip->cmd) {
+    case RJB_MGR_PKT:
+        rjb_mgr_pkt_in(shp, ip);
+        break;
+
+    case RJB_MGR_REMOVE:
+        sp = rjb_mgr_stream_find(shp, ip->pub.stream_id);
+        if (sp != NULL)
+            rjb_mgr_stream_close(shp, sp, 1);
+        free(ip);
+        break;
+    }
+}
+
+/*
+ * The worker announces that it's about to sleep in shp->sleeping and then
+ * checks the queue one more time, the producer checks the flag after the
+ * push. Paired with the fences on both sides this makes sure that at least
+ * one of them sees the other, so no wakeup is lost and the producer only
+ * pays for the mutex when the worker is actually idle.
+ */
+static void *
+rjb_mgr_worker(void *arg)
+{
+    struct rjb_mgr_shard *shp;
+    void *items[RJB_MGR_BATCH];
+    size_t i, n;
+    int armed;
+
+    shp = (struct rjb_mgr_shard *)arg;
+    armed = 0;
+    while (!atomic_load_explicit(&shp->shutdown, memory_order_relaxed)) {
+        n = try_pop_many(shp->in_q, items, RJB_MGR_BATCH);
+        if (n == 0) {
+            if (!armed) {
+                atomic_store_explicit(&shp->sleeping, 1, memory_order_relaxed);
+                atomic_thread_fence(memory_order_seq_cst);
+                armed = 1;
+                continue;
+            }
+            pthread_mutex_lock(&shp->lock);
+            while (atomic_load_explicit(&shp->sleeping, memory_order_relaxed) &&
+              !atomic_load_explicit(&shp->shutdown, memory_order_relaxed))
+                pthread_cond_wait(&shp->cv, &shp->lock);
+            pthread_mutex_unlock(&shp->lock);
+            armed = 0;
+            continue;
+        }
+        if (armed) {
+            atomic_store_explicit(&shp->sleeping, 0, memory_order_relaxed);
+            armed = 0;
+        }
+        for (i = 0; i < n; i++)
+            rjb_mgr_process(shp, (struct rjb_mgr_item *)items[i]);
+    }
+    return (NULL);
+}
+
+static void
+rjb_mgr_wakeup(struct rjb_mgr_shard *shp)
+{
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&shp->sleeping, memory_order_relaxed))
+        return;
+    pthread_mutex_lock(&shp->lock);
+    atomic_store_explicit(&shp->sleeping, 0, memory_order_relaxed);
+    pthread_cond_signal(&shp->cv);
+    pthread_mutex_unlock(&shp->lock);
+}
+
+static void
+rjb_mgr_shard_dtor(struct rjb_mgr_shard *shp)
+{
+    void *item;
+
+    if (shp->worker_running) {
+        pthread_mutex_lock(&shp->lock);
+        atomic_store_explicit(&shp->shutdown, 1, memory_order_relaxed);
+        pthread_cond_signal(&shp->cv);
+        pthread_mutex_unlock(&shp->lock);
+        pthread_join(shp->worker, NULL);
+    }
+    if (shp->in_q != NULL) {
+        while (try_pop(shp->in_q, &item))
+            free(item);
+        destroy_queue(shp->in_q);
+    }
+    if (shp->streams != NULL) {
+        for (unsigned int i = 0; i < (1U << shp->sbits); i++) {
+            /* Unlink can shift the next entry into this one */
+            while (shp->streams[i].jb != NULL)
+                rjb_mgr_stream_close(shp, &shp->streams[i], 0);
+        }
+        free(shp->streams);
+    }
+    if (shp->out_q != NULL) {
+        while (try_pop(shp->out_q, &item))
+            free(item);
+        destroy_queue(shp->out_q);
+    }
+    pthread_cond_destroy(&shp->cv);
+    pthread_mutex_destroy(&shp->lock);
+    free(shp);
+}
+
+static struct rjb_mgr_shard *
+rjb_mgr_shard_ctor(unsigned int capacity, unsigned int qlen)
+{
+    struct rjb_mgr_shard *shp;
+
+    shp = calloc(1, sizeof(*shp));
+    if (shp == NULL)
+        return (NULL);
+    shp->capacity = capacity;
+    if (pthread_mutex_init(&shp->lock, NULL) != 0) {
+        free(shp);
+        return (NULL);
+    }
+    if (pthread_cond_init(&shp->cv, NULL) != 0) {
+        pthread_mutex_destroy(&shp->lock);
+        free(shp);
+        return (NULL);
+    }
+    atomic_init(&shp->sleeping, 0);
+    atomic_init(&shp->shutdown, 0);
+    shp->in_q = create_queue(qlen);
+    shp->out_q = create_queue(qlen);
+    if (shp->in_q == NULL || shp->out_q == NULL)
+        goto e0;
+    if (pthread_create(&shp->worker, NULL, rjb_mgr_worker, shp) != 0)
+        goto e0;
+    shp->worker_running = 1;
+    return (shp);
+e0:
+    rjb_mgr_shard_dtor(shp);
+    return (NULL);
+}
+
+/*
+ * Start nshards workers, each feeding streams into jitter buffers of the
+ * given capacity. Queue length is per shard and gets rounded up to a power
+ * of two.
+ */
+void *
+rtpjbuf_mgr_ctor(unsigned int nshards, unsigned int capacity, unsigned int qlen)
+{
+    struct rtpjbuf_mgr *mgrp;
+    unsigned int qsize;
+
+    if (nshards == 0 || capacity == 0 || qlen == 0 || qlen > (1U << 31))
+        return (NULL);
+    for (qsize = 1; qsize < qlen; qsize <<= 1)
+        continue;
+    mgrp = calloc(1, sizeof(*mgrp) + nshards * sizeof(mgrp->shards[0]));
+    if (mgrp == NULL)
+        return (NULL);
+    mgrp->nshards = nshards;
+    for (unsigned int i = 0; i < nshards; i++) {
+        mgrp->shards[i] = rjb_mgr_shard_ctor(capacity, qsize);
+        if (mgrp->shards[i] == NULL) {
+            rtpjbuf_mgr_dtor(mgrp);
+            return (NULL);
+        }
+    }
+    return (mgrp);
+}
+
+/*
+ * Stop the workers and free everything, including the frames that are
+ * still queued or buffered.
+ */
+void
+rtpjbuf_mgr_dtor(void *_mgrp)
+{
+    struct rtpjbuf_mgr *mgrp;
+
+    mgrp = (struct rtpjbuf_mgr *)_mgrp;
+    for (unsigned int i = 0; i < mgrp->nshards; i++) {
+        if (mgrp->shards[i] != NULL)
+            rjb_mgr_shard_dtor(mgrp->shards[i]);
+    }
+    free(mgrp);
+}
+
+static struct rjb_mgr_shard *
+rjb_mgr_shard_of(struct rtpjbuf_mgr *mgrp, uint64_t stream_id)
+{
+
+    return (mgrp->shards[(rjb_mgr_hash(stream_id) >> 32) % mgrp->nshards]);
+}
+
+static int
+rjb_mgr_enqueue(struct rjb_mgr_shard *shp, struct rjb_mgr_item *ip)
+{
+
+    if (!try_push(shp->in_q, ip)) {
+        RJB_MGR_INC(&shp->st.in_full);
+        free(ip);
+        return (RJB_EFULL);
+    }
+    rjb_mgr_wakeup(shp);
+    return (0);
+}
+
+/*
+ * Queue a datagram for the stream, which is created on the first packet.
+ * The data is copied, so the caller is free to reuse the buffer. Returns
+ * RJB_EFULL if the shard is not keeping up, the datagram is then lost.
+ */
+int
+rtpjbuf_mgr_udp_in(void *_mgrp, uint64_t stream_id, const unsigned char *data,
+  size_t size, uint64_t arrival_ns)
+{
+    struct rtpjbuf_mgr *mgrp;
+    struct rjb_mgr_item *ip;
+
+    mgrp = (struct rtpjbuf_mgr *)_mgrp;
+    ip = malloc(sizeof(*ip) + size);
+    if (ip == NULL)
+        return (RJB_ENOMEM);
+    ip->pub.stream_id = stream_id;
+    ip->cmd = RJB_MGR_PKT;
+    ip->arrival_ns = arrival_ns;
+    ip->pub.size = size;
+    memcpy(ip->data, data, size);
+    return (rjb_mgr_enqueue(rjb_mgr_shard_of(mgrp, stream_id), ip));
+}
+
+/*
+ * Flush and destroy the stream's buffer, in order with the packets queued
+ * before. Whatever was still buffered is released through the output ring.
+ */
+int
+rtpjbuf_mgr_remove(void *_mgrp, uint64_t stream_id)
+{
+    struct rtpjbuf_mgr *mgrp;
+    struct rjb_mgr_item *ip;
+
+    mgrp = (struct rtpjbuf_mgr *)_mgrp;
+    ip = malloc(sizeof(*ip));
+    if (ip == NULL)
+        return (RJB_ENOMEM);
+    ip->pub.stream_id = stream_id;
+    ip->cmd = RJB_MGR_REMOVE;
+    ip->pub.size = 0;
+    return (rjb_mgr_enqueue(rjb_mgr_shard_of(mgrp, stream_id), ip));
+}
+
+/*
+ * Collect up to howmany released frames from all shards, round-robin. The
+ * order is preserved within a stream, but not across the streams. Every
+ * frame returned has to be freed with rtpjbuf_mgr_frame_dtor().
+ */
+unsigned int
+rtpjbuf_mgr_poll(void *_mgrp, struct rtpjbuf_mgr_frame *out[],
+  unsigned int howmany)
+{
+    struct rtpjbuf_mgr *mgrp;
+    unsigned int i, s, n;
+
+    mgrp = (struct rtpjbuf_mgr *)_mgrp;
+    n = 0;
+    s = mgrp->poll_next;
+    for (i = 0; i < mgrp->nshards && n < howmany; i++) {
+        n += try_pop_many(mgrp->shards[s]->out_q, (void **)(out + n),
+          howmany - n);
+        s = (s + 1) % mgrp->nshards;
+    }
+    mgrp->poll_next = (mgrp->poll_next + 1) % mgrp->nshards;
+    return (n);
+}
+
+void
+rtpjbuf_mgr_frame_dtor(struct rtpjbuf_mgr_frame *mfp)
+{
+
+    free(mfp);
+}
+
+void
+rtpjbuf_mgr_get_stats(void *_mgrp, struct rtpjbuf_mgr_stats *sp)
+{
+    struct rtpjbuf_mgr *mgrp;
+    struct rjb_mgr_shard *shp;
+
+    mgrp = (struct rtpjbuf_mgr *)_mgrp;
+    memset(sp, '\0', sizeof(*sp));
+    for (unsigned int i = 0; i < mgrp->nshards; i++) {
+        shp = mgrp->shards[i];
+        sp->in_full += atomic_load_explicit(&shp->st.in_full, memory_order_relaxed);
+        sp->out_full += atomic_load_explicit(&shp->st.out_full, memory_order_relaxed);
+        sp->perror += atomic_load_explicit(&shp->st.perror, memory_order_relaxed);
+        sp->nonrtp += atomic_load_explicit(&shp->st.nonrtp, memory_order_relaxed);
+        sp->drop += atomic_load_explicit(&shp->st.drop, memory_order_relaxed);
+        sp->streams += atomic_load_explicit(&shp->st.streams, memory_order_relaxed);
+    }
+}
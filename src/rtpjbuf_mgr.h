@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Many independent jitter buffers, sharded by the stream id across a pool
+ * of worker threads. Each shard has its own worker, its own set of
+ * streams and a pair of lock-free queues: packets go in through the input
+ * queue and the frames released by the stream buffers come out through
+ * the output ring.
+ *
+ * Input calls (rtpjbuf_mgr_udp_in() and rtpjbuf_mgr_remove()) and
+ * rtpjbuf_mgr_poll() have to be serialized by the caller, but can run
+ * concurrently with each other.
+ */
+
+#define RJB_EFULL (RTP_PARSER_IPS-1003)
+
+struct rtpjbuf_mgr_frame {
+    uint64_t stream_id;
+    struct rtp_frame frame;     /* rtp.data is valid until the dtor */
+    size_t size;                /* datagram size, 0 unless RFT_RTP */
+};
+
+struct rtpjbuf_mgr_stats {
+    uint64_t in_full;           /* packets rejected, input queue full */
+    uint64_t out_full;          /* frames lost, output ring full */
+    uint64_t perror;            /* packets failed to parse or allocate */
+    uint64_t nonrtp;
+    uint64_t drop;              /* late and duplicate packets */
+    unsigned int streams;
+};
+
+void *rtpjbuf_mgr_ctor(unsigned int nshards, unsigned int capacity,
+  unsigned int qlen);
+void rtpjbuf_mgr_dtor(void *_mgrp);
+int rtpjbuf_mgr_udp_in(void *_mgrp, uint64_t stream_id,
+  const unsigned char *data, size_t size, uint64_t arrival_ns);
+int rtpjbuf_mgr_remove(void *_mgrp, uint64_t stream_id);
+unsigned int rtpjbuf_mgr_poll(void *_mgrp, struct rtpjbuf_mgr_frame *out[],
+  unsigned int howmany);
+void rtpjbuf_mgr_frame_dtor(struct rtpjbuf_mgr_frame *mfp);
+void rtpjbuf_mgr_get_stats(void *_mgrp, struct rtpjbuf_mgr_stats *sp);
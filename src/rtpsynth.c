@@ -26,14 +26,28 @@
 #if defined(_WIN32) || defined(_WIN64)
 #define _CRT_RAND_S
 #pragma comment(linker, "/export:rsynth_ctor")
+#pragma comment(linker, "/export:rsynth_ctor_rf")
 #pragma comment(linker, "/export:rsynth_next_pkt")
 #pragma comment(linker, "/export:rsynth_next_pkt_pa")
+#pragma comment(linker, "/export:rsynth_next_pkt_pa_at")
+#pragma comment(linker, "/export:rsynth_next_pkts")
+#pragma comment(linker, "/export:rsynth_next_hdr")
 #pragma comment(linker, "/export:rsynth_skip")
 #pragma comment(linker, "/export:rsynth_pkt_free")
 #pragma comment(linker, "/export:rsynth_dtor")
 #pragma comment(linker, "/export:rsynth_set_mbt")
 #pragma comment(linker, "/export:rsynth_resync")
+#pragma comment(linker, "/export:rsynth_resync_at")
+#pragma comment(linker, "/export:rsynth_set_clock")
 #pragma comment(linker, "/export:rsynth_set_randfunc")
+#pragma comment(linker, "/export:rsynth_prng_seed")
+#pragma comment(linker, "/export:rsynth_prng_init")
+#pragma comment(linker, "/export:rsynth_prng_next")
+#pragma comment(linker, "/export:rsynth_hdr_len")
+#pragma comment(linker, "/export:rsynth_hdrext_add")
+#pragma comment(linker, "/export:rsynth_hdrext_set")
+#pragma comment(linker, "/export:rsynth_hdrext_set_uint")
+#pragma comment(linker, "/export:rsynth_hdrext_clear")
 #endif
 
 #define _DEFAULT_SOURCE
@@ -49,6 +63,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
 
 #if defined(_WIN32) || defined(_WIN64)
 static long
@@ -63,6 +80,7 @@ random(void)
 
 #include "rtp.h"
 #include "rtpsynth.h"
+#include "rtpsynth_int.h"
 #include "rsth_timeops.h"
 
 static uint32_t
@@ -75,13 +93,41 @@ rsynth_default_randfunc(void *arg)
 static rsynth_randfunc_t rsynth_randfunc = rsynth_default_randfunc;
 static void *rsynth_randfunc_arg = NULL;
 
+#if defined(_MSC_VER)
+#define RSYNTH_TLS __declspec(thread)
+#else
+#define RSYNTH_TLS _Thread_local
+#endif
+
+static RSYNTH_TLS struct rsynth_prng rsynth_tls_prng;
+static RSYNTH_TLS int rsynth_tls_prng_inited;
+
+uint32_t
+rsynth_rand32(void)
+{
+
+    return (rsynth_randfunc(rsynth_randfunc_arg));
+}
+
+/* Header extension element in the model, off is that of the value */
+struct rsynth_hdrext {
+    uint8_t id;
+    uint8_t len;
+    uint8_t off;
+};
+
 struct rsynth_inst {
     int srate;
     int ptime;
     struct rsynth_seq l;
     int ts_inc;
-    struct timespec last_ts;
-    unsigned char model[sizeof(struct rtp_hdr)];
+    enum rsynth_clock clk;
+    uint64_t last_ns;
+    unsigned int hlen;
+    int next;
+    struct rsynth_hdrext ext[RSYNTH_HDREXT_MAXN];
+    unsigned char model[sizeof(struct rtp_hdr) + sizeof(struct rtp_hdr_ext) +
+      RSYNTH_HDREXT_MAXLEN];
 };
 
 #define RS_MODEL(rip) ((struct rtp_hdr *)((rip)->model))
@@ -113,13 +159,153 @@ clock_gettime_monotonic(struct timespec *tv)
 #define clock_gettime(_, x) clock_gettime_monotonic(x)
 #endif
 
+#if defined(CLOCK_MONOTONIC_COARSE)
+#define RSYNTH_COARSE_CLOCK_ID CLOCK_MONOTONIC_COARSE
+#elif defined(CLOCK_MONOTONIC_FAST)
+#define RSYNTH_COARSE_CLOCK_ID CLOCK_MONOTONIC_FAST
+#else
+#define RSYNTH_COARSE_CLOCK_ID CLOCK_MONOTONIC
+#endif
+
+static int
+rsynth_getclock(const struct rsynth_inst *rip, uint64_t *now_ns)
+{
+    struct timespec ts;
+
+    switch (rip->clk) {
+    case RSYNTH_CLOCK_NONE:
+        return (-1);
+
+    case RSYNTH_CLOCK_COARSE:
+        (void)clock_gettime(RSYNTH_COARSE_CLOCK_ID, &ts);
+        break;
+
+    default:
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        break;
+    }
+    *now_ns = timespec2un64time(&ts);
+    return (0);
+}
+
+static void
+rsynth_update_last(struct rsynth_inst *rip)
+{
+    uint64_t now_ns;
+
+    if (rsynth_getclock(rip, &now_ns) == 0)
+        rip->last_ns = now_ns;
+}
+
+static uint64_t
+splitmix64(uint64_t *xp)
+{
+    uint64_t z;
+
+    z = (*xp += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (z ^ (z >> 31));
+}
+
+void
+rsynth_prng_seed(struct rsynth_prng *rngp, uint64_t seed)
+{
+    uint64_t w;
+
+    w = splitmix64(&seed);
+    rngp->s[0] = (uint32_t)w;
+    rngp->s[1] = (uint32_t)(w >> 32);
+    w = splitmix64(&seed);
+    rngp->s[2] = (uint32_t)w;
+    rngp->s[3] = (uint32_t)(w >> 32);
+}
+
+/*
+ * Seed generator from the OS entropy source, falling back to the clock
+ * and the address of the state should that fail for whatever reason.
+ */
+void
+rsynth_prng_init(struct rsynth_prng *rngp)
+{
+    uint64_t seed = 0;
+
+#if defined(__linux__)
+    if (getrandom(&seed, sizeof(seed), GRND_NONBLOCK) != sizeof(seed))
+        seed = 0;
+#elif defined(_WIN32) || defined(_WIN64)
+    unsigned int r[2];
+
+    if (rand_s(&r[0]) == 0 && rand_s(&r[1]) == 0)
+        seed = ((uint64_t)r[1] << 32) | r[0];
+#else
+    arc4random_buf(&seed, sizeof(seed));
+#endif
+    if (seed == 0) {
+        struct timespec ts;
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+        seed = timespec2un64time(&ts) ^ (uint64_t)(uintptr_t)rngp;
+    }
+    rsynth_prng_seed(rngp, seed);
+}
+
+static inline uint32_t
+rotl32(uint32_t x, int k)
+{
+
+    return ((x << k) | (x >> (32 - k)));
+}
+
+/* xoshiro128** */
+uint32_t
+rsynth_prng_next(void *arg)
+{
+    struct rsynth_prng *rngp;
+    uint32_t *s, r, t;
+
+    rngp = (struct rsynth_prng *)arg;
+    s = rngp->s;
+    r = rotl32(s[1] * 5, 7) * 9;
+    t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl32(s[3], 11);
+    return (r);
+}
+
 void *
 rsynth_ctor(int srate, int ptime)
+{
+
+    return (rsynth_ctor_rf(srate, ptime, rsynth_randfunc, rsynth_randfunc_arg));
+}
+
+/*
+ * Same as rsynth_ctor() but takes random source to initialize SSRC,
+ * sequence and timestamp from the caller instead of the process-global
+ * one. With func == NULL per-thread rsynth_prng seeded from the OS
+ * entropy on first use is used, so no locks are involved.
+ */
+void *
+rsynth_ctor_rf(int srate, int ptime, rsynth_randfunc_t func, void *arg)
 {
     struct rsynth_inst *rip;
     struct rtp_hdr *model;
     uint32_t rand_val;
 
+    if (func == NULL) {
+        if (!rsynth_tls_prng_inited) {
+            rsynth_prng_init(&rsynth_tls_prng);
+            rsynth_tls_prng_inited = 1;
+        }
+        func = rsynth_prng_next;
+        arg = &rsynth_tls_prng;
+    }
+
     rip = malloc(sizeof(struct rsynth_inst));
     if (rip == NULL)
         return (NULL);
@@ -128,54 +314,128 @@ rsynth_ctor(int srate, int ptime)
     rip->srate = srate;
     rip->ptime = ptime;
     rip->ts_inc = 80 * ptime / 10;
+    rip->hlen = sizeof(struct rtp_hdr);
     model->version = 2;
     model->mbt = 1;
-    rand_val = rsynth_randfunc(rsynth_randfunc_arg);
+    rand_val = func(arg);
     model->ssrc = rand_val;
-    rand_val = rsynth_randfunc(rsynth_randfunc_arg);
+    rand_val = func(arg);
     rip->l.ts = rand_val & 0xfffffffe;
-    rand_val = rsynth_randfunc(rsynth_randfunc_arg);
+    rand_val = func(arg);
     rip->l.seq = rand_val & 0xffff;
-    (void)clock_gettime(CLOCK_MONOTONIC, &rip->last_ts);
+    rip->clk = RSYNTH_CLOCK_MONOTONIC;
+    rsynth_update_last(rip);
     return ((void *)rip);
 }
 
-int
-rsynth_next_pkt_pa(void *_rip, int plen, int pt, char *buf, unsigned int blen,
-  int filled)
+static void
+rsynth_stamp_hdr(struct rsynth_inst *rip, int pt, struct rtp_hdr *rnp)
 {
-    struct rsynth_inst *rip;
     struct rtp_hdr *model;
-    struct rtp_hdr *rnp;
-    unsigned int rs, hl;
 
-    rip = (struct rsynth_inst *)_rip;
     model = RS_MODEL(rip);
-    hl = RTP_HDR_LEN(model);
+    memcpy(rnp, model, rip->hlen);
+    rnp->pt = pt;
+    rnp->seq = htons(rip->l.seq);
+    rnp->ts = htonl(rip->l.ts);
+    model->mbt = 0;
+    rip->l.seq++;
+    rip->l.ts += rip->ts_inc;
+}
+
+static int
+rsynth_next_pkt_fill(struct rsynth_inst *rip, int plen, int pt, char *buf,
+  unsigned int blen, int filled)
+{
+    unsigned int rs, hl;
+
+    hl = rip->hlen;
     rs = hl + plen;
     if (rs > blen)
         return (-1);
-    rnp = (struct rtp_hdr *)buf;
     if (filled == 0) {
-        memset(buf + sizeof(struct rtp_hdr), '\0', blen - sizeof(struct rtp_hdr));
+        memset(buf + hl, '\0', blen - hl);
     } else {
         memmove(buf + hl, buf, plen);
         memset(buf + hl + plen, '\0', blen - hl - plen);
     }
 
-    memcpy(rnp, model, sizeof(struct rtp_hdr));
-    rnp->pt = pt;
-    rnp->seq = htons(rip->l.seq);
-    rnp->ts = htonl(rip->l.ts);
-    model->mbt = 0;
-    rip->l.seq++;
-    rip->l.ts += rip->ts_inc;
+    rsynth_stamp_hdr(rip, pt, (struct rtp_hdr *)buf);
+
+    return (rs);
+}
+
+int
+rsynth_next_pkt_pa(void *_rip, int plen, int pt, char *buf, unsigned int blen,
+  int filled)
+{
+    struct rsynth_inst *rip;
+    int rs;
+
+    rip = (struct rsynth_inst *)_rip;
+    rs = rsynth_next_pkt_fill(rip, plen, pt, buf, blen, filled);
+    if (rs < 0)
+        return (rs);
+
+    rsynth_update_last(rip);
+
+    return (rs);
+}
+
+/*
+ * Same as rsynth_next_pkt_pa(), but the caller supplies current monotonic
+ * time, so that the instance never has to read the clock itself.
+ */
+int
+rsynth_next_pkt_pa_at(void *_rip, int plen, int pt, char *buf,
+  unsigned int blen, int filled, uint64_t now_ns)
+{
+    struct rsynth_inst *rip;
+    int rs;
+
+    rip = (struct rsynth_inst *)_rip;
+    rs = rsynth_next_pkt_fill(rip, plen, pt, buf, blen, filled);
+    if (rs < 0)
+        return (rs);
 
-    (void)clock_gettime(CLOCK_MONOTONIC, &rip->last_ts);
+    rip->last_ns = now_ns;
 
     return (rs);
 }
 
+/*
+ * Generate up to npkts back-to-back packets with zeroed payload into the
+ * contiguous buffer buf. Offset and length of each packet are stored into
+ * offs[] and lens[] respectively. The clock is only sampled once per batch.
+ * Returns number of packets generated, or -1 if not even a single packet
+ * fits into the buffer.
+ */
+int
+rsynth_next_pkts(void *_rip, int npkts, int plen, int pt, char *buf,
+  unsigned int blen, unsigned int *offs, unsigned int *lens)
+{
+    struct rsynth_inst *rip;
+    unsigned int rs, off;
+    int i;
+
+    rip = (struct rsynth_inst *)_rip;
+    rs = rip->hlen + plen;
+    if (npkts <= 0 || rs > blen)
+        return (-1);
+    if ((unsigned int)npkts > blen / rs)
+        npkts = blen / rs;
+    memset(buf, '\0', (size_t)rs * npkts);
+    for (i = 0, off = 0; i < npkts; i++, off += rs) {
+        rsynth_stamp_hdr(rip, pt, (struct rtp_hdr *)(buf + off));
+        offs[i] = off;
+        lens[i] = rs;
+    }
+
+    rsynth_update_last(rip);
+
+    return (npkts);
+}
+
 void *
 rsynth_next_pkt(void *_rip, int plen, int pt)
 {
@@ -184,7 +444,7 @@ rsynth_next_pkt(void *_rip, int plen, int pt)
     size_t rs;
 
     rip = (struct rsynth_inst *)_rip;
-    rs = RTP_HDR_LEN(RS_MODEL(rip)) + plen;
+    rs = rip->hlen + plen;
     rnp = malloc(rs);
     if (rnp == NULL)
         return (NULL);
@@ -193,6 +453,52 @@ rsynth_next_pkt(void *_rip, int plen, int pt)
     return (rnp);
 }
 
+/*
+ * Header-only mode: write just the RTP header of the next packet into hbuf,
+ * leaving it up to the caller to send the payload from wherever it lives.
+ * Returns the header length or -1 if hbuf is too small.
+ */
+int
+rsynth_next_hdr(void *_rip, int pt, char *hbuf, unsigned int hblen)
+{
+    struct rsynth_inst *rip;
+    unsigned int hl;
+
+    rip = (struct rsynth_inst *)_rip;
+    hl = rip->hlen;
+    if (hl > hblen)
+        return (-1);
+
+    rsynth_stamp_hdr(rip, pt, (struct rtp_hdr *)hbuf);
+
+    rsynth_update_last(rip);
+
+    return (hl);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+/*
+ * Scatter/gather mode: stamp the header into hbuf and describe the packet
+ * as {header, payload} pair suitable for sendmsg(2) / writev(2). Payload
+ * is never touched. Returns the total packet length or -1 on error.
+ */
+int
+rsynth_next_pkt_iov(void *ri, const void *pload, int plen, int pt,
+  char *hbuf, unsigned int hblen, struct iovec iov[2])
+{
+    int hl;
+
+    hl = rsynth_next_hdr(ri, pt, hbuf, hblen);
+    if (hl < 0)
+        return (-1);
+    iov[0].iov_base = hbuf;
+    iov[0].iov_len = hl;
+    iov[1].iov_base = (void *)(uintptr_t)pload;
+    iov[1].iov_len = plen;
+    return (hl + plen);
+}
+#endif
+
 void
 rsynth_skip(void *_rip, int npkts)
 {
@@ -217,19 +523,193 @@ rsynth_set_mbt(void *_rip, unsigned int new_st)
     return (old_st);
 }
 
+/*
+ * Total length of the headers generated by the instance, including the
+ * header extension block if any.
+ */
+unsigned int
+rsynth_hdr_len(void *_rip)
+{
+    struct rsynth_inst *rip;
+
+    rip = (struct rsynth_inst *)_rip;
+    return (rip->hlen);
+}
+
+/*
+ * Add RFC 8285 header extension element into the header template, with
+ * data as its initial value. One-byte form is used as long as all elements
+ * fit in it, two-byte one otherwise. Returns 0 on success or -1 if the
+ * element is invalid, duplicate or does not fit.
+ */
+int
+rsynth_hdrext_add(void *_rip, int id, const void *data, unsigned int len)
+{
+    struct rsynth_inst *rip;
+    struct rtp_hdr_ext *hep;
+    unsigned char ovals[sizeof(rip->model)];
+    unsigned char *p;
+    unsigned int elen;
+    int i, twobyte;
+
+    rip = (struct rsynth_inst *)_rip;
+    if (id <= 0 || id > 255 || len > 255 || rip->next == RSYNTH_HDREXT_MAXN)
+        return (-1);
+    twobyte = (id > RTP_HDREXT_ONEBYTE_MAXID || len == 0 ||
+      len > RTP_HDREXT_ONEBYTE_MAXLEN);
+    elen = len;
+    for (i = 0; i < rip->next; i++) {
+        if (rip->ext[i].id == id)
+            return (-1);
+        if (rip->ext[i].id > RTP_HDREXT_ONEBYTE_MAXID || rip->ext[i].len == 0 ||
+          rip->ext[i].len > RTP_HDREXT_ONEBYTE_MAXLEN)
+            twobyte = 1;
+        elen += rip->ext[i].len;
+    }
+    elen += (rip->next + 1) * (twobyte ? 2 : 1);
+    elen = (elen + 3) & ~3U;
+    if (elen > RSYNTH_HDREXT_MAXLEN)
+        return (-1);
+
+    /* Re-layout the block, old values are moved over from the copy */
+    memcpy(ovals, rip->model, sizeof(ovals));
+    rip->ext[rip->next].id = id;
+    rip->ext[rip->next].len = len;
+    rip->next += 1;
+    hep = (struct rtp_hdr_ext *)(rip->model + sizeof(struct rtp_hdr));
+    hep->profile = htons(twobyte ? RTP_HDREXT_TWOBYTE : RTP_HDREXT_ONEBYTE);
+    hep->length = htons(elen / sizeof(hep->extension[0]));
+    p = (unsigned char *)hep->extension;
+    memset(p, '\0', elen);
+    for (i = 0; i < rip->next; i++) {
+        struct rsynth_hdrext *ep = &rip->ext[i];
+
+        if (twobyte) {
+            *p++ = ep->id;
+            *p++ = ep->len;
+        } else {
+            *p++ = (ep->id << 4) | (ep->len - 1);
+        }
+        if (i == rip->next - 1)
+            memcpy(p, data, len);
+        else
+            memcpy(p, ovals + ep->off, ep->len);
+        ep->off = p - rip->model;
+        p += ep->len;
+    }
+    RS_MODEL(rip)->x = 1;
+    rip->hlen = sizeof(struct rtp_hdr) + sizeof(struct rtp_hdr_ext) + elen;
+    return (0);
+}
+
+static struct rsynth_hdrext *
+rsynth_hdrext_lookup(struct rsynth_inst *rip, int id)
+{
+
+    for (int i = 0; i < rip->next; i++) {
+        if (rip->ext[i].id == id)
+            return (&rip->ext[i]);
+    }
+    return (NULL);
+}
+
+/*
+ * Patch value of the extension element in the template, it is going to
+ * be sent with all subsequent packets. Returns -1 if there is no such
+ * element or its length does not match.
+ */
+int
+rsynth_hdrext_set(void *_rip, int id, const void *data, unsigned int len)
+{
+    struct rsynth_inst *rip;
+    struct rsynth_hdrext *ep;
+
+    rip = (struct rsynth_inst *)_rip;
+    ep = rsynth_hdrext_lookup(rip, id);
+    if (ep == NULL || ep->len != len)
+        return (-1);
+    memcpy(rip->model + ep->off, data, len);
+    return (0);
+}
+
+/*
+ * Same as rsynth_hdrext_set(), but stores val in network byte order using
+ * as many bytes as the element has (up to 4), e.g. 1 for the audio level,
+ * 2 for the transport-wide sequence or 3 for the abs-send-time.
+ */
+int
+rsynth_hdrext_set_uint(void *_rip, int id, uint32_t val)
+{
+    struct rsynth_inst *rip;
+    struct rsynth_hdrext *ep;
+    unsigned char *p;
+
+    rip = (struct rsynth_inst *)_rip;
+    ep = rsynth_hdrext_lookup(rip, id);
+    if (ep == NULL || ep->len == 0 || ep->len > sizeof(val))
+        return (-1);
+    p = rip->model + ep->off;
+    for (int i = ep->len - 1; i >= 0; i--) {
+        p[i] = val & 0xff;
+        val >>= 8;
+    }
+    return (0);
+}
+
 void
-rsynth_resync(void *_rip, struct rsynth_seq *rsp)
+rsynth_hdrext_clear(void *_rip)
 {
-    struct timespec curr_ts;
     struct rsynth_inst *rip;
 
     rip = (struct rsynth_inst *)_rip;
+    rip->next = 0;
+    RS_MODEL(rip)->x = 0;
+    rip->hlen = sizeof(struct rtp_hdr);
+}
+
+static void
+rsynth_resync_ns(struct rsynth_inst *rip, struct rsynth_seq *rsp,
+  uint64_t now_ns)
+{
+
     if (rsp != NULL) {
         *rsp = rip->l;
     }
-    (void)clock_gettime(CLOCK_MONOTONIC, &curr_ts);
-    timespecsub(&curr_ts, &rip->last_ts);
-    rip->l.ts += timespec2un64time(&curr_ts) * rip->srate / NSEC_IN_SEC;
+    if (now_ns <= rip->last_ns)
+        return;
+    rip->l.ts += (now_ns - rip->last_ns) * rip->srate / NSEC_IN_SEC;
+}
+
+void
+rsynth_resync(void *_rip, struct rsynth_seq *rsp)
+{
+    struct rsynth_inst *rip;
+    uint64_t now_ns;
+
+    rip = (struct rsynth_inst *)_rip;
+    if (rsynth_getclock(rip, &now_ns) != 0)
+        now_ns = rip->last_ns;
+    rsynth_resync_ns(rip, rsp, now_ns);
+}
+
+void
+rsynth_resync_at(void *_rip, struct rsynth_seq *rsp, uint64_t now_ns)
+{
+
+    rsynth_resync_ns((struct rsynth_inst *)_rip, rsp, now_ns);
+}
+
+enum rsynth_clock
+rsynth_set_clock(void *_rip, enum rsynth_clock new_clk)
+{
+    struct rsynth_inst *rip;
+    enum rsynth_clock old_clk;
+
+    rip = (struct rsynth_inst *)_rip;
+    old_clk = rip->clk;
+    rip->clk = new_clk;
+    rsynth_update_last(rip);
+    return (old_clk);
 }
 
 void
@@ -30,6 +30,7 @@
 #include <stdint.h>
 
 #if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/uio.h>
 #define EXPORT
 #else
 #define EXPORT __declspec(dllexport)
@@ -40,14 +41,54 @@ struct rsynth_seq {
     unsigned long long seq;
 };
 
+/*
+ * Clock used by the instance to track time of the last packet, for the
+ * purpose of rsynth_resync(). With RSYNTH_CLOCK_NONE the clock is never
+ * read and the time is only known from the *_at() variants.
+ */
+enum rsynth_clock {
+    RSYNTH_CLOCK_MONOTONIC = 0,
+    RSYNTH_CLOCK_COARSE = 1,
+    RSYNTH_CLOCK_NONE = 2
+};
+
+/* Limits on the RFC 8285 header extension template */
+#define RSYNTH_HDREXT_MAXN	8
+#define RSYNTH_HDREXT_MAXLEN	64
+
 typedef uint32_t (*rsynth_randfunc_t)(void *arg);
 
+/* State of the lock-free xoshiro128** generator */
+struct rsynth_prng {
+    uint32_t s[4];
+};
+
 void *rsynth_ctor(int srate, int ptime);
+void *rsynth_ctor_rf(int srate, int ptime, rsynth_randfunc_t func, void *arg);
 void *rsynth_next_pkt(void *ri, int plen, int pt);
 int rsynth_next_pkt_pa(void *ri, int plen, int pt, char *buf, unsigned int blen, int pa);
+int rsynth_next_pkt_pa_at(void *ri, int plen, int pt, char *buf,
+  unsigned int blen, int pa, uint64_t now_ns);
+int rsynth_next_pkts(void *ri, int npkts, int plen, int pt, char *buf,
+  unsigned int blen, unsigned int *offs, unsigned int *lens);
+int rsynth_next_hdr(void *ri, int pt, char *hbuf, unsigned int hblen);
+#if !defined(_WIN32) && !defined(_WIN64)
+int rsynth_next_pkt_iov(void *ri, const void *pload, int plen, int pt,
+  char *hbuf, unsigned int hblen, struct iovec iov[2]);
+#endif
 void rsynth_skip(void *ri, int npkts);
 void rsynth_pkt_free(void *rnp);
 void rsynth_dtor(void *ri);
 unsigned int rsynth_set_mbt(void *ri, unsigned int new_st);
 void rsynth_resync(void *ri, struct rsynth_seq *rsp);
+void rsynth_resync_at(void *ri, struct rsynth_seq *rsp, uint64_t now_ns);
+enum rsynth_clock rsynth_set_clock(void *ri, enum rsynth_clock new_clk);
 void rsynth_set_randfunc(rsynth_randfunc_t func, void *arg);
+void rsynth_prng_seed(struct rsynth_prng *rngp, uint64_t seed);
+void rsynth_prng_init(struct rsynth_prng *rngp);
+uint32_t rsynth_prng_next(void *rngp);
+unsigned int rsynth_hdr_len(void *ri);
+int rsynth_hdrext_add(void *ri, int id, const void *data, unsigned int len);
+int rsynth_hdrext_set(void *ri, int id, const void *data, unsigned int len);
+int rsynth_hdrext_set_uint(void *ri, int id, uint32_t val);
+void rsynth_hdrext_clear(void *ri);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Not part of the public API, shared between rsynth components */
+uint32_t rsynth_rand32(void);
+
+struct rtp_info;
+struct rtp_ptmap;
+
+/* Not part of the public API either, for the jitter buffer */
+void rtp_packet_parse_fill(const unsigned char *buf, size_t size,
+  unsigned int pt, unsigned int data_offset, int padding_size,
+  const struct rtp_ptmap *pm, struct rtp_info *rinfo);
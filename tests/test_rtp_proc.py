@@ -239,6 +239,31 @@ class TestRtpProc(unittest.TestCase):
         self.assertEqual(str(cm.exception.__cause__), "boom")
         self.assertTrue(ch.closed)
 
+    def test_pipelined_create_and_close(self):
+        calls = []
+
+        def ok_in(now_ns, _deadline_ns):
+            calls.append(now_ns)
+            return None
+
+        def bad_in(_now_ns, _deadline_ns):
+            raise ValueError("boom")
+
+        chans = [self.proc.create_channel(proc_in=ok_in, wait=False)
+                 for _ in range(100)]
+        bad = self.proc.create_channel(proc_in=bad_in, wait=False)
+        for ch in chans:
+            ch.close(wait=False)
+        bad.close(wait=False)
+        self.assertTrue(bad.closed)
+        for ch in chans:
+            ch.wait()
+        self.assertEqual(len(calls), len(chans))
+        with self.assertRaises(ChannelProcError) as cm:
+            bad.wait()
+        self.assertIsInstance(cm.exception.__cause__, ValueError)
+        bad.wait()
+
     @unittest.skipUnless(
         os.environ.get("RTPSYNTH_RUN_BULK", "") == "1",
         "bulk RtpProc scaling test disabled; set RTPSYNTH_RUN_BULK=1",
@@ -1,7 +1,9 @@
 import gc
 import errno
+import os
 import socket
 import sys
+import threading
 import time
 import unittest
 import weakref
@@ -82,6 +84,186 @@ class TestRtpServer(unittest.TestCase):
                 ch_b.close()
             srv.shutdown()
 
+    def test_send_pkts(self):
+        received = []
+        srv = RtpServer(tick_hz=200)
+        ch = None
+        try:
+            ch = srv.create_channel(
+                pkt_in=lambda pkt, _addr, _rtime: received.append(pkt),
+                bind_host="127.0.0.1",
+                bind_port=0,
+            )
+            addr = ch.local_addr
+            ch.set_target(addr[0], addr[1])
+
+            sent = [f"p-{i}".encode("ascii") for i in range(15)]
+            for i in range(0, len(sent), 5):
+                self.assertEqual(ch.send_pkts(sent[i:i + 5]), 5)
+            self.assertEqual(ch.send_pkts([]), 0)
+            with self.assertRaises(TypeError):
+                ch.send_pkts(None)
+
+            ok = wait_for(lambda: len(received) >= len(sent))
+            self.assertTrue(ok, "timeout waiting for packets")
+            self.assertEqual(received, sent)
+        finally:
+            if ch is not None:
+                ch.close()
+            srv.shutdown()
+
+    def test_batched_io(self):
+        # More datagrams than the worker moves per socket call, both ways
+        received = []
+        srv = RtpServer(tick_hz=50)
+        ch = None
+        peer = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            peer.bind(("127.0.0.1", 0))
+            peer.settimeout(2.0)
+            ch = srv.create_channel(
+                pkt_in=lambda pkt, _addr, _rtime: received.append(pkt),
+                bind_host="127.0.0.1",
+                bind_port=0,
+                queue_size=256,
+            )
+            ch.set_target(*peer.getsockname())
+
+            sent = [f"p-{i}".encode("ascii") + b"x" * i for i in range(100)]
+            for pkt in sent:
+                peer.sendto(pkt, ch.local_addr)
+            self.assertEqual(ch.send_pkts(sent), len(sent))
+
+            ok = wait_for(lambda: len(received) >= len(sent))
+            self.assertTrue(ok, "timeout waiting for packets")
+            self.assertEqual(received, sent)
+            self.assertEqual([peer.recv(2048) for _ in sent], sent)
+        finally:
+            peer.close()
+            if ch is not None:
+                ch.close()
+            srv.shutdown()
+
+    def test_send_inline_and_large(self):
+        received = []
+        srv = RtpServer(tick_hz=200)
+        ch = None
+        try:
+            # 1K output ring: anything above half of it goes by reference
+            ch = srv.create_channel(
+                pkt_in=lambda pkt, _addr, _rtime: received.append(pkt),
+                bind_host="127.0.0.1",
+                bind_port=0,
+                queue_size=2,
+            )
+            addr = ch.local_addr
+            ch.set_target(addr[0], addr[1])
+
+            sent = [b"a" * 100, b"b" * 4000, bytearray(b"c" * 300), b"d" * 512]
+            ch.send_pkt(sent[0])
+            self.assertEqual(ch.send_pkts(sent[1:3]), 2)
+            ok = wait_for(lambda: len(received) >= 3)
+            self.assertTrue(ok, "timeout waiting for packets")
+            ch.send_pkt(sent[3])
+
+            ok = wait_for(lambda: len(received) >= len(sent))
+            self.assertTrue(ok, "timeout waiting for packets")
+            self.assertEqual(received, [bytes(p) for p in sent])
+        finally:
+            if ch is not None:
+                ch.close()
+            srv.shutdown()
+
+    def test_send_multi_producer(self):
+        nthreads, npkts = 4, 50
+        received = []
+        srv = RtpServer(tick_hz=200)
+        ch = None
+        try:
+            ch = srv.create_channel(
+                pkt_in=lambda pkt, _addr, _rtime: received.append(pkt),
+                bind_host="127.0.0.1",
+                bind_port=0,
+                queue_size=512,
+                multi_producer=True,
+            )
+            addr = ch.local_addr
+            ch.set_target(addr[0], addr[1])
+
+            def sender(tid):
+                for i in range(npkts):
+                    pkt = f"{tid}-{i}".encode("ascii")
+                    while True:
+                        try:
+                            ch.send_pkt(pkt)
+                            break
+                        except RtpQueueFullError:
+                            time.sleep(0.001)
+
+            threads = [threading.Thread(target=sender, args=(t,))
+                       for t in range(nthreads)]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+
+            ok = wait_for(lambda: len(received) >= nthreads * npkts)
+            self.assertTrue(ok, "timeout waiting for packets")
+            for tid in range(nthreads):
+                got = [pkt for pkt in received if pkt.startswith(f"{tid}-".encode("ascii"))]
+                self.assertEqual(got, [f"{tid}-{i}".encode("ascii") for i in range(npkts)])
+        finally:
+            if ch is not None:
+                ch.close()
+            srv.shutdown()
+
+    def test_pipelined_commands(self):
+        nthreads, nchans = 4, 64
+        received = []
+        srv = RtpServer(tick_hz=200)
+        chans = []
+        lock = threading.Lock()
+        try:
+            def creator():
+                mine = [srv.create_channel(
+                    pkt_in=lambda pkt, _addr, _rtime: received.append(pkt),
+                    bind_host="127.0.0.1",
+                    bind_port=0,
+                    wait=False,
+                ) for _ in range(nchans)]
+                for ch in mine:
+                    addr = ch.local_addr
+                    ch.set_target(addr[0], addr[1], wait=False)
+                with lock:
+                    chans.extend(mine)
+
+            threads = [threading.Thread(target=creator) for _ in range(nthreads)]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+            self.assertEqual(len(chans), nthreads * nchans)
+            for ch in chans:
+                ch.wait()
+            for i, ch in enumerate(chans):
+                ch.send_pkt(f"p-{i}".encode("ascii"))
+
+            ok = wait_for(lambda: len(received) >= len(chans))
+            self.assertTrue(ok, "timeout waiting for packets")
+            self.assertEqual(sorted(received),
+                             sorted(f"p-{i}".encode("ascii") for i in range(len(chans))))
+
+            for ch in chans:
+                ch.close(wait=False)
+                self.assertTrue(ch.closed)
+            for ch in chans:
+                ch.wait()
+        finally:
+            for ch in chans:
+                if not ch.closed:
+                    ch.close()
+            srv.shutdown()
+
     def test_channel_close_and_shutdown(self):
         received = []
         srv = RtpServer()
@@ -276,6 +458,33 @@ class TestRtpServer(unittest.TestCase):
         gc.collect()
         gc.collect()
 
+    def test_server_released_by_worker(self):
+        # The worker may drop the last channel reference and with it the
+        # last server one, so the server has to go away on the worker
+        def nthreads():
+            try:
+                return len(os.listdir("/proc/self/task"))
+            except OSError:
+                return None
+
+        before = nthreads()
+        for wait in (True, False):
+            for _ in range(50):
+                srv = RtpServer()
+                ch = srv.create_channel(
+                    pkt_in=lambda _pkt, _addr, _rtime: None,
+                    bind_host="127.0.0.1",
+                    bind_port=0,
+                )
+                del srv
+                ch.close(wait=wait)
+                del ch
+                time.sleep(0.02)
+        gc.collect()
+        if before is not None:
+            self.assertTrue(wait_for(lambda: nthreads() <= before),
+                            "worker threads did not exit")
+
     def test_create_channel_huge_queue_size(self):
         srv = RtpServer()
         try:
@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 
+#include "rtp.h"
 #include "rtpsynth.h"
+#include "rsynth_pool.h"
+#include "rsynth_pacer.h"
 
 #if !defined(_WIN32) && !defined(_WIN64)
 static void inline
@@ -22,12 +26,49 @@ static inline void taint(char *p) {
 }
 #endif
 
+static int
+pacer_pload(void *arg, char *pload, unsigned int maxlen, uint64_t deadline_ns)
+{
+
+    (void)arg;
+    (void)deadline_ns;
+    memset(pload, 0xff, maxlen);
+    return (maxlen);
+}
+
+static void
+check_abs_send_time(void)
+{
+    static const struct {
+        uint64_t ns;
+        uint32_t ast;
+    } cases[] = {
+        {250000000ULL, 0x010000},
+        {63999999999ULL, 0xffffff},
+        {64000000000ULL, 0},
+        /* Past 2^46 us, e.g. a wall clock value */
+        {1000000001500000000ULL, 0x060000},
+        {UINT64_MAX, 0x26d694},
+    };
+
+    for (size_t j = 0; j < sizeof(cases) / sizeof(cases[0]); j++) {
+        uint32_t ast = RTP_HDREXT_ABS_SEND_TIME(cases[j].ns);
+        if (ast != cases[j].ast) {
+            fprintf(stderr, "abs-send-time(%llu) = 0x%06x, expected 0x%06x\n",
+              (unsigned long long)cases[j].ns, ast, cases[j].ast);
+            exit(1);
+        }
+    }
+}
+
 int main(void) {
     double tdur = 1.0;
     uint64_t i = 0;
     clock_t start, end;
     double cpu_time_used;
 
+    check_abs_send_time();
+
     void *rs = rsynth_ctor(8000, 30);
     start = clock();
 
@@ -54,5 +95,67 @@ int main(void) {
     double Mpps = Mi / cpu_time_used;
     printf("Generated %.2fM packets in %.3f seconds, %.2fM packets per second\n", Mi, cpu_time_used, Mpps);
 
+    const unsigned int nstreams = 10000;
+    void *rp = rsynth_pool_ctor(nstreams, 20);
+    unsigned char *hdrs = malloc(nstreams * RSYNTH_POOL_HDR_LEN);
+    for (unsigned int j = 0; j < nstreams; j++)
+        rsynth_pool_add(rp, 8000, 0);
+    i = 0;
+    start = clock();
+    while (1) {
+        i += rsynth_pool_tick(rp, hdrs);
+        taint((char *)hdrs);
+
+        if (i % (100 * nstreams) == 0) {
+            end = clock();
+            cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
+            if (cpu_time_used >= tdur) {
+                break;
+            }
+        }
+    }
+    free(hdrs);
+    rsynth_pool_dtor(rp);
+
+    Mi = (double)(i) / (double)(1000000);
+    Mpps = Mi / cpu_time_used;
+    printf("Stamped %.2fM pool headers in %.3f seconds, %.2fM headers per second\n", Mi, cpu_time_used, Mpps);
+
+    const unsigned int npstreams = 50000, maxpkts = 4096;
+    void *pp = rsynth_pacer_ctor(npstreams, 1000000, 160, 5);
+    char *pbuf = malloc(maxpkts * (12 + 160));
+    struct rsynth_pacer_pkt *pkts = malloc(maxpkts * sizeof(*pkts));
+    for (unsigned int j = 0; j < npstreams; j++)
+        rsynth_pacer_add(pp, 8000, 20, 0, pacer_pload, NULL,
+          (uint64_t)(j % 20) * 1000000);
+    uint64_t now_ns = 0;
+    i = 0;
+    start = clock();
+    while (1) {
+        int n;
+
+        while ((n = rsynth_pacer_run(pp, now_ns, pbuf, maxpkts * (12 + 160),
+          pkts, maxpkts)) > 0) {
+            taint(pbuf);
+            i += n;
+        }
+        now_ns += 1000000;
+
+        if (now_ns % 100000000 == 0) {
+            end = clock();
+            cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
+            if (cpu_time_used >= tdur) {
+                break;
+            }
+        }
+    }
+    free(pkts);
+    free(pbuf);
+    rsynth_pacer_dtor(pp);
+
+    Mi = (double)(i) / (double)(1000000);
+    Mpps = Mi / cpu_time_used;
+    printf("Paced %.2fM packets in %.3f seconds, %.2fM packets per second\n", Mi, cpu_time_used, Mpps);
+
     return 0;
 }
@@ -1,7 +1,12 @@
 import unittest
 from time import monotonic
 
-from rtpsynth.RtpSynth import RtpSynth
+import rtpsynth.RtpSynth as RtpSynth_mod
+from rtpsynth.RtpJBuf import RTPParseError, parse_hdrext
+from rtpsynth.RtpSynth import RtpSynth, RtpSynthPool, RtpSynthPacer
+
+def pkt_ts(pkt):
+    return int.from_bytes(pkt[4:8], 'big')
 
 class TestSynth(unittest.TestCase):
     def test_generate(self):
@@ -27,6 +32,202 @@ class TestSynth(unittest.TestCase):
         self.assertGreater(i, 0)
         self.assertGreater(dur, 0.0)
 
+    def test_next_pkts(self):
+        rs = RtpSynth(8000, 20)
+        pkts = rs.next_pkts(8, 160, 0)
+        pkts.append(rs.next_pkt(160, 0))
+        self.assertEqual(len(pkts), 9)
+        seq0 = int.from_bytes(pkts[0][2:4], 'big')
+        ts0 = int.from_bytes(pkts[0][4:8], 'big')
+        ssrc0 = pkts[0][8:12]
+        for i, pkt in enumerate(pkts):
+            self.assertEqual(len(pkt), 12 + 160)
+            self.assertEqual(pkt[0], 0x80)
+            self.assertEqual(pkt[1], 0x80 if i == 0 else 0x00)
+            self.assertEqual(int.from_bytes(pkt[2:4], 'big'), (seq0 + i) & 0xffff)
+            self.assertEqual(int.from_bytes(pkt[4:8], 'big'), (ts0 + i * 160) & 0xffffffff)
+            self.assertEqual(pkt[8:12], ssrc0)
+            self.assertEqual(pkt[12:], bytes(160))
+        with self.assertRaises(ValueError):
+            rs.next_pkts(0, 160, 0)
+
+    def test_clock_at(self):
+        rs = RtpSynth(8000, 20)
+        self.assertEqual(rs.set_clock(RtpSynth_mod.RSYNTH_CLOCK_NONE),
+                         RtpSynth_mod.RSYNTH_CLOCK_MONOTONIC)
+        now_ns = 1000 * 1000000000
+        ts0 = pkt_ts(rs.next_pkt(160, 0, now_ns=now_ns))
+        # No clock: plain resync() has no time reference to advance by
+        rs.resync()
+        ts1 = pkt_ts(rs.next_pkt(160, 0, now_ns=now_ns + 20000000))
+        self.assertEqual(ts1, (ts0 + 160) & 0xffffffff)
+        # 1 second of silence at 8kHz
+        rs.resync_at(now_ns + 1020000000)
+        ts2 = pkt_ts(rs.next_pkt(160, 0))
+        self.assertEqual(ts2, (ts1 + 160 + 8000) & 0xffffffff)
+        self.assertEqual(rs.set_clock(RtpSynth_mod.RSYNTH_CLOCK_COARSE),
+                         RtpSynth_mod.RSYNTH_CLOCK_NONE)
+        rs.next_pkt(160, 0)
+        rs.resync()
+        with self.assertRaises(ValueError):
+            rs.set_clock(42)
+
+    def test_next_hdr(self):
+        rs = RtpSynth(8000, 20)
+        pload = bytes(range(160))
+        hdr = rs.next_hdr(0)
+        self.assertEqual(len(hdr), 12)
+        pkt = rs.next_pkt(160, 0, pload)
+        self.assertEqual(pkt[12:], pload)
+        self.assertEqual(hdr[1], 0x80)
+        self.assertEqual(pkt[1], 0x00)
+        self.assertEqual(int.from_bytes(pkt[2:4], 'big'),
+                         (int.from_bytes(hdr[2:4], 'big') + 1) & 0xffff)
+        self.assertEqual(pkt_ts(pkt), (pkt_ts(hdr) + 160) & 0xffffffff)
+        self.assertEqual(pkt[8:12], hdr[8:12])
+
+    def test_pool(self):
+        nstreams = 37
+        rp = RtpSynthPool(64, 20)
+        for i in range(nstreams):
+            self.assertEqual(rp.add(8000 if i % 2 == 0 else 16000, i % 128), i)
+        self.assertEqual(len(rp), nstreams)
+        hdrs = [rp.tick() for _ in range(3)]
+        for t, h in enumerate(hdrs):
+            self.assertEqual(len(h), nstreams * 12)
+        for i in range(nstreams):
+            ts_inc = 160 if i % 2 == 0 else 320
+            h0 = hdrs[0][i * 12:(i + 1) * 12]
+            for t in range(3):
+                h = hdrs[t][i * 12:(i + 1) * 12]
+                self.assertEqual(h[0], 0x80)
+                self.assertEqual(h[1], (0x80 if t == 0 else 0) | (i % 128))
+                self.assertEqual(int.from_bytes(h[2:4], 'big'),
+                                 (int.from_bytes(h0[2:4], 'big') + t) & 0xffff)
+                self.assertEqual(pkt_ts(h), (pkt_ts(h0) + t * ts_inc) & 0xffffffff)
+                self.assertEqual(h[8:12], h0[8:12])
+        last = hdrs[-1][(nstreams - 1) * 12:nstreams * 12]
+        self.assertEqual(rp.remove(5), nstreams - 1)
+        self.assertEqual(rp.remove(nstreams - 2), -1)
+        self.assertEqual(rp.set_mbt(5, 1), 0)
+        h = rp.tick()[5 * 12:6 * 12]
+        self.assertEqual(h[1], 0x80 | ((nstreams - 1) % 128))
+        self.assertEqual(h[8:12], last[8:12])
+        last_inc = 160 if (nstreams - 1) % 2 == 0 else 320
+        self.assertEqual(pkt_ts(h), (pkt_ts(last) + last_inc) & 0xffffffff)
+        with self.assertRaises(IndexError):
+            rp.skip(nstreams, 1)
+
+    def test_prng(self):
+        hdr = lambda rs: rs.next_hdr(0)
+        a = hdr(RtpSynth(8000, 20, prng=12345))
+        b = hdr(RtpSynth(8000, 20, prng=12345))
+        c = hdr(RtpSynth(8000, 20, prng=54321))
+        self.assertEqual(a, b)
+        self.assertNotEqual(a[2:], c[2:])
+        ssrcs = set(hdr(RtpSynth(8000, 20, prng=True))[8:12] for _ in range(64))
+        self.assertGreater(len(ssrcs), 60)
+        with self.assertRaises(TypeError):
+            RtpSynth(8000, 20, prng='x')
+
+    def test_pacer(self):
+        ms = 1000000
+        t0 = 1000 * ms
+        seq = lambda pkt: int.from_bytes(pkt[2:4], 'big')
+        pc = RtpSynthPacer(16, tick_ns=ms, max_late=3)
+        ids = [pc.add(8000, 20, 0, bytes([i]) * 160, t0 + i * ms)
+          for i in range(3)]
+        self.assertEqual(pc.next_deadline(), t0)
+        out = pc.run(t0 + 2 * ms)
+        self.assertEqual([(i, d) for i, d, _ in out],
+          [(i, t0 + i * ms) for i in ids])
+        self.assertTrue(all(len(p) == 172 and p[12:] == p[12:13] * 160
+          for _, _, p in out))
+        first = {i: p for i, _, p in out}
+        self.assertEqual(pc.run(t0 + 19 * ms), [])
+        self.assertEqual(pc.next_deadline(), t0 + 20 * ms)
+        # Deadlines stay on the grid regardless of when run() is called
+        out = pc.run(t0 + 41 * ms + 999)
+        self.assertEqual([(i, d) for i, d, _ in out if i == ids[0]],
+          [(ids[0], t0 + 20 * ms), (ids[0], t0 + 40 * ms)])
+        for i, _, p in out:
+            self.assertEqual(p[8:12], first[i][8:12])
+        last = {i: p for i, _, p in out}
+        # Silence slots advance the timestamp but not the sequence number
+        pc.set_pload(ids[0], None)
+        pc.run(t0 + 60 * ms)
+        pc.set_pload(ids[0], b'\x00' * 160)
+        out = pc.run(t0 + 80 * ms)
+        p = [p for i, _, p in out if i == ids[0]][0]
+        self.assertEqual(seq(p), (seq(last[ids[0]]) + 1) & 0xffff)
+        self.assertEqual(pkt_ts(p) - pkt_ts(last[ids[0]]), 2 * 160)
+        # Falling behind by more than max_late skips missed slots
+        out = pc.run(t0 + 1000 * ms, 64)
+        self.assertEqual([d for i, d, _ in out if i == ids[0]],
+          [t0 + 1000 * ms])
+        q = [p for i, _, p in out if i == ids[0]][0]
+        self.assertEqual(seq(q), (seq(p) + 1) & 0xffff)
+        self.assertEqual(pkt_ts(q) - pkt_ts(p), 46 * 160)
+        # Pause/resume keeps timestamp in line with the wall clock
+        pc.pause(ids[1])
+        pc.remove(ids[2])
+        self.assertEqual([i for i, _, _ in pc.run(t0 + 1040 * ms)], [ids[0]] * 2)
+        pc.resume(ids[1], t0 + 1200 * ms)
+        out = pc.run(t0 + 1201 * ms)
+        self.assertEqual(sorted(i for i, _, _ in out),
+          [ids[0]] + [ids[1]] * 2)
+        with self.assertRaises(KeyError):
+            pc.pause(ids[2])
+        # Partial batches resume where they left off
+        pc = RtpSynthPacer(64, tick_ns=ms)
+        for i in range(50):
+            pc.add(8000, 20, 0, b'\x00', t0)
+        self.assertEqual(len(pc.run(t0, 32)), 32)
+        self.assertEqual(len(pc.run(t0, 32)), 18)
+        self.assertEqual(pc.run(t0, 32), [])
+        for i in range(14):
+            pc.add(8000, 20, 0, b'', t0)
+        with self.assertRaises(OverflowError):
+            pc.add(8000, 20, 0, b'', t0)
+
+    def test_hdrext(self):
+        rs = RtpSynth(8000, 20)
+        self.assertEqual(len(rs.next_hdr(0)), 12)
+        rs.hdrext_add(1, b'\x00')
+        rs.hdrext_add(3, b'\x00\x00\x00')
+        rs.hdrext_set(1, 0x80 | 42)
+        rs.hdrext_set(3, 0x123456)
+        pkt = rs.next_pkt(160, 0)
+        self.assertEqual(pkt[0] & 0x10, 0x10)
+        self.assertEqual(pkt[12:16], b'\xbe\xde\x00\x02')
+        self.assertEqual(len(pkt), 12 + 4 + 8 + 160)
+        self.assertEqual(parse_hdrext(pkt),
+          [(1, b'\xaa'), (3, b'\x12\x34\x56')])
+        # Per-packet patching sticks for the subsequent packets
+        rs.hdrext_set(3, b'\x00\x00\x01')
+        self.assertEqual(parse_hdrext(rs.next_hdr(0))[1], (3, b'\x00\x00\x01'))
+        self.assertEqual(parse_hdrext(rs.next_hdr(0))[1], (3, b'\x00\x00\x01'))
+        # Element that does not fit one-byte form switches to two-byte one
+        rs.hdrext_add(20, b'\x07\x08')
+        hdr = rs.next_hdr(0)
+        self.assertEqual(hdr[12:14], b'\x10\x00')
+        self.assertEqual(parse_hdrext(hdr),
+          [(1, b'\xaa'), (3, b'\x00\x00\x01'), (20, b'\x07\x08')])
+        with self.assertRaises(ValueError):
+            rs.hdrext_add(1, b'\x00')
+        with self.assertRaises(ValueError):
+            rs.hdrext_set(1, b'\x00\x00')
+        with self.assertRaises(ValueError):
+            rs.hdrext_set(2, 0)
+        rs.hdrext_clear()
+        hdr = rs.next_hdr(0)
+        self.assertEqual((len(hdr), hdr[0] & 0x10), (12, 0))
+        self.assertEqual(parse_hdrext(hdr), [])
+        # Truncated element
+        bad = b'\x90\x00' + b'\x00' * 10 + b'\xbe\xde\x00\x01\x13\x00\x00\x00'
+        with self.assertRaises(RTPParseError):
+            parse_hdrext(bad)
+
 
 if __name__ == '__main__':
     unittest.main()